@@ -0,0 +1,29 @@
+#include "backgroundmodel.h"
+#include "knnmodel.h"
+#include "vibemodel.h"
+
+/**
+ *	@file backgroundmodel.cpp
+ *  @desc Creates the background model of the chosen engine
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+/**
+ *  @desc Creates a background model for one zone
+ *
+ *  @param BackgroundEngine engine - KNN or ViBe
+ *  @param int history - BGS history length
+ *  @param double threshold - BGS squared distance to threshold
+ *
+ *  @returns Ptr<BackgroundModel> - the new model
+ */
+Ptr<BackgroundModel> BackgroundModel::create(BackgroundEngine engine, int history, double threshold)
+{
+	if (engine == BACKGROUND_VIBE)
+	{
+		return makePtr<VibeModel>(history, threshold);
+	}
+	return makePtr<KnnModel>(history, threshold);
+}
@@ -0,0 +1,46 @@
+#ifndef BACKGROUNDMODEL_H
+#define BACKGROUNDMODEL_H
+
+#include <string>
+#include "opencv2/core.hpp"
+#include "threadpool.h"
+
+using namespace std;
+using namespace cv;
+
+/**
+ *  @desc Which background model a stream subtracts with
+ */
+enum BackgroundEngine
+{
+	BACKGROUND_KNN,		//OpenCV's KNN subtractor, the only one that runs on the OpenCL device
+	BACKGROUND_VIBE		//the in-house sample based model, see VibeModel
+};
+
+/**
+ *	@file backgroundmodel.h
+ *  @desc The interface BGS subtracts the background of each zone through. A model is
+ *  given each new greyscale frame of one zone and returns its foreground mask, 255 for
+ *  foreground. Models that can filter the noise from the mask as part of the same pass
+ *  are given BGS's kernels with set_noise_filter(), and say so with filters_noise(),
+ *  so BGS doesn't filter their mask again.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class BackgroundModel
+{
+	public:
+		virtual ~BackgroundModel() {}
+		virtual void apply(InputArray grey, OutputArray fgmask) = 0;
+		virtual void set_noise_filter(const Mat &close_kernel, const Mat &open_kernel) {}
+		virtual void set_pool(ThreadPool *shared_pool, int max_helpers) {}
+		virtual bool filters_noise() { return false; }
+		virtual bool runs_on_device() { return false; }
+		virtual size_t get_memory_bytes() = 0;
+		virtual string get_name() = 0;
+
+		static Ptr<BackgroundModel> create(BackgroundEngine engine, int history, double threshold);
+};
+
+#endif
@@ -0,0 +1,330 @@
+#include "benchmark.h"
+#include <psapi.h>
+
+#pragma comment(lib, "psapi.lib")
+
+/**
+ *	@file benchmark.cpp
+ *  @desc Times the steps of the analysis one frame at a time. Unlike a normal run the
+ *  steps aren't pipelined or spread over the thread pool, so the time of each step is
+ *  its own latency rather than time spent waiting for another thread. Every shape found
+ *  on every frame is classified and logged, so the benchmark measures the worst case
+ *  rather than what the scheduler would let through.
+ *
+ *  Allocations are counted from operator new, through the HeapCounter, and from
+ *  OpenCV's Mat allocator while the video is replayed, training is not counted. The
+ *  peak resident set is that of the whole process.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+CountingMatAllocator::CountingMatAllocator(MatAllocator *wrapped)
+	: inner(wrapped), allocations(0)
+{}
+
+UMatData *CountingMatAllocator::allocate(int dims, const int *sizes, int type, void *data, size_t *step, int flags, UMatUsageFlags usage_flags) const
+{
+	if (data == NULL)	//headers over memory the caller owns aren't allocations
+	{
+		allocations++;
+	}
+	return inner->allocate(dims, sizes, type, data, step, flags, usage_flags);
+}
+
+bool CountingMatAllocator::allocate(UMatData *data, int access_flags, UMatUsageFlags usage_flags) const
+{
+	return inner->allocate(data, access_flags, usage_flags);
+}
+
+void CountingMatAllocator::deallocate(UMatData *data) const
+{
+	inner->deallocate(data);
+}
+
+long long CountingMatAllocator::get_allocations() const
+{
+	return allocations;
+}
+
+Benchmark::Benchmark(string t_path, string v_path, int frames_to_run)
+	: training_path(t_path), video_path(v_path), max_frames(frames_to_run), background_engine(BACKGROUND_KNN), model_bytes(0), blob_engine(BLOB_CONTOURS), frames(0), shapes_found(0),
+	training_ms(0), run_ms(0), log_close_ms(0), heap_allocations(0), mat_allocations(0), peak_rss(0)
+{
+	t_decode = timer.add_stage("Decode");
+	t_grey = timer.add_stage("Greyscale");
+	t_model = timer.add_stage("Background Model");
+	t_filter = timer.add_stage("Filter Noise");
+	t_contours = timer.add_stage("Highlight Contours");
+	t_shapes = timer.add_stage("Large Shapes");
+	t_skeleton = timer.add_stage("Create Skeleton");
+	t_judge = timer.add_stage("Judge Features");
+	t_log = timer.add_stage("Record Log");
+	timer.set_keep_samples(true);
+}
+
+/**
+ *  @desc Chooses the background model to time, call before run()
+ *
+ *  @param BackgroundEngine engine - KNN or ViBe
+ */
+void Benchmark::set_background_engine(BackgroundEngine engine)
+{
+	background_engine = engine;
+}
+
+/**
+ *  @desc Chooses how the blobs are found, call before run()
+ *
+ *  @param BlobEngine engine - contours and hulls, or connected components
+ */
+void Benchmark::set_blob_engine(BlobEngine engine)
+{
+	blob_engine = engine;
+}
+
+/**
+ *  @desc Trains the PeopleFinder, then replays the video through decoding, greyscale,
+ *  the background model, noise filtering, contour highlighting, shape extraction, skeleton building,
+ *  judging and the record log
+ *
+ *  @returns false if the video couldn't be opened
+ */
+bool Benchmark::run()
+{
+	ThreadPool pool(0);
+	PeopleFinder pf(vector<Point>(11), vector<Point>(11), training_path);
+	BGS bgs("_bench", video_path, BENCHMARK_HISTORY, BENCHMARK_THRESHOLD, true, &pf, &pool);	//for its noise filter
+	BlobDetector bd;
+	ComponentDetector cd;
+	RecordLog rlog;
+	CaptureSource capture;
+	Ptr<BackgroundModel> model;
+	MatAllocator *default_allocator = Mat::getDefaultAllocator();
+	CountingMatAllocator counter(default_allocator);
+	SkeletonWorkspace *workspace = PeopleFinder::get_thread_workspace();
+	PROCESS_MEMORY_COUNTERS memory;
+	Mat frame, grey, fgmask, filtered, contours_only, drawn;
+	vector<Mat> shapes, src_shapes;
+	vector<Rect> boxes;
+	vector<ComponentBlob> blobs;
+	vector<BlobRun> blob_runs;
+	vector<int> all_blobs;
+	Verdict verdict;
+	bool bad_flag, have_frame;
+	int64 start;
+	int i;
+
+	bgs.set_background_engine(background_engine);
+	model = bgs.create_background_model();
+	model->set_pool(NULL, 0);	//one thread, like every other step
+	model_name = model->get_name();
+
+	start = getTickCount();
+	pf.train(&pool);
+	training_ms = ((getTickCount() - start) * 1000.0) / getTickFrequency();
+
+	if (!capture.open(video_path))
+	{
+		cout << "Couldn't open the video " << video_path << endl;
+		return false;
+	}
+	rlog.set_html_view(false);
+	rlog.init_log(video_path, BENCHMARK_HISTORY, BENCHMARK_THRESHOLD, "_bench");
+
+	frames = 0;
+	shapes_found = 0;
+	Mat::setDefaultAllocator(&counter);
+	HeapCounter::start();
+	timer.begin_run();
+
+	while (max_frames <= 0 || frames < max_frames)
+	{
+		timer.start(t_decode);
+		have_frame = capture.read(&frame, &grey);
+		timer.stop(t_decode);
+		if (!have_frame)
+		{
+			break;
+		}
+
+		timer.start(t_grey);
+		cvtColor(frame, grey, CV_BGRA2GRAY);
+		timer.stop(t_grey);
+
+		timer.start(t_model);
+		model->apply(grey, fgmask);
+		timer.stop(t_model);
+
+		timer.start(t_filter);
+		filtered = model->filters_noise() ? fgmask : bgs.filter_noise(&fgmask);
+		timer.stop(t_filter);
+
+		if (blob_engine == BLOB_COMPONENTS)
+		{
+			timer.start(t_contours);
+			all_blobs.resize(cd.find_blobs(&filtered, vector<Rect>(1, Rect(0, 0, filtered.cols, filtered.rows)), &blobs, &blob_runs));
+			cd.draw_annotations(filtered.size(), blobs, blob_runs, &drawn);
+			timer.stop(t_contours);
+
+			timer.start(t_shapes);
+			for (i = 0; i < all_blobs.size(); i++)
+			{
+				all_blobs[i] = i;
+			}
+			cd.get_large_shapes(&frame, filtered.size(), blobs, blob_runs, all_blobs, 10, 1, &shapes, &src_shapes, &boxes, NULL);
+			timer.stop(t_shapes);
+		}
+		else
+		{
+			timer.start(t_contours);
+			drawn = bd.highlight_contours(&frame, &filtered, &contours_only);
+			timer.stop(t_contours);
+
+			timer.start(t_shapes);
+			bd.get_large_shapes(&frame, &filtered, bd.get_hull_list(), bd.get_hull_size(), 10, 1, &shapes, &src_shapes, &boxes, NULL);
+			timer.stop(t_shapes);
+		}
+
+		for (i = 0; i < shapes.size(); i++)
+		{
+			bad_flag = false;
+			timer.start(t_skeleton);
+			const vector<Point>& nodes = pf.create_skeleton(&shapes[i], workspace, &bad_flag);
+			timer.stop(t_skeleton);
+
+			timer.start(t_judge);
+			verdict = pf.judge_features(nodes);
+			timer.stop(t_judge);
+
+			timer.start(t_log);
+			rlog.new_record((int)capture.get(CV_CAP_PROP_POS_FRAMES), (int)capture.get(CV_CAP_PROP_POS_MSEC), src_shapes[i], shapes[i],
+				verdict, boxes[i], 0, 0, 0);
+			timer.stop(t_log);
+		}
+		shapes_found += (int)shapes.size();
+		frames++;
+	}
+
+	run_ms = timer.get_run_ms();
+	model_bytes = model->get_memory_bytes();
+	heap_allocations = HeapCounter::stop();
+	Mat::setDefaultAllocator(default_allocator);
+	mat_allocations = counter.get_allocations();
+
+	start = getTickCount();
+	rlog.close_log();
+	log_close_ms = ((getTickCount() - start) * 1000.0) / getTickFrequency();
+	capture.release();
+
+	memory.cb = sizeof(memory);
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &memory, sizeof(memory)))
+	{
+		peak_rss = memory.PeakWorkingSetSize;
+	}
+	return true;
+}
+
+/**
+ *  @desc Writes the results of the last run as a JSON object
+ *
+ *  @param ostream &out - where to write
+ */
+void Benchmark::write_json(ostream &out)
+{
+	int i;
+
+	out << fixed << setprecision(3);
+	out << "{\n";
+	out << "\t\"video\": \"" << escape_json(video_path) << "\",\n";
+	out << "\t\"background_model\": \"" << escape_json(model_name) << "\",\n";
+	out << "\t\"background_model_bytes\": " << model_bytes << ",\n";
+	out << "\t\"blob_engine\": \"" << (blob_engine == BLOB_COMPONENTS ? "components" : "contours") << "\",\n";
+	out << "\t\"frames\": " << frames << ",\n";
+	out << "\t\"shapes\": " << shapes_found << ",\n";
+	out << "\t\"elapsed_ms\": " << run_ms << ",\n";
+	out << "\t\"fps\": " << (run_ms > 0 ? frames * 1000.0 / run_ms : 0.0) << ",\n";
+	out << "\t\"training_ms\": " << training_ms << ",\n";
+	out << "\t\"log_close_ms\": " << log_close_ms << ",\n";
+	out << "\t\"stages\": [\n";
+	for (i = 0; i < timer.get_stage_count(); i++)
+	{
+		out << "\t\t{\"name\": \"" << escape_json(timer.get_stage_name(i)) << "\", \"calls\": " << timer.get_calls(i)
+			<< ", \"mean_ms\": " << (timer.get_calls(i) > 0 ? timer.get_total_ms(i) / timer.get_calls(i) : 0.0)
+			<< ", \"p50_ms\": " << timer.get_percentile(i, 50)
+			<< ", \"p99_ms\": " << timer.get_percentile(i, 99) << "}" << (i + 1 < timer.get_stage_count() ? "," : "") << "\n";
+	}
+	out << "\t],\n";
+	out << "\t\"heap_allocations_per_frame\": " << (frames > 0 ? (double)heap_allocations / frames : 0.0) << ",\n";
+	out << "\t\"mat_allocations_per_frame\": " << (frames > 0 ? (double)mat_allocations / frames : 0.0) << ",\n";
+	out << "\t\"peak_rss_bytes\": " << peak_rss << "\n";
+	out << "}\n";
+}
+
+/**
+ *  @desc Escapes a string for a JSON string literal, e.g. the backslashes of a Windows
+ *  path
+ *
+ *  @param const string &value - the raw value
+ *
+ *  @returns string - value with backslashes, quotes and control characters escaped
+ */
+string Benchmark::escape_json(const string &value)
+{
+	string escaped;
+	char code[8];
+	size_t i;
+
+	for (i = 0; i < value.size(); i++)
+	{
+		if (value[i] == '\\' || value[i] == '"')
+		{
+			escaped += '\\';
+			escaped += value[i];
+		}
+		else if (value[i] == '\n')
+		{
+			escaped += "\\n";
+		}
+		else if (value[i] == '\r')
+		{
+			escaped += "\\r";
+		}
+		else if (value[i] == '\t')
+		{
+			escaped += "\\t";
+		}
+		else if ((unsigned char)value[i] < 0x20)
+		{
+			snprintf(code, sizeof(code), "\\u%04x", (unsigned char)value[i]);
+			escaped += code;
+		}
+		else
+		{
+			escaped += value[i];
+		}
+	}
+	return escaped;
+}
+
+/**
+ *  @desc Writes the results of the last run to a JSON file
+ *
+ *  @returns false if the file couldn't be written
+ */
+bool Benchmark::save_json(string path)
+{
+	ofstream file(path);
+
+	if (!file.is_open())
+	{
+		return false;
+	}
+	write_json(file);
+	return file.good();
+}
+
+int Benchmark::get_frames()
+{
+	return frames;
+}
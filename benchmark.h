@@ -0,0 +1,95 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <stdlib.h>
+#include <opencv2/video.hpp>
+#include "opencv2/imgproc.hpp"
+#include "bgs.h"
+#include "peoplefinder.h"
+#include "blobdetector.h"
+#include "componentdetector.h"
+#include "recordlog.h"
+#include "capturesource.h"
+#include "stagetimer.h"
+#include "threadpool.h"
+#include "heapcounter.h"
+
+using namespace std;
+using namespace cv;
+
+#define BENCHMARK_HISTORY 750		//BGS settings used for every benchmark run, so runs can be compared
+#define BENCHMARK_THRESHOLD 500
+
+/**
+ *  @desc Counts the image buffers OpenCV allocates, passing the work on to its own
+ *  allocator. Installed as the default Mat allocator while a benchmark runs.
+ */
+class CountingMatAllocator : public MatAllocator
+{
+	private:
+		MatAllocator *inner;
+		mutable atomic<long long> allocations;
+
+	public:
+		CountingMatAllocator(MatAllocator *wrapped);
+		UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step, int flags, UMatUsageFlags usage_flags) const;
+		bool allocate(UMatData *data, int access_flags, UMatUsageFlags usage_flags) const;
+		void deallocate(UMatData *data) const;
+		long long get_allocations() const;
+};
+
+/**
+ *	@file benchmark.h
+ *  @desc Replays a video and the training set through every step of the analysis on
+ *  one thread, timing each step separately, and reports the results as JSON so runs
+ *  can be compared between releases.
+ *
+ *  @param string training_path - training images, always retrained rather than loaded
+ *  @param string video_path - the recorded video to replay
+ *  @param int max_frames - frames to replay, 0 for the whole video
+ *  @param BackgroundEngine background_engine - background model to time, run on one thread like the rest
+ *  @param BlobEngine blob_engine - contours and hulls, or connected components
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class Benchmark
+{
+	private:
+		string training_path;
+		string video_path;
+		int max_frames;
+		BackgroundEngine background_engine;
+		string model_name;
+		size_t model_bytes;
+		BlobEngine blob_engine;
+
+		StageTimer timer;
+		int t_decode, t_grey, t_model, t_filter, t_contours, t_shapes, t_skeleton, t_judge, t_log;
+		int frames;
+		int shapes_found;
+		double training_ms;
+		double run_ms;
+		double log_close_ms;
+		long long heap_allocations;
+		long long mat_allocations;
+		size_t peak_rss;
+
+	public:
+		Benchmark(string t_path, string v_path, int frames_to_run);
+		void set_background_engine(BackgroundEngine engine);
+		void set_blob_engine(BlobEngine engine);
+		bool run();
+		void write_json(ostream &out);
+		bool save_json(string path);
+		int get_frames();
+
+		static string escape_json(const string &value);
+};
+
+#endif
@@ -3,126 +3,880 @@
 /**
  *	@file bgs.cpp
  *  @desc Plays the video footage while displaying the source, BGS and blob detection
- *  contour frames to the user. Runs the PeopleFinder on the video each second and saves
- *  information to the record log.
+ *  contour frames to the user. Tracks the larger shapes, runs the PeopleFinder on new and
+ *  uncertain tracks and saves information to the record log.
  *
- *  @param string training_path - path for training images folder
+ *  @param string stream_name - tag for this stream's log files, empty for a single stream
  *  @param string video_path - path for video file 
+ *  @param PeopleFinder *pf - the trained classifier, shared between streams
+ *  @param ThreadPool *pool - workers for classification, shared between streams
+ *  @param bool headless - skips the display windows and frame delay when true
+ *  @param ZoneMask zone_mask - active zones read from <video path>.zones, if present
  *
  *	@author Alex O'Donnell
- *	@version 1.3
+ *	@version 1.4
  */
 
-BGS::BGS(string t_path, string v_path, int history, double thresh)
-	: training_path(t_path), video_path(v_path), bgs_history(history), bgs_threshold(thresh)
-{}
+atomic<bool> BGS::stop_requested(false);
+
+BGS::BGS(string name, string v_path, int history, double thresh, bool no_display, PeopleFinder *shared_pf, ThreadPool *shared_pool)
+	: stream_name(name), video_path(v_path), bgs_history(history), bgs_threshold(thresh), headless(no_display), live(false), live_dropped(0), live_reconnects(0), background_engine(BACKGROUND_KNN), bgs_scale(1),
+	blob_engine(BLOB_CONTOURS), pf(shared_pf), pool(shared_pool), pool_share(shared_pool->get_size()),
+	pending_detections(0), skipped_detections(0), frames_processed(0), frames_in_flight(0), classified_shapes(0),
+	range_first(0), range_end(0), range_warmup(0), log_records(true)
+{
+	t_decode = timer.add_stage("Decode");
+	t_grey = timer.add_stage("Greyscale");
+	t_scale = timer.add_stage("Downscale");
+	t_model = timer.add_stage("Background Model");
+	t_filter = timer.add_stage("Filter Noise");
+	t_contours = timer.add_stage("Contours");
+	t_track = timer.add_stage("Tracking");
+	t_shapes = timer.add_stage("Large Shapes");
+	t_annotate = timer.add_stage("Annotate");
+	t_classify = timer.add_stage("PeopleFinder");
+	t_log = timer.add_stage("Record Log");
+	t_display = timer.add_stage("Display");
+	metrics.set_stream(stream_name, video_path);
+	timer.set_metrics(&metrics);
+	rlog.set_metrics(&metrics);
+
+	close_kernel = getStructuringElement(MORPH_RECT, Size(5, 5));
+	open_kernel = getStructuringElement(MORPH_RECT, Size(3, 3));
+	zone_mask.load(video_path + ".zones");
+}
 
 /**
  *  @desc Begins playing the video footage from the video path, converting it to greyscale
  *  and running OpenCV's BGS KNN function on the footage. After filtering noise, the contours 
  *  are highlighted using the BlobDetector.
  *  
- *  Pedestrian detection is applied every second, where the larger shapes within the contour 
- *  image are sent to the PeopleFinder. The results of the PeopleFinder's analysis are sent
- *  to the recordlog.
+ *  The larger shapes are followed from frame to frame by the ShapeTracker. A new track's
+ *  shape is sent to the PeopleFinder when it appears, and tracks still uncertain are sent
+ *  again when the DetectionScheduler calls for a recheck, which is more often while the
+ *  foreground is changing and rarely on an empty scene, within a CPU budget. The results
+ *  of the PeopleFinder's analysis are sent to the recordlog.
+ *
+ *  The work is split into a FramePipeline so each step runs on its own thread: decoding,
+ *  background subtraction (serial, as the KNN model depends on every previous frame),
+ *  contour/hull extraction, drawing the annotations (only when displayed) and finally
+ *  classification and display on this thread. The
+ *  shapes found on a detection frame are classified in parallel on the shared thread
+ *  pool, using at most this stream's share of the workers. The PeopleFinder must
+ *  already be trained.
+ *
+ *  The video is read through a CaptureSource using the backend chosen by set_capture().
+ *  In greyscale mode the frames are decoded straight to grey and the colour frame is
+ *  never kept, and in skipping mode frames are dropped before conversion while more
+ *  than CAPTURE_SKIP_BACKLOG frames are waiting to be analysed.
+ *
+ *  With set_bgs_scale() the zones are shrunk before background subtraction, and the
+ *  hulls found in the shrunk mask are only scaled back up for the source images.
+ *
+ *  If a zone file was found only the zones are background subtracted, filtered and
+ *  searched for contours, each zone keeping its own KNN model.
+ *
+ *  With set_frame_range() only a segment of the video is analysed, after seeking to a
+ *  little before it so the models are primed by the time the segment starts.
+ *
+ *  With set_clip_length() every frame is also kept in the ClipRecorder's ring, and a
+ *  pedestrian starts a clip of the video around it that is linked from its record.
+ *
+ *  An RTSP or HTTP camera URL is read through a LiveSource instead, which keeps only
+ *  the latest few frames and reconnects when the camera drops out. The pipeline just
+ *  waits for the next frame meanwhile, so the KNN models stay warm, and only pressing
+ *  'c' or Ctrl+C in the console (request_stop()) ends a live stream.
+ *
+ *  In headless mode no windows are created and the loop does not wait between frames,
+ *  so the video is processed as fast as decoding and BGS allow.
  *
  *  @returns 0
  */
 int BGS::run()
 {
-	BlobDetector bd = BlobDetector(vector<Mat>(20));
-	PeopleFinder pf = PeopleFinder(vector<Point>(11), vector<Point>(11), training_path, false);
-	rlog = RecordLog();
-	VideoCapture capCam = VideoCapture();
-	Mat frame, frame2, fgMaskKNN, filteredMask, contourimg, contoursonly;
-	vector<Mat> large_shapes;
-	Ptr<BackgroundSubtractor> pKNN, pMOG2;
-	int fps, frame_number = 0, iteration = 0;
+	FramePipeline pipeline(4);
+	Mat frame, grey;
+	bool opened;
+
+	frames_processed = 0;
+	skipped_detections = 0;
+	pending_detections = 0;
+	classified_shapes = 0;
+	frames_in_flight = 0;
+	rlog.init_log(video_path, bgs_history, bgs_threshold, stream_name);
 
-	rlog.init_log(video_path, bgs_history, bgs_threshold);
-	pf.train();
+	live = LiveSource::is_live_url(video_path);
+	live_dropped = 0;
+	live_reconnects = 0;
+	if (live)
+	{
+		live_cam.set_settings(capCam.get_settings());
+		opened = live_cam.open(video_path) && live_cam.read(&frame, &grey);
+	}
+	else
+	{
+		opened = capCam.open(video_path) && capCam.read(&frame, &grey); //REFLECTIONS SUPPRESSED, BEST VIDEO FOR HIGHLIGHTING INDIVIDUAL MOVEMENT
+		if (opened && range_end > 0 && !capCam.seek(max(range_first - range_warmup, 0)))	//the first frame was only read for its size
+		{
+			cout << "Couldn't seek to frame " << max(range_first - range_warmup, 0) << " of " << video_path << endl;
+			opened = false;
+		}
+	}
 
-	pKNN = createBackgroundSubtractorKNN(bgs_history, bgs_threshold, false);
+	if (opened)
+	{
+		prepare(frame);
 
-	capCam.open(video_path); //REFLECTIONS SUPPRESSED, BEST VIDEO FOR HIGHLIGHTING INDIVIDUAL MOVEMENT
+		if (!headless)
+		{
+			imshow("KNN", frame);
+			imshow("Video", frame);
+			imshow("Contours", frame);
+			moveWindow("Video", 128, 128);
+			moveWindow("KNN", 136, 136);
+			moveWindow("Contours", 144, 144);
+		}
+
+		pipeline.set_source([this](FrameJob *job) { return decode_frame(job); });
+		pipeline.add_stage([this](FrameJob *job) { subtract_background(job); });
+		pipeline.add_stage([this](FrameJob *job) { extract_blobs(job); });
+		if (!headless)	//headless runs don't pay for drawing
+		{
+			pipeline.add_stage([this](FrameJob *job) { annotate_frame(job); });
+		}
+		pipeline.set_sink([this](FrameJob *job) { return classify_frame(job); });
+
+		if (clips.is_enabled())
+		{
+			clips.start("record_log/" + rlog.get_log_name(), frame.size(), frame.type(), live ? CLIP_DEFAULT_FPS : capCam.get(CV_CAP_PROP_FPS));
+			printf("Keeping clips in a %d MB ring\n", (int)(clips.get_memory_bytes() / (1024 * 1024)));
+		}
+
+		timer.begin_run();
+		frames_processed = pipeline.run();
+		clips.stop();	//finishes the clips already started
+	}
+	else
+	{
+		cout << "Couldn't open the video " << LiveSource::mask_credentials(video_path) << endl;
+	}
+	capCam.release();
+	live_cam.release();
+	rlog.close_log();
+
+	return 0;
+}
+
+/**
+ *  @desc Fits the zones to the frames, sizes the shrunk frames and creates a background
+ *  model for each zone. Called by run() once the first frame has been read, and by
+ *  callers that decode the frames themselves before their first analyse_frame().
+ *
+ *  @param const Mat &first_frame - a frame of the video, only its size is used
+ */
+void BGS::prepare(const Mat &first_frame)
+{
+	int i;
 
-	if (capCam.isOpened())
+	scheduler.reset();
+	zone_mask.fit_to_frame(first_frame.size());
+	bgs_size = Size(first_frame.cols / bgs_scale, first_frame.rows / bgs_scale);
+	bgs_zones = zone_mask.get_scaled_zones(bgs_scale);
+	bd.set_min_hull_area(300.0 / (bgs_scale * bgs_scale));
+	cd.set_min_blob_area(300.0 / (bgs_scale * bgs_scale));
+	zone_models.clear();
+	for (i = 0; i < bgs_zones.size(); i++)
+	{
+		zone_models.push_back(create_background_model());
+	}
+	if (!zone_models.empty() && !zone_models[0]->runs_on_device() && device.get_mode() != ACCEL_CPU)
 	{
-		capCam.read(frame);
-		fps = capCam.get(CV_CAP_PROP_FPS);
-		imshow("KNN", frame);
-		imshow("Video", frame);
-		imshow("Contours", frame);
-		moveWindow("Video", 128, 128);
-		moveWindow("KNN", 136, 136);
-		moveWindow("Contours", 144, 144);
+		printf("The %s background model only runs on the CPU\n", zone_models[0]->get_name().c_str());
+		device.set_mode(ACCEL_CPU);
+	}
+	if (!zone_mask.is_full_frame(first_frame.size()))
+	{
+		printf("Processing %d active zone(s)\n", (int)zone_mask.get_zones().size());
+	}
+	if (bgs_scale > 1)
+	{
+		printf("Background subtraction at 1/%d scale, %dx%d\n", bgs_scale, bgs_size.width, bgs_size.height);
+	}
+}
 
-		while (true)
+/**
+ *  @desc Runs every stage of the pipeline on one frame on the calling thread, for
+ *  callers that decode the frames themselves. prepare() must have been called first.
+ *
+ *  @param FrameJob *job - a decoded frame, with its frame number and timestamp
+ *
+ *  @returns false if the user has asked to stop
+ */
+bool BGS::analyse_frame(FrameJob *job)
+{
+	frames_in_flight++;
+	subtract_background(job);
+	extract_blobs(job);
+	frames_processed++;
+	return classify_frame(job);
+}
+
+/**
+ *  @desc Pipeline source, reads the next frame from the video
+ *
+ *  @param FrameJob *job - job to fill with the frame
+ *
+ *  @returns false once the video has finished playing
+ */
+bool BGS::decode_frame(FrameJob *job)
+{
+	bool have_frame;
+
+	if (stop_requested)	//Ctrl+C, see request_stop()
+	{
+		return false;
+	}
+	timer.start(t_decode);
+	if (live)
+	{
+		have_frame = live_cam.read(&job->frame, &job->grey);	//waits out reconnections
+		timer.stop(t_decode);
+		metrics.add(COUNTER_FRAMES_SKIPPED, live_cam.get_frames_dropped() - live_dropped);
+		metrics.add(COUNTER_RECONNECTS, live_cam.get_reconnects() - live_reconnects);
+		live_dropped = live_cam.get_frames_dropped();
+		live_reconnects = live_cam.get_reconnects();
+		if (!have_frame)
 		{
-			capCam.read(frame);
+			return false;
+		}
+		job->frame_number = live_cam.get_frame_number();
+		job->milliseconds = live_cam.get_milliseconds();
+		frames_in_flight++;
+		metrics.set(GAUGE_FRAMES_IN_FLIGHT, frames_in_flight);
+		return true;
+	}
 
-			if (!frame.empty())
-			{
-				frame_number = capCam.get(CV_CAP_PROP_POS_FRAMES);
-				cvtColor(frame, frame2, CV_BGRA2GRAY);
-				pKNN->apply(frame2, fgMaskKNN);
-				filteredMask = filter_noise(&fgMaskKNN);
+	if (range_end > 0 && capCam.get(CV_CAP_PROP_POS_FRAMES) >= range_end)	//the end of this stream's segment
+	{
+		timer.stop(t_decode);
+		return false;
+	}
+	if (capCam.get_settings().skip_frames && frames_in_flight >= CAPTURE_SKIP_BACKLOG)	//the analysis is falling behind, drop frames before converting them
+	{
+		for (int i = 0; i < CAPTURE_MAX_SKIP && capCam.skip(); i++)
+		{
+			metrics.add(COUNTER_FRAMES_SKIPPED, 1);
+		}
+	}
+	have_frame = capCam.read(&job->frame, &job->grey);
+	timer.stop(t_decode);
 
-				contourimg = bd.highlight_contours(&frame, &filteredMask, &contoursonly);
+	if (!have_frame)
+	{
+		printf(" --(!) Video has finished playing -- Break!\n");
+		return false;
+	}
 
-				imshow("KNN", filteredMask);
-				imshow("Video", frame);
-				imshow("Contours", contourimg);
-	
+	job->frame_number = capCam.get(CV_CAP_PROP_POS_FRAMES);
+	job->milliseconds = capCam.get(CV_CAP_PROP_POS_MSEC);
+	job->warm_up = job->frame_number <= range_first;	//frame_number counts from 1
+	frames_in_flight++;
+	metrics.set(GAUGE_FRAMES_IN_FLIGHT, frames_in_flight);
+	return true;
+}
 
-				if (frame_number - (fps * iteration) == fps)	//This equation ensures that it runs the pedestrian detector every second of the video
-				{
-					iteration++;
-					large_shapes = bd.get_large_shapes(&frame, &filteredMask, bd.get_hull_list(), bd.get_hull_size(), 10);
-					pf.test(&large_shapes);
-					run_frame_analysis(capCam.get(CV_CAP_PROP_POS_FRAMES), capCam.get(CV_CAP_PROP_POS_MSEC), bd.get_src_shapes(), large_shapes, pf.get_verdicts());
-				}
-			}
-			else
-			{
-				printf(" --(!) Video has finished playing -- Break!\n"); break;
-			}
+/**
+ *  @desc Pipeline stage, converts each active zone of the frame to greyscale, shrinks
+ *  it when running at a reduced scale, applies the zone's KNN background subtractor
+ *  and filters the noise from the mask. Pixels outside the zones are left as
+ *  background. The mask is bgs_size, so at a reduced scale every later step on the
+ *  mask works on 1/scale^2 of the pixels.
+ *
+ *  The DeviceSelector decides whether each frame runs on the OpenCL device or the CPU.
+ *  OpenCL is switched per thread, so this stream's choice doesn't affect the others.
+ *
+ *  @param FrameJob *job - current frame
+ */
+void BGS::subtract_background(FrameJob *job)
+{
+	Mat grey, small_grey, fgMaskKNN, filtered_zone;
+	Rect frame_zone;
+	bool on_device;
+	int i;
 
-			int c = waitKey(10);
-			if ((char)c == 'c') { break; }
+	job->filtered_mask = Mat::zeros(bgs_size, CV_8UC1);
+	on_device = device.begin_frame();
+	ocl::setUseOpenCL(on_device);
+
+	for (i = 0; i < bgs_zones.size(); i++)
+	{
+		frame_zone = Rect(bgs_zones[i].x * bgs_scale, bgs_zones[i].y * bgs_scale, bgs_zones[i].width * bgs_scale, bgs_zones[i].height * bgs_scale);
+		if (on_device)
+		{
+			subtract_zone_on_device(job, i, frame_zone);
+			continue;
+		}
+
+		timer.start(t_grey);
+		if (job->grey.empty())
+		{
+			cvtColor(job->frame(frame_zone), grey, CV_BGRA2GRAY);
+		}
+		else
+		{
+			grey = job->grey(frame_zone);	//decoded straight to greyscale
+		}
+		timer.stop(t_grey);
+
+		if (bgs_scale > 1)
+		{
+			timer.start(t_scale);
+			resize(grey, small_grey, bgs_zones[i].size(), 0, 0, INTER_AREA);
+			grey = small_grey;
+			timer.stop(t_scale);
 		}
+
+		timer.start(t_model);
+		zone_models[i]->apply(grey, fgMaskKNN);
+		timer.stop(t_model);
+
+		timer.start(t_filter);
+		filtered_zone = zone_models[i]->filters_noise() ? fgMaskKNN : filter_noise(&fgMaskKNN);	//some models filter as they go
+		filtered_zone.copyTo(job->filtered_mask(bgs_zones[i]));
+		timer.stop(t_filter);
 	}
-	capCam.release();
-	rlog.close_log();
+	device.end_frame();
+}
 
-	return 0;
+/**
+ *  @desc The steps of subtract_background() for one zone on the OpenCL device. The
+ *  zone is uploaded once and stays on the device through the greyscale conversion,
+ *  downscale, KNN and noise filtering, only the filtered mask is read back.
+ *
+ *  @param FrameJob *job - current frame
+ *  @param int zone - index of the zone in bgs_zones
+ *  @param Rect frame_zone - the zone in full resolution frame coordinates
+ */
+void BGS::subtract_zone_on_device(FrameJob *job, int zone, Rect frame_zone)
+{
+	UMat source, grey, small_grey, fgmask, closed, filtered, scratch;
+
+	timer.start(t_grey);
+	if (job->grey.empty())
+	{
+		job->frame(frame_zone).copyTo(source);
+		cvtColor(source, grey, CV_BGRA2GRAY);
+	}
+	else
+	{
+		job->grey(frame_zone).copyTo(grey);
+	}
+	timer.stop(t_grey);
+
+	if (bgs_scale > 1)
+	{
+		timer.start(t_scale);
+		resize(grey, small_grey, bgs_zones[zone].size(), 0, 0, INTER_AREA);
+		grey = small_grey;
+		timer.stop(t_scale);
+	}
+
+	timer.start(t_model);
+	zone_models[zone]->apply(grey, fgmask);
+	timer.stop(t_model);
+
+	timer.start(t_filter);
+	dilate(fgmask, scratch, close_kernel);	//the same close then open as filter_noise()
+	erode(scratch, closed, close_kernel);
+	erode(closed, scratch, open_kernel);
+	dilate(scratch, filtered, open_kernel);
+	filtered.copyTo(job->filtered_mask(bgs_zones[zone]));
+	timer.stop(t_filter);
 }
 
 /**
- *  @desc Enters a new record into the record log
+ *  @desc Pipeline stage, finds the contours and hulls in the mask, or the connected
+ *  components with the ComponentDetector, matches the hulls to
+ *  the tracker's tracks and cuts out the shapes of the tracks that need classifying.
+ *  New tracks are classified as soon as the scheduler's CPU budget allows, uncertain
+ *  and settled tracks only when the scheduler says a recheck is due. Every other hull
+ *  keeps its track's verdict.
  *
- 8  @param int frame_num - number of frames into the video
- *  @param int milliseconds - the timestamp of the video 
- *  @param vector<Mat> src_shapes - the source of the contour shape
- *  @param vector<Mat> large_shapes - the PeopleFinder interpretation of the shape
- *  @param vector<string> verdicts - what the PeopleFinder classifies the shape as
+ *  @param FrameJob *job - current frame
+ */
+void BGS::extract_blobs(FrameJob *job)
+{
+	vector<int> selected, shape_hulls;
+	vector<vector<Point>> selected_hulls;
+	double foreground = 0;
+	bool recheck;
+	int i;
+
+	if (job->warm_up)	//the frame has primed the background models, nothing before the segment is tracked or logged
+	{
+		return;
+	}
+
+	timer.start(t_contours);
+	if (blob_engine == BLOB_COMPONENTS)
+	{
+		job->hull_size = cd.find_blobs(&job->filtered_mask, bgs_zones, &job->blobs, &job->blob_runs);
+		metrics.add(COUNTER_CONTOURS, cd.get_component_count());
+	}
+	else
+	{
+		job->hull_size = bd.find_hulls(&job->filtered_mask, bgs_zones, &job->contours, &job->hull_list);
+		metrics.add(COUNTER_CONTOURS, (long long)job->contours.size());
+	}
+	timer.stop(t_contours);
+	metrics.add(COUNTER_BLOBS, job->hull_size);
+
+	timer.start(t_track);
+	job->hull_boxes.resize(job->hull_size);
+	for (i = 0; i < job->hull_size; i++)
+	{
+		job->hull_boxes[i] = blob_engine == BLOB_COMPONENTS ? job->blobs[i].box : boundingRect(job->hull_list[i]);
+		foreground += job->hull_boxes[i].area();
+	}
+	foreground /= job->filtered_mask.total();
+	tracker.update(job->hull_boxes, &job->hull_tracks);
+	recheck = scheduler.recheck_due(job->milliseconds, foreground, tracker.get_track_count());
+	tracker.select_for_classification(job->hull_tracks, job->frame_number, recheck, &selected);
+	timer.stop(t_track);
+	metrics.set(GAUGE_ACTIVE_TRACKS, tracker.get_track_count());
+
+	if (selected.empty() || (!recheck && !scheduler.within_budget()))	//deferred tracks stay unclassified and are picked again later
+	{
+		return;
+	}
+	if (pending_detections >= MAX_PENDING_DETECTIONS)	//if this stream's classification is falling behind, skip rather than queue more work
+	{
+		skipped_detections++;	//the tracks stay unclassified so they are picked again later
+		metrics.add(COUNTER_DETECTIONS_SKIPPED, 1);
+		return;
+	}
+
+	timer.start(t_shapes);
+	if (blob_engine == BLOB_COMPONENTS)
+	{
+		cd.get_large_shapes(&job->frame, job->filtered_mask.size(), job->blobs, job->blob_runs, selected, max(10 / bgs_scale, 2), bgs_scale,
+			&job->large_shapes, &job->src_shapes, &job->shape_boxes, &shape_hulls);
+	}
+	else
+	{
+		for (i = 0; i < selected.size(); i++)
+		{
+			selected_hulls.push_back(job->hull_list[selected[i]]);
+		}
+		bd.get_large_shapes(&job->frame, &job->filtered_mask, selected_hulls, (int)selected_hulls.size(), max(10 / bgs_scale, 2), bgs_scale,
+			&job->large_shapes, &job->src_shapes, &job->shape_boxes, &shape_hulls);
+	}
+
+	job->shape_tracks.resize(shape_hulls.size());
+	for (i = 0; i < shape_hulls.size(); i++)
+	{
+		job->shape_tracks[i] = job->hull_tracks[selected[shape_hulls[i]]];
+		tracker.mark_pending(job->shape_tracks[i]);
+	}
+	timer.stop(t_shapes);
+
+	if (!job->large_shapes.empty())
+	{
+		pending_detections++;
+		metrics.add(COUNTER_SHAPES, (long long)job->large_shapes.size());
+		metrics.set(GAUGE_PENDING_DETECTIONS, pending_detections);
+		job->run_detection = true;
+	}
+}
+
+/**
+ *  @desc Pipeline stage, draws the contours and hulls for the display. Only added to
+ *  the pipeline when the frames are shown.
  *
- *  @returns 0
+ *  @param FrameJob *job - current frame
+ */
+void BGS::annotate_frame(FrameJob *job)
+{
+	timer.start(t_annotate);
+	if (blob_engine == BLOB_COMPONENTS)
+	{
+		cd.draw_annotations(job->filtered_mask.size(), job->blobs, job->blob_runs, &job->contour_image);
+	}
+	else
+	{
+		bd.draw_annotations(job->filtered_mask.size(), job->contours, job->hull_list, &job->contour_image, NULL);
+	}
+	timer.stop(t_annotate);
+}
+
+/**
+ *  @desc Pipeline sink, runs the PeopleFinder on the shapes of the new and uncertain
+ *  tracks, stores the verdicts with the tracks and records them, then displays the
+ *  frames unless running headless.
+ *
+ *  @param FrameJob *job - current frame
+ *
+ *  @returns false if the user has asked to stop
+ */
+bool BGS::classify_frame(FrameJob *job)
+{
+	frames_in_flight--;
+	clips.add_frame(job->frame);	//before the records, so a clip starting here includes this frame
+	metrics.add(COUNTER_FRAMES, 1);
+	metrics.set(GAUGE_FRAMES_IN_FLIGHT, frames_in_flight);
+	if (job->run_detection)
+	{
+		int64 start_ticks = getTickCount();
+
+		timer.start(t_classify);
+		job->verdicts = pf->test(&job->large_shapes, pool, pool_share, &job->scores);	//shapes are classified in parallel on the pool
+		timer.stop(t_classify);
+		scheduler.record_cost((getTickCount() - start_ticks) * 1000.0 / getTickFrequency());
+
+		for (int i = 0; i < job->verdicts.size(); i++)
+		{
+			tracker.set_verdict(job->shape_tracks[i], job->verdicts[i], job->scores[i], job->frame_number);
+		}
+		classified_shapes += (int)job->verdicts.size();
+		metrics.add(COUNTER_CLASSIFIED, (long long)job->verdicts.size());
+
+		if (log_records)
+		{
+			timer.start(t_log);
+			run_frame_analysis(job);
+			timer.stop(t_log);
+		}
+		pending_detections--;
+		metrics.set(GAUGE_PENDING_DETECTIONS, pending_detections);
+	}
+
+	if (!headless)
+	{
+		timer.start(t_display);
+		imshow("KNN", job->filtered_mask);
+		imshow("Video", job->frame);
+		imshow("Contours", job->contour_image);
+		timer.stop(t_display);
+
+		int c = waitKey(10);
+		if ((char)c == 'c')
+		{
+			live_cam.stop();	//wakes the source if it is waiting for the camera
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ *  @desc Asks every running stream to finish, as if its video had ended, so its record
+ *  log is closed and its report printed. Live sources are woken if they are waiting
+ *  for the camera. Safe to call from any thread, including a console control handler.
+ */
+void BGS::request_stop()
+{
+	stop_requested = true;
+	LiveSource::stop_all();
+}
+
+/**
+ *  @desc Lets streams run again after request_stop(), called as each run starts
+ */
+void BGS::clear_stop_request()
+{
+	stop_requested = false;
+}
+
+bool BGS::is_stop_requested()
+{
+	return stop_requested;
+}
+
+/**
+ *  @desc Limits how many of the shared pool's workers this stream asks for at once
+ *
+ *  @param int share - number of workers, the calling thread always helps as well
+ */
+void BGS::set_pool_share(int share)
+{
+	pool_share = share;
+}
+
+/**
+ *  @desc Prints what the stream cost and did: the time spent in each stage, the
+ *  front end and capture used, the background model's memory, the tracks followed and
+ *  rechecked, and any detections skipped, clips saved or log records dropped. Call
+ *  once run() has returned.
+ */
+void BGS::report()
+{
+	if (!stream_name.empty())
+	{
+		cout << "---Stream " << stream_name << ": " << LiveSource::mask_credentials(video_path) << "---" << endl;
+	}
+	timer.report(frames_processed);
+	cout << "Front end: " << device.describe() << ", " << device.get_device_frames() << " frames on the OpenCL device";
+	if (device.get_switches() > 0)
+	{
+		cout << ", switched " << device.get_switches() << " times";
+	}
+	cout << endl;
+	if (!zone_models.empty())
+	{
+		size_t i, model_bytes = 0;
+
+		for (i = 0; i < zone_models.size(); i++)
+		{
+			model_bytes += zone_models[i]->get_memory_bytes();
+		}
+		cout << "Background model: " << zone_models[0]->get_name() << ", " << model_bytes / 1024 << " KB" << endl;
+	}
+	if (live)
+	{
+		cout << "Live capture: " << live_cam.get_backend_name() << " backend, " << live_cam.get_frames_dropped() << " stale frames dropped, "
+			<< live_cam.get_reconnects() << " reconnections" << endl;
+	}
+	else
+	{
+		cout << "Capture: " << capCam.get_backend_name() << " backend";
+		if (capCam.get_frames_skipped() > 0)
+		{
+			cout << ", " << capCam.get_frames_skipped() << " frames skipped while behind";
+		}
+		cout << endl;
+	}
+	cout << "Tracks: " << tracker.get_tracks_created() << ", shapes classified: " << classified_shapes << endl;
+	cout << "Rechecks: " << scheduler.get_rechecks() << ", deferred for the CPU budget: " << scheduler.get_deferred() << endl;
+	if (skipped_detections > 0)
+	{
+		cout << "Skipped detections: " << skipped_detections << endl;
+	}
+	if (clips.is_enabled())
+	{
+		cout << "Clips: " << clips.get_clips_written() << " written from a " << clips.get_memory_bytes() / (1024 * 1024) << " MB ring";
+		if (clips.get_frames_dropped() > 0)
+		{
+			cout << ", " << clips.get_frames_dropped() << " frames overwritten before they were encoded";
+		}
+		cout << endl;
+	}
+	if (rlog.get_dropped_records() > 0)
+	{
+		cout << "Dropped log records: " << rlog.get_dropped_records() << " (written " << rlog.get_written_records() << ")" << endl;
+	}
+}
+
+/**
+ *  @desc Chooses how the record log saves its images, call before run()
+ *
+ *  @param LogImageFormat format - PNG, JPEG or RAW
+ *  @param int level - PNG compression 0-9 or JPEG quality 0-100
+ */
+void BGS::set_log_format(LogImageFormat format, int level)
+{
+	rlog.set_image_format(format, level);
+}
+
+/**
+ *  @desc Chooses the capture backend and the greyscale and frame skipping modes, call
+ *  before run()
+ *
+ *  @param const CaptureSettings &capture_settings - how the video is decoded
+ */
+void BGS::set_capture(const CaptureSettings &capture_settings)
+{
+	capCam.set_settings(capture_settings);
+}
+
+/**
+ *  @desc Runs background subtraction, noise filtering and contour finding on frames
+ *  shrunk by the given factor, call before run(). The shapes sent to the PeopleFinder
+ *  are cut from the shrunk mask, the source images in the record log stay at full
+ *  resolution.
+ *
+ *  @param int scale - 1 (full resolution), 2 or 4
+ */
+void BGS::set_bgs_scale(int scale)
+{
+	bgs_scale = scale < 1 ? 1 : scale;
+}
+
+/**
+ *  @desc Chooses whether background subtraction and noise filtering run on the OpenCL
+ *  device, call before run()
+ *
+ *  @param AccelMode mode - CPU, OpenCL or automatic
+ */
+void BGS::set_accel_mode(AccelMode mode)
+{
+	device.set_mode(mode);
+}
+
+/**
+ *  @desc Chooses the background model each zone is subtracted with, call before run()
+ *
+ *  @param BackgroundEngine engine - KNN or ViBe
+ */
+void BGS::set_background_engine(BackgroundEngine engine)
+{
+	background_engine = engine;
+}
+
+/**
+ *  @desc Chooses how the blobs are found in the mask, call before run()
+ *
+ *  @param BlobEngine engine - contours and hulls, or connected components
+ */
+void BGS::set_blob_engine(BlobEngine engine)
+{
+	blob_engine = engine;
+}
+
+/**
+ *  @desc Analyses only part of the video, call before run(). The frames from
+ *  first_frame - warmup_frames are decoded and background subtracted so the models
+ *  are primed, but only the frames from first_frame are searched for blobs, tracked
+ *  and logged. The logged frame numbers and timestamps are those of the whole video.
+ *
+ *  @param int first_frame - first frame to analyse, from 0
+ *  @param int end_frame - one past the last frame to analyse, 0 for the end of the video
+ *  @param int warmup_frames - frames before first_frame to prime the models with
+ */
+void BGS::set_frame_range(int first_frame, int end_frame, int warmup_frames)
+{
+	range_first = first_frame;
+	range_end = end_frame;
+	range_warmup = warmup_frames;
+}
+
+/**
+ *  @desc Chooses whether the record log writes its HTML table when the run ends
+ */
+void BGS::set_html_view(bool enabled)
+{
+	rlog.set_html_view(enabled);
+}
+
+/**
+ *  @desc Saves a clip around every pedestrian, call before run()
+ *
+ *  @param double before - seconds of video kept from before the pedestrian was found
+ *  @param double after - seconds recorded afterwards, both 0 for no clips
+ */
+void BGS::set_clip_length(double before, double after)
+{
+	clips.set_length(before, after);
+}
+
+/**
+ *  @desc Chooses whether the classified shapes are written to the record log. Without
+ *  the records the verdicts are only kept by the tracker, for get_pedestrian_boxes().
+ */
+void BGS::set_log_records(bool enabled)
+{
+	log_records = enabled;
+}
+
+/**
+ *  @desc The hulls of a frame whose tracks have been judged pedestrians, call once
+ *  the frame has been through classify_frame()
+ *
+ *  @param const FrameJob &job - an analysed frame
+ *  @param vector<Rect> *boxes - filled with the pedestrians' boxes in full resolution frame coordinates
+ */
+void BGS::get_pedestrian_boxes(const FrameJob &job, vector<Rect> *boxes)
+{
+	Verdict verdict;
+	int score, i;
+
+	boxes->clear();
+	for (i = 0; i < job.hull_boxes.size() && i < job.hull_tracks.size(); i++)
+	{
+		if (tracker.get_verdict(job.hull_tracks[i], &verdict, &score) && verdict == VERDICT_PEDESTRIAN)
+		{
+			boxes->push_back(Rect(job.hull_boxes[i].x * bgs_scale, job.hull_boxes[i].y * bgs_scale,
+				job.hull_boxes[i].width * bgs_scale, job.hull_boxes[i].height * bgs_scale));
+		}
+	}
+}
+
+/**
+ *  @desc The name of the record log files, within the record_log directory, once run()
+ *  has started
+ */
+string BGS::get_log_name()
+{
+	return rlog.get_log_name();
+}
+
+/**
+ *  @desc Creates a background model of the chosen engine with this stream's settings.
+ *  Models that can are given the noise filter kernels and this stream's share of the
+ *  pool.
+ *
+ *  @returns Ptr<BackgroundModel> - model for one zone
+ */
+Ptr<BackgroundModel> BGS::create_background_model()
+{
+	Ptr<BackgroundModel> model = BackgroundModel::create(background_engine, bgs_history, bgs_threshold);
+
+	model->set_noise_filter(close_kernel, open_kernel);
+	model->set_pool(pool, pool_share);
+	return model;
+}
+
+/**
+ *  @desc Chooses the scheduler's latency/CPU trade-off, call before run()
+ *
+ *  @param ScheduleProfile profile - low latency, balanced or low CPU
+ */
+void BGS::set_schedule_profile(ScheduleProfile profile)
+{
+	scheduler.set_profile(profile);
+}
+
+int BGS::get_frames_processed()
+{
+	return frames_processed;
+}
+
+int BGS::get_skipped_detections()
+{
+	return skipped_detections;
+}
+
+/**
+ *  @desc The stream's live figures, for registering with a MetricsServer
+ */
+StreamMetrics *BGS::get_metrics()
+{
+	return &metrics;
+}
+
+/**
+ *  @desc Queues a new record for each classified shape in the record log. Only new and
+ *  uncertain tracks are classified, so a shape that stays in view is logged once
+ *  rather than every second. A pedestrian's record is given the clip around it.
+ *
+ *  @param FrameJob *job - a detection frame after classification
  */
-void BGS::run_frame_analysis(int frame_num, int milliseconds, vector<Mat> src_shapes, vector<Mat> large_shapes, vector<string> verdicts)
+void BGS::run_frame_analysis(FrameJob *job)
 {
-	int i = 0;
+	int i = 0, clip_number;
 
-	while (large_shapes[i].rows != 0)
+	while (i < job->large_shapes.size() && job->large_shapes[i].rows != 0)
 	{
-		rlog.new_record(frame_num, milliseconds, src_shapes[i], large_shapes[i], verdicts[i]);
+		clip_number = job->verdicts[i] == VERDICT_PEDESTRIAN ? clips.trigger() : 0;	//0 when the clips are off
+		rlog.new_record(job->frame_number, job->milliseconds, job->src_shapes[i], job->large_shapes[i], job->verdicts[i],
+			job->shape_boxes[i], job->scores[i], job->shape_tracks[i], clip_number);	//dropped records are counted by the log
 		i++;
 	}
 }
 
 /**
  *  @desc Filters speckle noise from the BGS frame. Using a closing operation
- *  followed by an opening operation.
+ *  followed by an opening operation. The kernels are built once in the constructor.
  *
  *  @param Mat *fgmask - current frame in BGS
  *
@@ -130,11 +884,9 @@ void BGS::run_frame_analysis(int frame_num, int milliseconds, vector<Mat> src_sh
  */
 Mat BGS::filter_noise(Mat *fgmask)
 {
-	Mat elem1, elem2, filteredMask, filteredMask2;
-	elem1 = getStructuringElement(MORPH_RECT, Size(5, 5));
-	elem2 = getStructuringElement(MORPH_RECT, Size(3, 3));
-	filteredMask = dilate_first(fgmask, &elem1);
-	filteredMask2 = erode_first(&filteredMask, &elem2);
+	Mat filteredMask, filteredMask2;
+	filteredMask = dilate_first(fgmask, &close_kernel);
+	filteredMask2 = erode_first(&filteredMask, &open_kernel);
 	return filteredMask2;
 }
 
@@ -11,22 +11,107 @@
 #include "opencv2/videoio.hpp"
 #include "peoplefinder.h"
 #include "blobdetector.h"
+#include "componentdetector.h"
 #include "recordlog.h"
+#include "stagetimer.h"
+#include "framejob.h"
+#include "framepipeline.h"
+#include "zonemask.h"
+#include "shapetracker.h"
+#include "detectionscheduler.h"
+#include "capturesource.h"
+#include "livesource.h"
+#include "deviceselector.h"
+#include "backgroundmodel.h"
+#include "streammetrics.h"
+#include "cliprecorder.h"
+
+#define MAX_PENDING_DETECTIONS 2	//detection frames a stream can have waiting before it skips new ones
 
 class BGS
 {
 	private:
 		RecordLog rlog;
-		string training_path;
+		string stream_name;
 		string video_path;
 		int bgs_history;
 		double bgs_threshold;
+		bool headless;
+
+		CaptureSource capCam;
+		LiveSource live_cam;		//used instead of capCam for RTSP/HTTP cameras
+		bool live;
+		int live_dropped;			//live frames dropped and reconnections already counted in the metrics
+		int live_reconnects;
+		vector<Ptr<BackgroundModel>> zone_models;	//one background model per active zone
+		BackgroundEngine background_engine;
+		ZoneMask zone_mask;
+		int bgs_scale;				//factor the frames are shrunk by for background subtraction
+		Size bgs_size;				//size of the shrunk frames
+		vector<Rect> bgs_zones;		//active zones in the shrunk frames
+		DeviceSelector device;		//runs subtraction and filtering on the OpenCL device or the CPU
+		Mat close_kernel;
+		Mat open_kernel;
+		BlobDetector bd;
+		ComponentDetector cd;		//used instead of bd with BLOB_COMPONENTS
+		BlobEngine blob_engine;
+		ShapeTracker tracker;
+		ClipRecorder clips;			//recent frames and the clips around pedestrians, off unless set_clip_length() is called
+		DetectionScheduler scheduler;
+		PeopleFinder *pf;			//shared by every stream
+		ThreadPool *pool;			//shared by every stream
+		int pool_share;				//most pool workers this stream may use at once
+		atomic<int> pending_detections;
+		int skipped_detections;
+		int frames_processed;
+		atomic<int> frames_in_flight;	//decoded but not yet through the sink
+		int classified_shapes;
+		int range_first;			//first frame analysed when only part of the video is, see set_frame_range()
+		int range_end;				//one past the last frame analysed, 0 for the whole video
+		int range_warmup;			//frames before range_first that only prime the background models
+		bool log_records;			//false when the verdicts are only wanted by the caller, see set_log_records()
+
+		StageTimer timer;
+		StreamMetrics metrics;		//live figures for the MetricsServer
+		static atomic<bool> stop_requested;	//set by request_stop(), ends every stream
+
+		int t_decode, t_grey, t_scale, t_model, t_filter, t_contours, t_track, t_shapes, t_annotate, t_classify, t_log, t_display;
 
 	public :
-		BGS(string t_path, string v_path, int history, double thresh);
+		BGS(string name, string v_path, int history, double thresh, bool no_display, PeopleFinder *shared_pf, ThreadPool *shared_pool);
 		int run();
-		void run_frame_analysis(int frame_num, int milliseconds, vector<Mat> src_shapes, vector<Mat> large_shapes, vector<string> verdicts);
+		static void request_stop();
+		static void clear_stop_request();
+		static bool is_stop_requested();
+		void prepare(const Mat &first_frame);
+		bool analyse_frame(FrameJob *job);
+		void set_pool_share(int share);
+		void set_log_format(LogImageFormat format, int level);
+		void set_schedule_profile(ScheduleProfile profile);
+		void set_capture(const CaptureSettings &capture_settings);
+		void set_bgs_scale(int scale);
+		void set_accel_mode(AccelMode mode);
+		void set_background_engine(BackgroundEngine engine);
+		void set_blob_engine(BlobEngine engine);
+		void set_frame_range(int first_frame, int end_frame, int warmup_frames);
+		void set_html_view(bool enabled);
+		void set_clip_length(double before, double after);
+		void set_log_records(bool enabled);
+		void get_pedestrian_boxes(const FrameJob &job, vector<Rect> *boxes);
+		string get_log_name();
+		Ptr<BackgroundModel> create_background_model();
+		void report();
+		int get_frames_processed();
+		int get_skipped_detections();
+		StreamMetrics *get_metrics();
+		bool decode_frame(FrameJob *job);
+		void subtract_background(FrameJob *job);
+		void extract_blobs(FrameJob *job);
+		void annotate_frame(FrameJob *job);
+		bool classify_frame(FrameJob *job);
+		void run_frame_analysis(FrameJob *job);
 		Mat filter_noise(Mat *fgmask);
+		void subtract_zone_on_device(FrameJob *job, int zone, Rect frame_zone);
 		Mat erode_first(Mat *srcimg, Mat *element);
 		Mat dilate_first(Mat *srcimg, Mat *element);
 };
@@ -6,16 +6,25 @@
  *  images. Applies convex hulls to the contours to distinguish larger shapes which are saved
  *  and sent to the PeopleFinder.
  *
- *  @param vector<Mat> src_shapes - the source images of the larger shapes
+ *  @param ShapeCanvasPool canvas_pool - reusable 64x128 images for the larger shapes
  *
  *	@author Alex O'Donnell
  *	@version 1.00
  */
 
-BlobDetector::BlobDetector(vector<Mat> src_shapes)
-	: src_shapes(src_shapes)
+BlobDetector::BlobDetector()
+	: hull_size(0), canvas_pool(Size(SHAPE_CANVAS_COLS, SHAPE_CANVAS_ROWS), CV_8UC3, 32), min_hull_area(300)
 {}
 
+/**
+ *  @desc Sets the smallest contour area, in mask pixels, that gets a hull. Masks made
+ *  at a reduced scale need a proportionally smaller area.
+ */
+void BlobDetector::set_min_hull_area(double area)
+{
+	min_hull_area = area;
+}
+
 /**
  *  @desc Highlights contours and applies OpenCV's convexHull function. Using the area
  *  of the hulls the larger shapes are extracted.
@@ -28,77 +37,92 @@ BlobDetector::BlobDetector(vector<Mat> src_shapes)
  */
 Mat BlobDetector::highlight_contours(Mat *frame, Mat *fgmask, Mat *contoursonly)
 {
-	hull_size = 0;
+	return highlight_contours(frame, fgmask, contoursonly, vector<Rect>(1, Rect(0, 0, fgmask->cols, fgmask->rows)));
+}
+
+/**
+ *  @desc Highlights contours inside the given zones only and applies OpenCV's convexHull
+ *  function, then draws them with draw_annotations().
+ *
+ *  @param Mat *frame - the source frame
+ *  @param Mat *fgmask - the BGS frame
+ *  @param Mat *contoursonly - the contour frame
+ *  @param const vector<Rect> &zones - areas of the frame to search
+ *
+ *  @returns Mat drawn_contours - contour data for drawing process
+ */
+Mat BlobDetector::highlight_contours(Mat *frame, Mat *fgmask, Mat *contoursonly, const vector<Rect> &zones)
+{
 	Mat drawn_contours;
-	RNG rng(12345);
 	vector<vector<Point>> contours;
-	vector<Vec4i> hierarchy;
 
-	findContours(*fgmask, contours, hierarchy, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE, Point(0, 0));
-	vector<vector<Point>> local_hull_list(contours.size());
+	hull_size = find_hulls(fgmask, zones, &contours, &hull_list);
+	draw_annotations(frame->size(), contours, hull_list, &drawn_contours, contoursonly);
 
-	for (int i = 0; i < contours.size(); i++)
+	return drawn_contours;
+}
+
+/**
+ *  @desc Finds the contours inside the given zones and the convex hulls of the larger
+ *  ones. Contours are found per zone and offset back into frame coordinates, so the zones
+ *  must not overlap. Nothing is drawn, see draw_annotations().
+ *
+ *  @param Mat *fgmask - the BGS frame
+ *  @param const vector<Rect> &zones - areas of the frame to search
+ *  @param vector<vector<Point>> *contours - x/y positions of each end of the contour lines
+ *  @param vector<vector<Point>> *hulls - x/y positions of each end of the hulls of the larger shapes
+ *
+ *  @returns int - number of hulls
+ */
+int BlobDetector::find_hulls(Mat *fgmask, const vector<Rect> &zones, vector<vector<Point>> *contours, vector<vector<Point>> *hulls)
+{
+	int hulls_found = 0;
+
+	contours->clear();
+	for (int z = 0; z < zones.size(); z++)
 	{
-		if (contourArea(contours[i]) > 300) //threshold for the number of contours to be drawn, excludes smaller shapes
+		findContours((*fgmask)(zones[z]), zone_contours, zone_hierarchy, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE, zones[z].tl());
+		for (int i = 0; i < zone_contours.size(); i++)
 		{
-			convexHull(Mat(contours[i]), local_hull_list[hull_size], false);
-			hull_size++;
+			contours->push_back(move(zone_contours[i]));
 		}
 	}
 
-	drawn_contours = Mat::zeros(frame->size() , CV_8UC3);
-	*contoursonly = Mat::zeros(frame->size(), CV_8UC3);
-	for (int i = 0; i< contours.size(); i++)
+	hulls->resize(contours->size());
+	for (int i = 0; i < contours->size(); i++)
 	{
-		draw_annotations(frame, &drawn_contours, contoursonly, contours, hierarchy, local_hull_list, i);
+		if (contourArea((*contours)[i]) > min_hull_area) //threshold for the number of contours to be drawn, excludes smaller shapes
+		{
+			convexHull((*contours)[i], (*hulls)[hulls_found], false);
+			hulls_found++;
+		}
 	}
+	hulls->resize(hulls_found);
 
-	hull_list = local_hull_list;
-
-	return drawn_contours;
+	return hulls_found;
 }
 
-
 /**
- *  @desc Draws the contour information on the different frames 
+ *  @desc Draws the contour information on the different frames, every contour and hull
+ *  in one pass. Only needed when something will show the frames.
  *
- *  @param Mat *frame - the source frame
- *  @param Mat *drawn_contours - the contour data
- *  @param Mat *contoursonly - visualisation of the contours
- *  @param vector<vector<Point>> contours - x/y positions of each end of the contour lines
- *  @param vector<Vec4i> hierachy - information on image topology
- *  @param vector<vector<Point>> - x/y positions of each end of the hull
- *  @param int i - current contour
+ *  @param Size frame_size - size of the source frame
+ *  @param const vector<vector<Point>> &contours - x/y positions of each end of the contour lines
+ *  @param const vector<vector<Point>> &hulls - x/y positions of each end of the hulls
+ *  @param Mat *drawn_contours - the contours and hulls
+ *  @param Mat *contoursonly - visualisation of the contours, may be NULL
  */
-void BlobDetector::draw_annotations(Mat *frame, Mat *drawn_contours, Mat *contoursonly, vector<vector<Point>> contours, vector<Vec4i> hierarchy, vector<vector<Point>> hull, int i)
+void BlobDetector::draw_annotations(Size frame_size, const vector<vector<Point>> &contours, const vector<vector<Point>> &hulls, Mat *drawn_contours, Mat *contoursonly)
 {
-	drawContours(*drawn_contours,
-		contours,
-		i,
-		Scalar(0, 0, 255),
-		1,
-		8,
-		hierarchy,
-		0,
-		Point());
-	drawContours(*contoursonly,
-		contours,
-		i,
-		Scalar(0, 0, 255),
-		1,
-		8,
-		hierarchy,
-		0,
-		Point());
-	drawContours(*drawn_contours,
-		hull,
-		i,
-		Scalar(255, 0, 255),
-		1,
-		8,
-		hierarchy,
-		0,
-		Point());
+	*drawn_contours = Mat::zeros(frame_size, CV_8UC3);
+	drawContours(*drawn_contours, contours, -1, Scalar(0, 0, 255), 1, 8);
+	drawContours(*drawn_contours, hulls, -1, Scalar(255, 0, 255), 1, 8);
+
+	if (contoursonly != NULL)
+	{
+		*contoursonly = Mat::zeros(frame_size, CV_8UC3);
+		drawContours(*contoursonly, contours, -1, Scalar(0, 0, 255), 1, 8);
+	}
 }
 
 
@@ -107,50 +131,52 @@ void BlobDetector::draw_annotations(Mat *frame, Mat *drawn_contours, Mat *contou
  *  resizes them to make them compatible with PeopleFinder. Reapplies the contours after resizing 
  *  to prevent distortion
  *
+ *  The source images are ROI headers into the source frame rather than copies, and the
+ *  64x128 shapes are drawn on canvases from the pool, so the only allocations are new
+ *  canvases while the earlier ones are still in use elsewhere. Hulls too close to the
+ *  top or left edge to cut out are skipped, the outputs only hold the shapes found.
+ *
+ *  The shapes for the PeopleFinder are cut from the mask at whatever scale it was made,
+ *  while the source images and boxes are always at the full resolution of the frame.
+ *
  *  @param Mat *src_image - the source frame
  *  @param Mat *filtered_mask - the BGS frame
- *  @param vector<vector<Point>> hull - x/y positions of each end of the hull
+ *  @param const vector<vector<Point>> &hull - x/y positions of each end of the hull
  *  @param int hullsize - number of hulls in the current image
  *  @param int edge_space - space between the shape and the edge of the image
- *
- *  @returns vector<Mat> shapes - larger shapes
+ *  @param int mask_scale - factor the mask is shrunk by from the source frame, the hulls
+ *  are in mask coordinates and are scaled up for the source images and boxes
+ *  @param vector<Mat> *shapes - larger shapes
+ *  @param vector<Mat> *src_shapes - the source images of the larger shapes
+ *  @param vector<Rect> *shape_boxes - position of each larger shape in the frame
+ *  @param vector<int> *shape_hulls - index of the hull each shape came from, may be NULL
  */
-vector<Mat> BlobDetector::get_large_shapes(Mat *src_image, Mat *filtered_mask, vector<vector<Point>> hull, int hullsize, int edge_space)
+void BlobDetector::get_large_shapes(Mat *src_image, Mat *filtered_mask, const vector<vector<Point>> &hull, int hullsize, int edge_space, int mask_scale,
+	vector<Mat> *shapes, vector<Mat> *src_shapes, vector<Rect> *shape_boxes, vector<int> *shape_hulls)
 {
-	vector<Mat> shapes(30), bg_shapes(30);
-	Point topleft = Point(filtered_mask->rows,filtered_mask->cols);
-	Point botright = Point(0,0);
-	Rect roi;
-	Mat localsrc = *src_image;
-	Mat localfilter = *filtered_mask;
-	vector<vector<Point>> contours;
-	vector<Vec4i> hierarchy;
+	Point topleft, botright;
+	Rect roi, src_roi;
+	Mat canvas;
+
+	shapes->clear();
+	src_shapes->clear();
+	shape_boxes->clear();
+	if (shape_hulls != NULL)
+	{
+		shape_hulls->clear();
+	}
 
 	for (int i = 0; i < hullsize; i++)
 	{
+		topleft = Point(filtered_mask->rows, filtered_mask->cols);
+		botright = Point(0, 0);
 		for (int k = 0; k < hull[i].size(); k++) 
 		{
-			if (hull[i][k].x < topleft.x)
-			{
-				topleft.x = hull[i][k].x;
-			}
-
-			if (hull[i][k].x > botright.x)
-			{
-				botright.x = hull[i][k].x;
-			}
-
-			if (hull[i][k].y < topleft.y)
-			{
-				topleft.y = hull[i][k].y;
-			}
-
-			if (hull[i][k].y > botright.y)
-			{
-				botright.y = hull[i][k].y;
-			}
+			topleft.x = min(topleft.x, hull[i][k].x);
+			topleft.y = min(topleft.y, hull[i][k].y);
+			botright.x = max(botright.x, hull[i][k].x);
+			botright.y = max(botright.y, hull[i][k].y);
 		}
-		//rectangle(*filtered_mask, topleft, botright, Vec3b(255, 255, 255));
 
 		if (botright.x != 0 && topleft.x != 0)	
 		{
@@ -163,27 +189,24 @@ vector<Mat> BlobDetector::get_large_shapes(Mat *src_image, Mat *filtered_mask, v
 				botright.y += edge_space;
 			}
 			roi = Rect(topleft.x, topleft.y, botright.x - topleft.x, botright.y - topleft.y);
-			src_shapes[i] = localsrc(roi);	//GET THE SOURCE OF THE SHAPE FOR THE RECORD
-			resize(localfilter(roi), bg_shapes[i], Size(64, 128));
+			resize((*filtered_mask)(roi), resized_mask, Size(SHAPE_CANVAS_COLS, SHAPE_CANVAS_ROWS));
+
+			findContours(resized_mask, shape_contours, shape_hierarchy, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE, Point(0, 0));	//draw contours around the image again for clearer outlines.
+			canvas = canvas_pool.acquire();
+			drawContours(canvas, shape_contours, -1, Scalar(0, 0, 255), 1, 8);
+
+			src_roi = Rect(roi.x * mask_scale, roi.y * mask_scale, roi.width * mask_scale, roi.height * mask_scale) &
+				Rect(0, 0, src_image->cols, src_image->rows);
 
-			findContours(bg_shapes[i], contours, hierarchy, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE, Point(0, 0));	//draw contours around the image again for clearer outlines.
-			shapes[i] = Mat::zeros(bg_shapes[i].size(), CV_8UC3);
-			for (int n = 0; n < contours.size(); n++)
+			shapes->push_back(canvas);
+			src_shapes->push_back((*src_image)(src_roi));	//GET THE SOURCE OF THE SHAPE FOR THE RECORD
+			shape_boxes->push_back(src_roi);
+			if (shape_hulls != NULL)
 			{
-				drawContours(shapes[i], contours, n, Scalar(0, 0, 255), 1, 8, hierarchy, 0, Point());
+				shape_hulls->push_back(i);
 			}
 		}
-
-		topleft = Point(filtered_mask->rows, filtered_mask->cols);
-		botright = Point(0, 0);
 	}
-
-	return shapes;
-}
-
-vector<Mat> BlobDetector::get_src_shapes()
-{
-	return src_shapes;
 }
 
 bool BlobDetector::is_within_bound(Point node, int x_bound, int y_bound)
@@ -191,7 +214,7 @@ bool BlobDetector::is_within_bound(Point node, int x_bound, int y_bound)
 	return (node.x >= 0 && node.x < x_bound && node.y >= 0 && node.y < y_bound);
 }
 
-vector<vector<Point>> BlobDetector::get_hull_list()
+const vector<vector<Point>>& BlobDetector::get_hull_list()
 {
 	return hull_list;
 }
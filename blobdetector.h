@@ -7,6 +7,8 @@
 #include "opencv2/imgcodecs.hpp"
 #include "opencv2/imgproc.hpp"
 #include "opencv2/videoio.hpp"
+#include "shapecanvaspool.h"
+#include "shapecanvas.h"
 
 using namespace std;
 using namespace cv;
@@ -16,16 +18,25 @@ class BlobDetector
 	private:
 		vector<vector<Point>> hull_list;
 		int hull_size;
-		vector<Mat> src_shapes;
+		ShapeCanvasPool canvas_pool;			//64x128 canvases for the shapes
+		Mat resized_mask;						//scratch space reused by each shape
+		vector<vector<Point>> shape_contours;
+		vector<Vec4i> shape_hierarchy;
+		vector<vector<Point>> zone_contours;
+		vector<Vec4i> zone_hierarchy;
+		double min_hull_area;					//contours smaller than this get no hull
 
 	public:
-		BlobDetector(vector<Mat> src_shapes);
+		BlobDetector();
+		void set_min_hull_area(double area);
 		Mat highlight_contours(Mat *frame, Mat *fgmask, Mat *contoursonly);
-		void draw_annotations(Mat * frame, Mat * drawn_contours, Mat *contoursonly, vector<vector<Point>> contours, vector<Vec4i> hierarchy, vector<vector<Point>> hull, int i);
-		vector<Mat> get_large_shapes(Mat *src_image, Mat * filtered_mask, vector<vector<Point>> hull, int hullsize, int edge_space);
-		vector<Mat> get_src_shapes();
+		Mat highlight_contours(Mat *frame, Mat *fgmask, Mat *contoursonly, const vector<Rect> &zones);
+		int find_hulls(Mat *fgmask, const vector<Rect> &zones, vector<vector<Point>> *contours, vector<vector<Point>> *hulls);
+		void draw_annotations(Size frame_size, const vector<vector<Point>> &contours, const vector<vector<Point>> &hulls, Mat *drawn_contours, Mat *contoursonly);
+		void get_large_shapes(Mat *src_image, Mat * filtered_mask, const vector<vector<Point>> &hull, int hullsize, int edge_space, int mask_scale,
+			vector<Mat> *shapes, vector<Mat> *src_shapes, vector<Rect> *shape_boxes, vector<int> *shape_hulls);
 		bool is_within_bound(Point node, int x_bound, int y_bound);
-		vector<vector<Point>> get_hull_list();
+		const vector<vector<Point>>& get_hull_list();
 		int get_hull_size();
 };
 
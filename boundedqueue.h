@@ -0,0 +1,137 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+/**
+ *	@file boundedqueue.h
+ *  @desc Fixed capacity FIFO queue shared between two threads. Producers block when
+ *  the queue is full and consumers block when it is empty, which stops a fast stage
+ *  from running too far ahead of a slow one. Once closed, producers are turned away
+ *  and consumers drain whatever is left.
+ *
+ *  @param size_t capacity - maximum number of items held at once
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+template <typename T>
+class BoundedQueue
+{
+	private:
+		deque<T> items;
+		size_t capacity;
+		bool closed;
+		mutex lock;
+		condition_variable not_empty;
+		condition_variable not_full;
+
+	public:
+		BoundedQueue(size_t cap)
+			: capacity(cap), closed(false)
+		{}
+
+		/**
+		 *  @desc Adds an item, waiting for space if the queue is full
+		 *
+		 *  @returns false if the queue was closed before the item could be added
+		 */
+		bool push(T item)
+		{
+			unique_lock<mutex> guard(lock);
+			not_full.wait(guard, [this] { return closed || items.size() < capacity; });
+			if (closed)
+			{
+				return false;
+			}
+			items.push_back(move(item));
+			not_empty.notify_one();
+			return true;
+		}
+
+		/**
+		 *  @desc Adds an item only if there is space available
+		 *
+		 *  @returns false if the queue is full or closed
+		 */
+		bool try_push(T item)
+		{
+			lock_guard<mutex> guard(lock);
+			if (closed || items.size() >= capacity)
+			{
+				return false;
+			}
+			items.push_back(move(item));
+			not_empty.notify_one();
+			return true;
+		}
+
+		/**
+		 *  @desc Removes the oldest item, waiting for one if the queue is empty
+		 *
+		 *  @returns false once the queue is closed and empty
+		 */
+		bool pop(T *item)
+		{
+			unique_lock<mutex> guard(lock);
+			not_empty.wait(guard, [this] { return closed || !items.empty(); });
+			if (items.empty())
+			{
+				return false;
+			}
+			*item = move(items.front());
+			items.pop_front();
+			not_full.notify_one();
+			return true;
+		}
+
+		/**
+		 *  @desc Removes the oldest item only if one is waiting
+		 *
+		 *  @returns false if the queue is empty
+		 */
+		bool try_pop(T *item)
+		{
+			lock_guard<mutex> guard(lock);
+			if (items.empty())
+			{
+				return false;
+			}
+			*item = move(items.front());
+			items.pop_front();
+			not_full.notify_one();
+			return true;
+		}
+
+		/**
+		 *  @desc Stops accepting new items and wakes any waiting threads
+		 */
+		void close()
+		{
+			lock_guard<mutex> guard(lock);
+			closed = true;
+			not_empty.notify_all();
+			not_full.notify_all();
+		}
+
+		/**
+		 *  @desc Accepts items again after close(), any items left are kept
+		 */
+		void reopen()
+		{
+			lock_guard<mutex> guard(lock);
+			closed = false;
+		}
+
+		size_t size()
+		{
+			lock_guard<mutex> guard(lock);
+			return items.size();
+		}
+};
+
+#endif
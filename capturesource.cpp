@@ -0,0 +1,211 @@
+#include "capturesource.h"
+
+/**
+ *	@file capturesource.cpp
+ *  @desc Wraps the VideoCapture so a stream can choose how its video is decoded.
+ *
+ *  In greyscale mode the capture is asked for unconverted frames. Backends that honour
+ *  this hand back the luma plane (or packed YUYV, whose luma is picked out directly),
+ *  skipping the YUV to BGR conversion altogether. Backends that always convert, such as
+ *  FFmpeg, have their frame converted to greyscale once here. Either way only the grey
+ *  frame is passed on.
+ *
+ *  skip() grabs the next frame without retrieving it, so the frame is demuxed and
+ *  decoded (which the following frames depend on) but never converted or copied.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+CaptureSource::CaptureSource()
+	: opened_api(CAP_ANY), raw_frames(false), frames_skipped(0)
+{}
+
+/**
+ *  @desc Chooses the backend and modes, call before open()
+ */
+void CaptureSource::set_settings(const CaptureSettings &capture_settings)
+{
+	settings = capture_settings;
+}
+
+const CaptureSettings& CaptureSource::get_settings()
+{
+	return settings;
+}
+
+/**
+ *  @desc Opens the video with the first backend that can read it, in the order of
+ *  preference for the chosen backend
+ *
+ *  @param const string &path - path or URL of the video
+ *
+ *  @returns false if no backend could open the video
+ */
+bool CaptureSource::open(const string &path)
+{
+	vector<int> apis;
+	int i;
+
+	if (settings.backend == CAPTURE_HARDWARE)
+	{
+#ifdef _WIN32
+		apis.push_back(CAP_MSMF);
+#else
+		apis.push_back(CAP_GSTREAMER);
+#endif
+	}
+	if (settings.backend == CAPTURE_HARDWARE || settings.backend == CAPTURE_FFMPEG)
+	{
+		apis.push_back(CAP_FFMPEG);
+	}
+	apis.push_back(CAP_ANY);
+
+	frames_skipped = 0;
+	raw_frames = false;
+	for (i = 0; i < apis.size(); i++)
+	{
+		if (capture.open(path, apis[i]))
+		{
+			opened_api = apis[i];
+			break;
+		}
+	}
+	if (!capture.isOpened())
+	{
+		return false;
+	}
+	if (i > 0)
+	{
+		cout << "Capture backend unavailable, using " << get_backend_name() << endl;
+	}
+
+	if (settings.grey_only)
+	{
+		raw_frames = capture.set(CAP_PROP_CONVERT_RGB, 0);	//false when the backend always converts
+	}
+	return true;
+}
+
+/**
+ *  @desc Reads the next frame. In greyscale mode frame and grey are the same image,
+ *  otherwise grey is left empty and the stages convert the parts they need.
+ *
+ *  @param Mat *frame - the colour frame, or the grey frame in greyscale mode
+ *  @param Mat *grey - the grey frame in greyscale mode
+ *
+ *  @returns false once the video has finished
+ */
+bool CaptureSource::read(Mat *frame, Mat *grey)
+{
+	Mat decoded;
+
+	if (!settings.grey_only)
+	{
+		*grey = Mat();
+		return capture.read(*frame) && !frame->empty();
+	}
+
+	if (!capture.read(decoded) || decoded.empty())
+	{
+		return false;
+	}
+
+	if (raw_frames && (decoded.cols != (int)capture.get(CAP_PROP_FRAME_WIDTH) || decoded.rows != (int)capture.get(CAP_PROP_FRAME_HEIGHT)))
+	{
+		raw_frames = false;	//a still encoded buffer, such as MJPEG, go back to converted frames
+		capture.set(CAP_PROP_CONVERT_RGB, 1);
+		if (!capture.read(decoded) || decoded.empty())
+		{
+			return false;
+		}
+	}
+
+	if (decoded.channels() == 1)	//already the luma plane
+	{
+		*grey = decoded;
+	}
+	else if (raw_frames && decoded.channels() == 2)
+	{
+		cvtColor(decoded, *grey, COLOR_YUV2GRAY_YUY2);
+	}
+	else
+	{
+		cvtColor(decoded, *grey, decoded.channels() == 4 ? COLOR_BGRA2GRAY : COLOR_BGR2GRAY);
+	}
+	*frame = *grey;
+	return true;
+}
+
+/**
+ *  @desc Drops the next frame without converting it
+ *
+ *  @returns false once the video has finished
+ */
+bool CaptureSource::skip()
+{
+	if (!capture.grab())
+	{
+		return false;
+	}
+	frames_skipped++;
+	return true;
+}
+
+/**
+ *  @desc Moves to a frame so the next read() returns it. There is no slow fallback of
+ *  grabbing from the start, a caller that can't seek should read the video in order.
+ *
+ *  @param int frame - index of the frame, from 0
+ *
+ *  @returns false if the backend can't seek to exactly that frame
+ */
+bool CaptureSource::seek(int frame)
+{
+	return capture.set(CAP_PROP_POS_FRAMES, frame) && (int)capture.get(CAP_PROP_POS_FRAMES) == frame;
+}
+
+double CaptureSource::get(int property)
+{
+	return capture.get(property);
+}
+
+/**
+ *  @desc Sets a property of the open capture
+ *
+ *  @returns false if the backend doesn't support the property
+ */
+bool CaptureSource::set(int property, double value)
+{
+	return capture.set(property, value);
+}
+
+bool CaptureSource::is_open()
+{
+	return capture.isOpened();
+}
+
+void CaptureSource::release()
+{
+	capture.release();
+}
+
+string CaptureSource::get_backend_name()
+{
+	switch (opened_api)
+	{
+		case CAP_FFMPEG:
+			return "FFmpeg";
+		case CAP_MSMF:
+			return "Media Foundation";
+		case CAP_GSTREAMER:
+			return "GStreamer";
+		default:
+			return "default";
+	}
+}
+
+int CaptureSource::get_frames_skipped()
+{
+	return frames_skipped;
+}
@@ -0,0 +1,80 @@
+#ifndef CAPTURESOURCE_H
+#define CAPTURESOURCE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "opencv2/core.hpp"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/videoio.hpp"
+
+using namespace std;
+using namespace cv;
+
+#define CAPTURE_SKIP_BACKLOG 8		//frames in flight before the skipping mode starts dropping frames
+#define CAPTURE_MAX_SKIP 4			//most frames dropped before each frame that is decoded
+
+/**
+ *  @desc Which of OpenCV's capture backends to decode with
+ */
+enum CaptureBackend
+{
+	CAPTURE_DEFAULT,		//whatever OpenCV picks for the file
+	CAPTURE_FFMPEG,			//FFmpeg, which decodes with a thread per core
+	CAPTURE_HARDWARE		//Media Foundation on Windows, GStreamer elsewhere, both use the GPU decoder where there is one
+};
+
+/**
+ *  @desc How a stream reads its video, kept until the stream is started
+ */
+struct CaptureSettings
+{
+	CaptureBackend backend;
+	bool grey_only;			//decode straight to greyscale, dropping the colour frame
+	bool skip_frames;		//drop frames without converting them when the analysis falls behind
+
+	CaptureSettings()
+		: backend(CAPTURE_DEFAULT), grey_only(false), skip_frames(false)
+	{}
+};
+
+/**
+ *	@file capturesource.h
+ *  @desc Reads the frames of a video through the chosen capture backend. Backends that
+ *  can't open the video are skipped in favour of the next one, ending with OpenCV's
+ *  default.
+ *
+ *  @param VideoCapture capture - the open capture
+ *  @param CaptureSettings settings - backend, greyscale and skipping modes
+ *  @param int opened_api - backend the capture was opened with
+ *  @param bool raw_frames - the backend delivers frames without converting them to BGR
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class CaptureSource
+{
+	private:
+		VideoCapture capture;
+		CaptureSettings settings;
+		int opened_api;
+		bool raw_frames;
+		int frames_skipped;
+
+	public:
+		CaptureSource();
+		void set_settings(const CaptureSettings &capture_settings);
+		const CaptureSettings& get_settings();
+		bool open(const string &path);
+		bool read(Mat *frame, Mat *grey);
+		bool skip();
+		bool seek(int frame);
+		double get(int property);
+		bool set(int property, double value);
+		bool is_open();
+		void release();
+		string get_backend_name();
+		int get_frames_skipped();
+};
+
+#endif
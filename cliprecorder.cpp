@@ -0,0 +1,235 @@
+#include "cliprecorder.h"
+
+/**
+ *	@file cliprecorder.cpp
+ *  @desc The writer follows the ring: it encodes a clip's frames as soon as they have
+ *  been pushed, so by the time the event's post_seconds have gone by the clip is
+ *  nearly written and the frames before the event are long encoded. The clips are
+ *  written one after another in the order they were triggered, as Motion JPEG AVIs.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+ClipRecorder::ClipRecorder()
+	: pre_seconds(0), post_seconds(0), fps(CLIP_DEFAULT_FPS), clip_count(0), running(false), clips_written(0), frames_dropped(0)
+{}
+
+ClipRecorder::~ClipRecorder()
+{
+	stop();
+}
+
+/**
+ *  @desc Chooses the length of the clips, call before start(). Both 0 turns the clips
+ *  off, and nothing is allocated.
+ *
+ *  @param double before - seconds kept from before the event
+ *  @param double after - seconds recorded after the event
+ */
+void ClipRecorder::set_length(double before, double after)
+{
+	pre_seconds = max(before, 0.0);
+	post_seconds = max(after, 0.0);
+}
+
+bool ClipRecorder::is_enabled()
+{
+	return pre_seconds + post_seconds > 0;
+}
+
+/**
+ *  @desc Allocates the ring for the stream's frames and starts the writer thread
+ *
+ *  @param string log_base_path - the record log's base path, the clips are named after it
+ *  @param Size frame_size - size of the stream's frames
+ *  @param int frame_type - OpenCV type of the stream's frames
+ *  @param double frame_rate - frames per second of the stream, CLIP_DEFAULT_FPS if 0
+ */
+void ClipRecorder::start(string log_base_path, Size frame_size, int frame_type, double frame_rate)
+{
+	size_t frame_bytes = (size_t)frame_size.area() * CV_ELEM_SIZE(frame_type);
+	int capacity;
+
+	if (!is_enabled() || running || frame_bytes == 0)
+	{
+		return;
+	}
+
+	base_path = log_base_path;
+	fps = frame_rate > 0 ? frame_rate : CLIP_DEFAULT_FPS;
+	capacity = (int)(pre_seconds * fps) + 1 + (int)(post_seconds * fps) + (int)(CLIP_RING_SLACK_SECONDS * fps);	//the frames trigger() asks for, plus the slack
+	capacity = max(min(capacity, (int)(CLIP_RING_MAX_BYTES / frame_bytes)), 2);
+	if (capacity < (int)(pre_seconds * fps) + 1)	//the writer needs the frames from before the event to still be in the ring
+	{
+		printf("Clips: %dx%d frames only fit %.1f s in the %d MB ring, the %.1f s before each event will be cut short\n",
+			frame_size.width, frame_size.height, (capacity - 1) / fps, CLIP_RING_MAX_BYTES / (1024 * 1024), pre_seconds);
+	}
+	ring.allocate(frame_size, frame_type, capacity);
+
+	tasks.clear();
+	clip_count = 0;
+	clips_written = 0;
+	frames_dropped = 0;
+	running = true;
+	writer = thread(&ClipRecorder::write_clips, this);
+}
+
+/**
+ *  @desc Copies the stream's newest frame into the ring
+ *
+ *  @param const Mat &frame - the frame, the same size and type given to start()
+ */
+void ClipRecorder::add_frame(const Mat &frame)
+{
+	if (!running)
+	{
+		return;
+	}
+	ring.push(frame);
+	{
+		lock_guard<mutex> lock(clip_mutex);	//the writer is either waiting or will see the frame when it checks
+	}
+	frames_ready.notify_one();
+}
+
+/**
+ *  @desc Records a clip around the newest frame
+ *
+ *  @returns int - number of the clip the frame is in, 0 if the clips are off
+ */
+int ClipRecorder::trigger()
+{
+	lock_guard<mutex> lock(clip_mutex);
+	ClipTask task;
+	long long newest;
+
+	newest = ring.get_pushed() - 1;
+	if (!running || newest < 0)
+	{
+		return 0;
+	}
+	if (!tasks.empty() && tasks.back().last_frame >= newest)	//still recording the clip of an earlier event
+	{
+		return tasks.back().clip_number;
+	}
+
+	task.clip_number = ++clip_count;
+	task.next_frame = max(newest - (long long)(pre_seconds * fps), ring.get_oldest());
+	task.last_frame = newest + (long long)(post_seconds * fps);
+	tasks.push_back(task);
+	frames_ready.notify_one();
+	return task.clip_number;
+}
+
+/**
+ *  @desc Writer thread, encodes the frames of the oldest clip as they arrive in the
+ *  ring. Runs until stop(), then finishes the clips already triggered with the frames
+ *  there are.
+ */
+void ClipRecorder::write_clips()
+{
+	unique_lock<mutex> lock(clip_mutex);
+	VideoWriter video;
+	ClipTask *task;
+	Mat image;
+	bool clip_failed = false;
+	long long n;
+
+	while (true)
+	{
+		frames_ready.wait(lock, [this] { return !running || (!tasks.empty() &&
+			(tasks.front().next_frame < ring.get_pushed() || tasks.front().next_frame > tasks.front().last_frame)); });
+		if (tasks.empty())
+		{
+			break;	//stopped with every clip written
+		}
+
+		task = &tasks.front();	//only this thread removes tasks, so the reference stays valid while unlocked
+		if (task->next_frame > task->last_frame || task->next_frame >= ring.get_pushed())	//finished, or the video ended first
+		{
+			if (video.isOpened())
+			{
+				video.release();
+				clips_written++;
+			}
+			clip_failed = false;
+			tasks.pop_front();
+			continue;
+		}
+
+		n = task->next_frame++;
+		if (!ring.begin_read(n, &image))	//overwritten before the writer got to it
+		{
+			frames_dropped++;
+			continue;
+		}
+
+		lock.unlock();
+		if (!video.isOpened() && !clip_failed)
+		{
+			clip_failed = !video.open(clip_path(base_path, task->clip_number), VideoWriter::fourcc('M', 'J', 'P', 'G'), fps, image.size(), image.channels() > 1);
+			if (clip_failed)
+			{
+				cout << "Couldn't create the clip " << clip_path(base_path, task->clip_number) << endl;
+			}
+		}
+		if (video.isOpened())
+		{
+			video.write(image);
+		}
+		ring.end_read(n);
+		lock.lock();
+	}
+}
+
+/**
+ *  @desc Stops taking frames and waits for the triggered clips to be written
+ */
+void ClipRecorder::stop()
+{
+	{
+		lock_guard<mutex> lock(clip_mutex);
+
+		running = false;
+	}
+	frames_ready.notify_all();
+	if (writer.joinable())
+	{
+		writer.join();
+	}
+}
+
+int ClipRecorder::get_clips_written()
+{
+	return clips_written;
+}
+
+int ClipRecorder::get_frames_dropped()
+{
+	return frames_dropped;
+}
+
+/**
+ *  @returns size_t - bytes held by the ring, the most this stream's clips ever use
+ */
+size_t ClipRecorder::get_memory_bytes()
+{
+	return ring.get_memory_bytes();
+}
+
+/**
+ *  @desc Names a clip after the record log it belongs to
+ *
+ *  @param string log_base_path - base path of the record log
+ *  @param int clip_number - number of the clip, from 1
+ *
+ *  @returns string - e.g. record_log/2017_5_7_142501_CLIP_3.avi
+ */
+string ClipRecorder::clip_path(string log_base_path, int clip_number)
+{
+	stringstream ss;
+
+	ss << log_base_path << "_CLIP_" << clip_number << ".avi";
+	return ss.str();
+}
@@ -0,0 +1,90 @@
+#ifndef CLIPRECORDER_H
+#define CLIPRECORDER_H
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <stdio.h>
+#include "opencv2/core.hpp"
+#include "opencv2/videoio.hpp"
+#include "framering.h"
+
+using namespace std;
+using namespace cv;
+
+#define CLIP_RING_MAX_BYTES (256 * 1024 * 1024)	//most memory one stream's ring may hold
+#define CLIP_RING_SLACK_SECONDS 1.0		//frames kept past the clip length, for a writer that falls behind
+#define CLIP_DEFAULT_FPS 25.0			//used when the capture doesn't report its frame rate
+
+/**
+ *  @desc A clip waiting for or being written, in frames of the FrameRing
+ */
+struct ClipTask
+{
+	int clip_number;
+	long long next_frame;		//next frame to write
+	long long last_frame;		//the clip ends after this frame
+};
+
+/**
+ *	@file cliprecorder.h
+ *  @desc Saves short clips around events. Every frame of the stream goes into a
+ *  FrameRing holding a few seconds, and when trigger() is called the frames from
+ *  pre_seconds before to post_seconds after the newest frame are encoded to
+ *  <base>_CLIP_<n>.avi on a writer thread. A trigger while a clip is still being
+ *  recorded gets that clip rather than a new one.
+ *
+ *  The ring holds the clip length plus CLIP_RING_SLACK_SECONDS, never more than
+ *  CLIP_RING_MAX_BYTES. If the writer falls so far behind that a frame is overwritten
+ *  before it is encoded, the frame is left out of the clip and counted.
+ *
+ *  @param double pre_seconds - video kept from before the event
+ *  @param double post_seconds - video recorded after the event
+ *  @param FrameRing ring - the recent frames
+ *  @param deque<ClipTask> tasks - clips still to be written, oldest first
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class ClipRecorder
+{
+	private:
+		double pre_seconds;
+		double post_seconds;
+		double fps;
+		string base_path;
+		FrameRing ring;
+		deque<ClipTask> tasks;
+		int clip_count;
+		bool running;
+		mutex clip_mutex;
+		condition_variable frames_ready;
+		thread writer;
+		atomic<int> clips_written;
+		atomic<int> frames_dropped;
+
+		void write_clips();
+
+	public:
+		ClipRecorder();
+		~ClipRecorder();
+		void set_length(double before, double after);
+		bool is_enabled();
+		void start(string log_base_path, Size frame_size, int frame_type, double frame_rate);
+		void add_frame(const Mat &frame);
+		int trigger();
+		void stop();
+		int get_clips_written();
+		int get_frames_dropped();
+		size_t get_memory_bytes();
+
+		static string clip_path(string log_base_path, int clip_number);
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef COMPONENTBLOB_H
+#define COMPONENTBLOB_H
+
+#include <vector>
+#include "opencv2/core.hpp"
+
+using namespace std;
+using namespace cv;
+
+enum BlobEngine { BLOB_CONTOURS, BLOB_COMPONENTS };
+
+/**
+ *	@file componentblob.h
+ *  @desc The output of the ComponentDetector. Each blob is one 8-connected region of
+ *  the foreground mask, described by its stats and by the horizontal runs of pixels
+ *  it is made of. The runs of a blob are stored together, top row first, in a list
+ *  shared by every blob of the frame.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+struct BlobRun
+{
+	int row;
+	int start;						//first column of the run
+	int end;						//column after the last column of the run
+};
+
+struct ComponentBlob
+{
+	Rect box;						//bounding box in mask coordinates
+	int area;						//foreground pixels
+	Point2d centroid;
+	int first_run;					//index of the blob's first run in the run list
+	int run_count;
+};
+
+#endif
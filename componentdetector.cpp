@@ -0,0 +1,390 @@
+#include "componentdetector.h"
+
+/**
+ *	@file componentdetector.cpp
+ *  @desc Labels each zone of the mask a row at a time. The runs of a row are matched
+ *  against the runs of the row above with two indices moving left to right, so each
+ *  row is compared with its neighbour once. Runs that touch, including diagonally,
+ *  have their labels joined in a union-find forest, and once the zone is scanned each
+ *  run takes the label of its root. The stats are added up from the runs in the same
+ *  pass that groups them by blob.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+ComponentDetector::ComponentDetector()
+	: canvas_pool(Size(SHAPE_CANVAS_COLS, SHAPE_CANVAS_ROWS), CV_8UC3, 32), min_blob_area(300), components_found(0)
+{}
+
+/**
+ *  @desc Sets the smallest blob area, in mask pixels, that is kept. Masks made at a
+ *  reduced scale need a proportionally smaller area.
+ */
+void ComponentDetector::set_min_blob_area(double area)
+{
+	min_blob_area = area;
+}
+
+/**
+ *  @desc Finds the blobs inside the given zones. Blobs are found per zone and offset back
+ *  into mask coordinates, so the zones must not overlap.
+ *
+ *  @param Mat *fgmask - the BGS frame
+ *  @param const vector<Rect> &zones - areas of the frame to search
+ *  @param vector<ComponentBlob> *blobs - the blobs larger than the minimum area
+ *  @param vector<BlobRun> *runs - the runs of those blobs, grouped by blob
+ *
+ *  @returns int - number of blobs
+ */
+int ComponentDetector::find_blobs(Mat *fgmask, const vector<Rect> &zones, vector<ComponentBlob> *blobs, vector<BlobRun> *runs)
+{
+	int z;
+
+	blobs->clear();
+	runs->clear();
+	components_found = 0;
+	for (z = 0; z < zones.size(); z++)
+	{
+		label_zone((*fgmask)(zones[z]));
+		collect_blobs(zones[z].tl(), blobs, runs);
+	}
+	return (int)blobs->size();
+}
+
+/**
+ *  @desc Splits every row of the zone into runs and labels them. A run touches a run in
+ *  the row above when their columns overlap or meet at a corner.
+ *
+ *  @param const Mat &zone_mask - the zone of the BGS frame
+ */
+void ComponentDetector::label_zone(const Mat &zone_mask)
+{
+	const uchar *row;
+	BlobRun run;
+	int i, x, label, prev_begin = 0, prev_end = 0, above, q;
+
+#if CV_SIMD128
+	v_uint8x16 v_zero = v_setall_u8(0);
+#endif
+
+	zone_runs.clear();
+	run_labels.clear();
+	parent.clear();
+
+	for (i = 0; i < zone_mask.rows; i++)
+	{
+		row = zone_mask.ptr<uchar>(i);
+		above = prev_begin;
+		x = 0;
+		while (x < zone_mask.cols)
+		{
+#if CV_SIMD128
+			while (x <= zone_mask.cols - 16 && v_signmask(v_load(row + x) != v_zero) == 0)	//skip empty blocks of 16 pixels
+			{
+				x += 16;
+			}
+#endif
+			while (x < zone_mask.cols && row[x] == 0)
+			{
+				x++;
+			}
+			if (x == zone_mask.cols)
+			{
+				break;
+			}
+
+			run.row = i;
+			run.start = x;
+			while (x < zone_mask.cols && row[x] != 0)
+			{
+				x++;
+			}
+			run.end = x;
+
+			while (above < prev_end && zone_runs[above].end < run.start)	//runs of the row above that end before this one can't touch it, or any later run
+			{
+				above++;
+			}
+			label = -1;
+			for (q = above; q < prev_end && zone_runs[q].start <= run.end; q++)
+			{
+				label = label < 0 ? find_root(run_labels[q]) : join_labels(label, run_labels[q]);
+			}
+			if (label < 0)
+			{
+				label = (int)parent.size();
+				parent.push_back(label);
+			}
+
+			zone_runs.push_back(run);
+			run_labels.push_back(label);
+		}
+		prev_begin = prev_end;
+		prev_end = (int)zone_runs.size();
+	}
+}
+
+/**
+ *  @desc Adds up the stats of each labelled blob, then copies the runs of the blobs
+ *  larger than the minimum area into the output grouped by blob.
+ *
+ *  @param Point offset - top left of the zone in the mask
+ *  @param vector<ComponentBlob> *blobs - the blobs found so far
+ *  @param vector<BlobRun> *runs - the runs of the blobs found so far
+ */
+void ComponentDetector::collect_blobs(Point offset, vector<ComponentBlob> *blobs, vector<BlobRun> *runs)
+{
+	ComponentStats empty = { INT_MAX, INT_MAX, -1, -1, 0, 0, 0, 0, -1 };
+	ComponentBlob blob;
+	BlobRun run;
+	size_t base = runs->size();
+	int r, s, root, length, kept = 0;
+
+	root_stats.assign(parent.size(), -1);
+	stats.clear();
+	for (r = 0; r < zone_runs.size(); r++)
+	{
+		root = find_root(run_labels[r]);
+		if (root_stats[root] < 0)
+		{
+			root_stats[root] = (int)stats.size();
+			stats.push_back(empty);
+		}
+		s = root_stats[root];
+		run = zone_runs[r];
+		length = run.end - run.start;
+
+		stats[s].min_x = min(stats[s].min_x, run.start);
+		stats[s].max_x = max(stats[s].max_x, run.end - 1);
+		stats[s].min_y = min(stats[s].min_y, run.row);
+		stats[s].max_y = max(stats[s].max_y, run.row);
+		stats[s].area += length;
+		stats[s].sum_x += length * (run.start + run.end - 1) / 2.0;
+		stats[s].sum_y += (double)length * run.row;
+		stats[s].runs++;
+		run_labels[r] = s;
+	}
+	components_found += (int)stats.size();
+
+	run_offsets.resize(stats.size());
+	for (s = 0; s < stats.size(); s++)
+	{
+		if (stats[s].area <= min_blob_area)	//threshold for the blobs to be kept, excludes smaller shapes
+		{
+			continue;
+		}
+		blob.box = Rect(stats[s].min_x + offset.x, stats[s].min_y + offset.y, stats[s].max_x - stats[s].min_x + 1, stats[s].max_y - stats[s].min_y + 1);
+		blob.area = stats[s].area;
+		blob.centroid = Point2d(stats[s].sum_x / stats[s].area + offset.x, stats[s].sum_y / stats[s].area + offset.y);
+		blob.first_run = (int)base + kept;
+		blob.run_count = stats[s].runs;
+
+		stats[s].blob = (int)blobs->size();
+		run_offsets[s] = blob.first_run;
+		kept += blob.run_count;
+		blobs->push_back(blob);
+	}
+
+	runs->resize(base + kept);
+	for (r = 0; r < zone_runs.size(); r++)	//scan order keeps each blob's runs top row first
+	{
+		s = run_labels[r];
+		if (stats[s].blob < 0)
+		{
+			continue;
+		}
+		run = zone_runs[r];
+		run.row += offset.y;
+		run.start += offset.x;
+		run.end += offset.x;
+		(*runs)[run_offsets[s]++] = run;
+	}
+}
+
+/**
+ *  @desc Finds the root of a label, halving the path on the way
+ */
+int ComponentDetector::find_root(int label)
+{
+	while (parent[label] != label)
+	{
+		parent[label] = parent[parent[label]];
+		label = parent[label];
+	}
+	return label;
+}
+
+/**
+ *  @desc Joins the trees of two labels under the smaller root
+ *
+ *  @returns int - the root of the joined tree
+ */
+int ComponentDetector::join_labels(int a, int b)
+{
+	a = find_root(a);
+	b = find_root(b);
+	if (a < b)
+	{
+		parent[b] = a;
+		return a;
+	}
+	parent[a] = b;
+	return b;
+}
+
+/**
+ *  @desc Draws the blobs for the display, the ends of each run in red and the bounding
+ *  boxes in magenta. Only needed when something will show the frames.
+ *
+ *  @param Size frame_size - size of the mask
+ *  @param const vector<ComponentBlob> &blobs - the blobs from find_blobs()
+ *  @param const vector<BlobRun> &runs - the runs from find_blobs()
+ *  @param Mat *drawn_blobs - the blobs and boxes
+ */
+void ComponentDetector::draw_annotations(Size frame_size, const vector<ComponentBlob> &blobs, const vector<BlobRun> &runs, Mat *drawn_blobs)
+{
+	Vec3b *row;
+	int i;
+
+	*drawn_blobs = Mat::zeros(frame_size, CV_8UC3);
+	for (i = 0; i < runs.size(); i++)
+	{
+		row = drawn_blobs->ptr<Vec3b>(runs[i].row);
+		row[runs[i].start] = Vec3b(0, 0, 255);
+		row[runs[i].end - 1] = Vec3b(0, 0, 255);
+	}
+	for (i = 0; i < blobs.size(); i++)
+	{
+		rectangle(*drawn_blobs, blobs[i].box, Scalar(255, 0, 255), 1, 8);
+	}
+}
+
+/**
+ *  @desc Cuts the chosen blobs out of the mask and paints them onto 64x128 canvases for
+ *  the PeopleFinder, the same as BlobDetector::get_large_shapes() but from the blob's
+ *  own runs, so other blobs inside its box are left out. The padding, the source images
+ *  and the boxes follow the BlobDetector, and blobs on the left edge of the mask are
+ *  skipped as it skips them.
+ *
+ *  @param Mat *src_image - the source frame
+ *  @param Size mask_size - size of the BGS frame the blobs were found in
+ *  @param const vector<ComponentBlob> &blobs - the blobs from find_blobs()
+ *  @param const vector<BlobRun> &runs - the runs from find_blobs()
+ *  @param const vector<int> &selected - indices of the blobs to cut out
+ *  @param int edge_space - space between the shape and the edge of the image
+ *  @param int mask_scale - factor the mask is shrunk by from the source frame
+ *  @param vector<Mat> *shapes - larger shapes, filled with the outline marked
+ *  @param vector<Mat> *src_shapes - the source images of the larger shapes
+ *  @param vector<Rect> *shape_boxes - position of each larger shape in the frame
+ *  @param vector<int> *shape_blobs - index in selected each shape came from, may be NULL
+ */
+void ComponentDetector::get_large_shapes(Mat *src_image, Size mask_size, const vector<ComponentBlob> &blobs, const vector<BlobRun> &runs, const vector<int> &selected,
+	int edge_space, int mask_scale, vector<Mat> *shapes, vector<Mat> *src_shapes, vector<Rect> *shape_boxes, vector<int> *shape_blobs)
+{
+	Point topleft, botright;
+	Rect roi, src_roi;
+	Mat crop, canvas;
+	int i, r;
+
+	shapes->clear();
+	src_shapes->clear();
+	shape_boxes->clear();
+	if (shape_blobs != NULL)
+	{
+		shape_blobs->clear();
+	}
+	crop_buffer.create(mask_size, CV_8UC1);
+
+	for (i = 0; i < selected.size(); i++)
+	{
+		const ComponentBlob &blob = blobs[selected[i]];
+
+		if (blob.box.x == 0)
+		{
+			continue;
+		}
+
+		topleft = blob.box.tl();
+		botright = Point(blob.box.x + blob.box.width - 1, blob.box.y + blob.box.height - 1);
+		if (is_within_bound(Point(topleft.x - edge_space, topleft.y - edge_space), mask_size.width, mask_size.height) &&
+			is_within_bound(Point(botright.x + edge_space, botright.y + edge_space), mask_size.width, mask_size.height))
+		{
+			topleft.x -= edge_space;
+			topleft.y -= edge_space;
+			botright.x += edge_space;
+			botright.y += edge_space;
+		}
+		roi = Rect(topleft.x, topleft.y, botright.x - topleft.x + 1, botright.y - topleft.y + 1);
+
+		crop = crop_buffer(Rect(0, 0, roi.width, roi.height));
+		crop.setTo(Scalar(0));
+		for (r = blob.first_run; r < blob.first_run + blob.run_count; r++)
+		{
+			memset(crop.ptr<uchar>(runs[r].row - roi.y) + runs[r].start - roi.x, 255, runs[r].end - runs[r].start);
+		}
+		resize(crop, resized_mask, Size(SHAPE_CANVAS_COLS, SHAPE_CANVAS_ROWS));
+
+		canvas = canvas_pool.acquire();
+		paint_canvas(resized_mask, &canvas);
+
+		src_roi = Rect(roi.x * mask_scale, roi.y * mask_scale, roi.width * mask_scale, roi.height * mask_scale) &
+			Rect(0, 0, src_image->cols, src_image->rows);
+
+		shapes->push_back(canvas);
+		src_shapes->push_back((*src_image)(src_roi));
+		shape_boxes->push_back(src_roi);
+		if (shape_blobs != NULL)
+		{
+			shape_blobs->push_back(i);
+		}
+	}
+}
+
+/**
+ *  @desc Paints a resized blob the way the PeopleFinder reads a shape. Foreground pixels
+ *  with a background 4-neighbour, or on the edge of the canvas, are the outline in the
+ *  contour colour, the same pixels findContours() would trace, and the rest of the
+ *  foreground is the fill colour. Holes in the blob stay empty.
+ *
+ *  @param const Mat &shape_mask - the blob resized to the canvas
+ *  @param Mat *canvas - an empty canvas
+ */
+void ComponentDetector::paint_canvas(const Mat &shape_mask, Mat *canvas)
+{
+	const uchar *src, *up, *down;
+	Vec3b *dst;
+	bool outline;
+	int i, j;
+
+	for (i = 0; i < shape_mask.rows; i++)
+	{
+		src = shape_mask.ptr<uchar>(i);
+		up = i > 0 ? shape_mask.ptr<uchar>(i - 1) : NULL;
+		down = i < shape_mask.rows - 1 ? shape_mask.ptr<uchar>(i + 1) : NULL;
+		dst = canvas->ptr<Vec3b>(i);
+		for (j = 0; j < shape_mask.cols; j++)
+		{
+			if (src[j] == 0)
+			{
+				continue;
+			}
+			outline = up == NULL || down == NULL || j == 0 || j == shape_mask.cols - 1 ||
+				up[j] == 0 || down[j] == 0 || src[j - 1] == 0 || src[j + 1] == 0;
+			dst[j] = outline ? Vec3b(0, 0, 255) : Vec3b(64, 0, 0);
+		}
+	}
+}
+
+bool ComponentDetector::is_within_bound(Point node, int x_bound, int y_bound)
+{
+	return (node.x >= 0 && node.x < x_bound && node.y >= 0 && node.y < y_bound);
+}
+
+/**
+ *  @desc Number of blobs of any size found by the last find_blobs()
+ */
+int ComponentDetector::get_component_count()
+{
+	return components_found;
+}
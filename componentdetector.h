@@ -0,0 +1,75 @@
+#ifndef COMPONENTDETECTOR_H
+#define COMPONENTDETECTOR_H
+
+#include <vector>
+#include <string.h>
+#include <climits>
+#include "opencv2/core.hpp"
+#include "opencv2/imgproc.hpp"
+#include <opencv2/core/hal/intrin.hpp>
+#include "componentblob.h"
+#include "shapecanvaspool.h"
+#include "shapecanvas.h"
+
+using namespace std;
+using namespace cv;
+
+/**
+ *	@file componentdetector.h
+ *  @desc An alternative to the BlobDetector that finds the blobs of the mask with one
+ *  pass of run based connected component labelling. Every row is split into runs of
+ *  foreground pixels, each run is joined to the runs it touches in the row above, and
+ *  the area, bounding box and centroid of each blob are added up from its runs. No
+ *  contours or hulls are made.
+ *
+ *  The shapes for the PeopleFinder are painted straight from the runs, already filled
+ *  with the outline marked, so PeopleFinder::create_skeleton() has nothing to redraw
+ *  or flood fill.
+ *
+ *  @param ShapeCanvasPool canvas_pool - reusable 64x128 images for the larger shapes
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class ComponentDetector
+{
+	private:
+		struct ComponentStats
+		{
+			int min_x, min_y, max_x, max_y;
+			int area;
+			double sum_x, sum_y;
+			int runs;
+			int blob;				//index in the output, -1 for blobs below the minimum area
+		};
+
+		vector<BlobRun> zone_runs;				//runs of the current zone in scan order
+		vector<int> run_labels;					//label of each run, provisional then final
+		vector<int> parent;						//union-find forest of the provisional labels
+		vector<int> root_stats;					//stats index of each root label
+		vector<ComponentStats> stats;
+		vector<int> run_offsets;
+		ShapeCanvasPool canvas_pool;			//64x128 canvases for the shapes
+		Mat crop_buffer;						//scratch space the size of the mask
+		Mat resized_mask;
+		double min_blob_area;					//blobs smaller than this are left out
+		int components_found;
+
+		int find_root(int label);
+		int join_labels(int a, int b);
+		void label_zone(const Mat &zone_mask);
+		void collect_blobs(Point offset, vector<ComponentBlob> *blobs, vector<BlobRun> *runs);
+		void paint_canvas(const Mat &shape_mask, Mat *canvas);
+		bool is_within_bound(Point node, int x_bound, int y_bound);
+
+	public:
+		ComponentDetector();
+		void set_min_blob_area(double area);
+		int find_blobs(Mat *fgmask, const vector<Rect> &zones, vector<ComponentBlob> *blobs, vector<BlobRun> *runs);
+		void draw_annotations(Size frame_size, const vector<ComponentBlob> &blobs, const vector<BlobRun> &runs, Mat *drawn_blobs);
+		void get_large_shapes(Mat *src_image, Size mask_size, const vector<ComponentBlob> &blobs, const vector<BlobRun> &runs, const vector<int> &selected,
+			int edge_space, int mask_scale, vector<Mat> *shapes, vector<Mat> *src_shapes, vector<Rect> *shape_boxes, vector<int> *shape_blobs);
+		int get_component_count();
+};
+
+#endif
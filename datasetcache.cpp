@@ -0,0 +1,297 @@
+#include "datasetcache.h"
+
+/**
+ *	@file datasetcache.cpp
+ *  @desc The .dataset file is laid out as:
+ *
+ *  - a DatasetHeader, padded to DATASET_IMAGE_ALIGN.
+ *  - the images, rows * cols bytes each, end to end, so image n is at a fixed offset.
+ *  - the skeletons, node_count x/y pairs of ints per image, when they were compiled.
+ *  - the index, one DatasetIndexEntry per image.
+ *  - the file names, packed end to end.
+ *
+ *  The images are written as they are added and the rest when writing finishes. The
+ *  header is written last, so a file left by a compile that stopped early never
+ *  opens.
+ *
+ *  The file is mapped copy-on-write. Nothing should write to the images, but if
+ *  OpenCV ever does, the page is copied into the process and the file is untouched.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+DatasetCache::DatasetCache()
+	: file(INVALID_HANDLE_VALUE), mapping(NULL), view(NULL), header(NULL), entries(NULL), skeletons(NULL), names(NULL), use_skeletons(false)
+{
+	memset(&out_header, 0, sizeof(out_header));
+}
+
+DatasetCache::~DatasetCache()
+{
+	close();
+}
+
+/**
+ *  @desc Maps a compiled training directory
+ *
+ *  @param string cache_path - the .dataset file
+ *  @param unsigned long long dataset_hash - hash the file must have been compiled from
+ *  @param unsigned int skeleton_version - skeleton version the stored skeletons must have
+ *  been built with to be used, the images are used either way
+ *
+ *  @returns false if the file is missing, from another version or another training set
+ */
+bool DatasetCache::open(string cache_path, unsigned long long dataset_hash, unsigned int skeleton_version)
+{
+	LARGE_INTEGER size;
+	unsigned long long image_bytes, skeleton_bytes;
+
+	close();
+	file = CreateFile(cache_path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	if (!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG)sizeof(DatasetHeader))
+	{
+		close();
+		return false;
+	}
+
+	mapping = CreateFileMapping(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	if (mapping != NULL)
+	{
+		view = (const uchar *)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	}
+	if (view == NULL)
+	{
+		close();
+		return false;
+	}
+
+	header = (const DatasetHeader *)view;
+	image_bytes = (unsigned long long)header->image_count * header->rows * header->cols;
+	skeleton_bytes = header->skeleton_version != 0 ? (unsigned long long)header->image_count * header->node_count * 2 * sizeof(int) : 0;
+	if (memcmp(header->magic, DATASET_FILE_MAGIC, 8) != 0 || header->version != DATASET_FILE_VERSION || header->dataset_hash != dataset_hash ||
+		header->rows != SHAPE_CANVAS_ROWS || header->cols != SHAPE_CANVAS_COLS || header->file_size != (unsigned long long)size.QuadPart ||
+		header->image_offset + image_bytes > header->file_size || header->skeleton_offset + skeleton_bytes > header->file_size ||
+		header->index_offset + (unsigned long long)header->image_count * sizeof(DatasetIndexEntry) > header->file_size ||
+		header->names_offset > header->file_size)
+	{
+		close();
+		return false;
+	}
+
+	entries = (const DatasetIndexEntry *)(view + header->index_offset);
+	skeletons = (const int *)(view + header->skeleton_offset);
+	names = (const char *)(view + header->names_offset);
+	use_skeletons = skeleton_version != 0 && header->skeleton_version == skeleton_version && header->node_count == FEATURE_NODES;
+	return true;
+}
+
+void DatasetCache::close()
+{
+	if (view != NULL)
+	{
+		UnmapViewOfFile(view);
+	}
+	if (mapping != NULL)
+	{
+		CloseHandle(mapping);
+	}
+	if (file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(file);
+	}
+	file = INVALID_HANDLE_VALUE;
+	mapping = NULL;
+	view = NULL;
+	header = NULL;
+	entries = NULL;
+	skeletons = NULL;
+	names = NULL;
+	use_skeletons = false;
+}
+
+/**
+ *  @returns unsigned int - images in the mapped file, 0 when nothing is open
+ */
+unsigned int DatasetCache::get_count()
+{
+	return header != NULL ? header->image_count : 0;
+}
+
+/**
+ *  @desc Gets an image without copying it, valid until the cache is closed
+ *
+ *  @param unsigned int n - index of the image
+ *
+ *  @returns Mat - the greyscale 64x128 image over the mapped file
+ */
+Mat DatasetCache::get_image(unsigned int n)
+{
+	size_t image_size = (size_t)header->rows * header->cols;
+
+	return Mat(header->rows, header->cols, CV_8UC1, (void *)(view + header->image_offset + n * image_size));
+}
+
+string DatasetCache::get_name(unsigned int n)
+{
+	if (entries[n].name_offset + entries[n].name_length > header->file_size - header->names_offset)
+	{
+		return "";
+	}
+	return string(names + entries[n].name_offset, entries[n].name_length);
+}
+
+/**
+ *  @returns true when the file holds skeletons of the expected version
+ */
+bool DatasetCache::has_skeletons()
+{
+	return use_skeletons;
+}
+
+/**
+ *  @desc Copies out the stored skeleton of an image
+ *
+ *  @param unsigned int n - index of the image
+ *  @param vector<Point> *nodes - filled with the FEATURE_NODES positions
+ *
+ *  @returns false if there are no usable skeletons or this image's skeleton was bad
+ */
+bool DatasetCache::get_skeleton(unsigned int n, vector<Point> *nodes)
+{
+	const int *node_data;
+	int i;
+
+	if (!use_skeletons || entries[n].skeleton_ok == 0)
+	{
+		return false;
+	}
+
+	node_data = skeletons + (size_t)n * FEATURE_NODES * 2;
+	nodes->resize(FEATURE_NODES);
+	for (i = 0; i < FEATURE_NODES; i++)
+	{
+		(*nodes)[i] = Point(node_data[i * 2], node_data[i * 2 + 1]);
+	}
+	return true;
+}
+
+/**
+ *  @desc Starts compiling a training directory, the images are added in turn with
+ *  add_image() and the file is only valid once finish_writing() has returned
+ *
+ *  @param string cache_path - the .dataset file
+ *  @param unsigned long long dataset_hash - hash of the training directory
+ *  @param unsigned int skeleton_version - MODEL_FILE_VERSION when skeletons will be
+ *  added, 0 for the images only
+ *
+ *  @returns false if the file couldn't be created
+ */
+bool DatasetCache::begin_writing(string cache_path, unsigned long long dataset_hash, unsigned int skeleton_version)
+{
+	vector<char> padding(DATASET_IMAGE_ALIGN, 0);
+
+	close();
+	out.open(cache_path, ios::out | ios::binary | ios::trunc);
+	if (!out.is_open())
+	{
+		return false;
+	}
+
+	memset(&out_header, 0, sizeof(out_header));
+	out_header.version = DATASET_FILE_VERSION;
+	out_header.skeleton_version = skeleton_version;
+	out_header.dataset_hash = dataset_hash;
+	out_header.rows = SHAPE_CANVAS_ROWS;
+	out_header.cols = SHAPE_CANVAS_COLS;
+	out_header.node_count = skeleton_version != 0 ? FEATURE_NODES : 0;
+	out_header.image_offset = DATASET_IMAGE_ALIGN;
+	out_entries.clear();
+	out_skeletons.clear();
+	out_names.clear();
+
+	out.write(padding.data(), padding.size());	//the header goes here once the file is complete
+	return out.good();
+}
+
+/**
+ *  @desc Appends an image and its skeleton
+ *
+ *  @param string name - file name of the image in the training directory
+ *  @param const Mat &image - the greyscale 64x128 image
+ *  @param const vector<Point> *nodes - the image's skeleton, NULL when compiling images only
+ *  @param bool bad_flag - raised if the skeleton couldn't be built
+ *
+ *  @returns false if the image is the wrong size or couldn't be written
+ */
+bool DatasetCache::add_image(string name, const Mat &image, const vector<Point> *nodes, bool bad_flag)
+{
+	DatasetIndexEntry entry;
+	int i;
+
+	if (!out.is_open() || image.rows != SHAPE_CANVAS_ROWS || image.cols != SHAPE_CANVAS_COLS || image.type() != CV_8UC1)
+	{
+		return false;
+	}
+
+	for (i = 0; i < image.rows; i++)
+	{
+		out.write((const char *)image.ptr<uchar>(i), image.cols);
+	}
+
+	entry.name_offset = (unsigned int)out_names.size();
+	entry.name_length = (unsigned int)name.size();
+	entry.skeleton_ok = nodes != NULL && !bad_flag ? 1 : 0;
+	entry.reserved = 0;
+	out_entries.push_back(entry);
+	out_names.append(name);
+
+	if (out_header.skeleton_version != 0)
+	{
+		for (i = 0; i < FEATURE_NODES; i++)
+		{
+			out_skeletons.push_back(nodes != NULL ? (*nodes)[i].x : 0);
+			out_skeletons.push_back(nodes != NULL ? (*nodes)[i].y : 0);
+		}
+	}
+	out_header.image_count++;
+	return out.good();
+}
+
+/**
+ *  @desc Writes the skeletons, the index, the names and finally the header
+ *
+ *  @returns false if the file couldn't be written
+ */
+bool DatasetCache::finish_writing()
+{
+	bool written;
+
+	if (!out.is_open())
+	{
+		return false;
+	}
+
+	out_header.skeleton_offset = (unsigned long long)out.tellp();
+	out.write((const char *)out_skeletons.data(), out_skeletons.size() * sizeof(int));
+	out_header.index_offset = (unsigned long long)out.tellp();
+	out.write((const char *)out_entries.data(), out_entries.size() * sizeof(DatasetIndexEntry));
+	out_header.names_offset = (unsigned long long)out.tellp();
+	out.write(out_names.data(), out_names.size());
+	out_header.file_size = (unsigned long long)out.tellp();
+
+	memcpy(out_header.magic, DATASET_FILE_MAGIC, 8);
+	out.seekp(0);
+	out.write((const char *)&out_header, sizeof(out_header));
+	written = out.good();
+	out.close();
+
+	out_entries.clear();
+	out_skeletons.clear();
+	out_names.clear();
+	return written;
+}
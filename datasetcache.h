@@ -0,0 +1,101 @@
+#ifndef DATASETCACHE_H
+#define DATASETCACHE_H
+
+#include <windows.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <string.h>
+#include "opencv2/core.hpp"
+#include "shapecanvas.h"
+#include "skeletonbatch.h"
+
+using namespace std;
+using namespace cv;
+
+#define DATASET_FILE_MAGIC "ASCVDST"	//8 bytes including the terminator
+#define DATASET_FILE_VERSION 1
+#define DATASET_IMAGE_ALIGN 4096		//the images start on a page boundary
+
+/**
+ *  @desc Start of a .dataset file, the offsets are from the start of the file
+ */
+struct DatasetHeader
+{
+	char magic[8];
+	unsigned int version;
+	unsigned int skeleton_version;		//MODEL_FILE_VERSION the skeletons were built with, 0 without skeletons
+	unsigned long long dataset_hash;	//PeopleFinder::hash_dataset_files() of the training directory
+	unsigned int image_count;
+	int rows;
+	int cols;
+	unsigned int node_count;
+	unsigned long long image_offset;
+	unsigned long long skeleton_offset;
+	unsigned long long index_offset;
+	unsigned long long names_offset;
+	unsigned long long file_size;
+};
+
+/**
+ *  @desc Entry in the index, one per image in the order the images are stored
+ */
+struct DatasetIndexEntry
+{
+	unsigned int name_offset;			//position of the file name in the names block
+	unsigned int name_length;
+	int skeleton_ok;					//1 when the skeleton was built without the bad flag
+	int reserved;
+};
+
+/**
+ *	@file datasetcache.h
+ *  @desc A training directory compiled into one file: every image already converted
+ *  to a greyscale 64x128 mask and, optionally, the feature skeleton built from it.
+ *  The file is read through a memory mapping, so opening it decodes nothing, each
+ *  image is a Mat over the mapped pages, and several processes training on the same
+ *  directory share one copy of it in the page cache.
+ *
+ *  The file is tied to the training directory by its hash, so adding, removing or
+ *  editing a training image makes it stale and it is no longer opened. The skeletons
+ *  are only used while the skeleton code is the version they were built with.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class DatasetCache
+{
+	private:
+		HANDLE file;
+		HANDLE mapping;
+		const uchar *view;
+		const DatasetHeader *header;
+		const DatasetIndexEntry *entries;
+		const int *skeletons;
+		const char *names;
+		bool use_skeletons;
+
+		ofstream out;					//only while compiling
+		DatasetHeader out_header;
+		vector<DatasetIndexEntry> out_entries;
+		vector<int> out_skeletons;
+		string out_names;
+
+	public:
+		DatasetCache();
+		~DatasetCache();
+		bool open(string cache_path, unsigned long long dataset_hash, unsigned int skeleton_version);
+		void close();
+		unsigned int get_count();
+		Mat get_image(unsigned int n);
+		string get_name(unsigned int n);
+		bool has_skeletons();
+		bool get_skeleton(unsigned int n, vector<Point> *nodes);
+
+		bool begin_writing(string cache_path, unsigned long long dataset_hash, unsigned int skeleton_version);
+		bool add_image(string name, const Mat &image, const vector<Point> *nodes, bool bad_flag);
+		bool finish_writing();
+};
+
+#endif
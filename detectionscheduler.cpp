@@ -0,0 +1,191 @@
+#include "detectionscheduler.h"
+
+/**
+ *	@file detectionscheduler.cpp
+ *  @desc Schedules the PeopleFinder for one stream. New tracks are classified as soon
+ *  as the CPU budget allows, and the tracks already classified are rechecked at an
+ *  interval chosen from the scene:
+ *
+ *  - activity_interval_ms when the foreground area has changed since the last recheck
+ *  - tracking_interval_ms while any shapes are being tracked
+ *  - idle_interval_ms when the scene is empty
+ *
+ *  The budget is kept by timing each run of the PeopleFinder. After a run taking c ms
+ *  no more runs are allowed for c * (1 - budget) / budget ms, so over time the
+ *  PeopleFinder takes at most the budgeted fraction of the stream's time.
+ *
+ *  recheck_due() and within_budget() are called by the blob stage and record_cost()
+ *  by the classification stage, so the state is locked.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+DetectionScheduler::DetectionScheduler()
+{
+	set_profile(SCHEDULE_BALANCED);
+	reset();
+}
+
+/**
+ *  @desc Sets the intervals and budget from one of the presets
+ *
+ *  @param ScheduleProfile profile - low latency, balanced or low CPU
+ */
+void DetectionScheduler::set_profile(ScheduleProfile profile)
+{
+	switch (profile)
+	{
+		case SCHEDULE_LOW_LATENCY:
+			set_intervals(100, 500, 2000);
+			set_cpu_budget(0.5);
+			break;
+		case SCHEDULE_LOW_CPU:
+			set_intervals(1000, 3000, 10000);
+			set_cpu_budget(0.1);
+			break;
+		default:
+			set_intervals(250, 1000, 4000);
+			set_cpu_budget(0.25);
+			break;
+	}
+}
+
+/**
+ *  @desc Sets the recheck intervals in milliseconds of video
+ */
+void DetectionScheduler::set_intervals(int activity_ms, int tracking_ms, int idle_ms)
+{
+	lock_guard<mutex> guard(lock);
+	activity_interval_ms = activity_ms;
+	tracking_interval_ms = tracking_ms;
+	idle_interval_ms = idle_ms;
+}
+
+/**
+ *  @desc Sets the fraction of the stream's time the PeopleFinder may take, between
+ *  0.01 and 1 (no limit)
+ */
+void DetectionScheduler::set_cpu_budget(double budget)
+{
+	lock_guard<mutex> guard(lock);
+	cpu_budget = min(max(budget, 0.01), 1.0);
+}
+
+/**
+ *  @desc Forgets the previous run, call before a stream starts
+ */
+void DetectionScheduler::reset()
+{
+	lock_guard<mutex> guard(lock);
+	started = false;
+	last_recheck_ms = 0;
+	last_recheck_foreground = 0;
+	resume_ticks = 0;
+	rechecks = 0;
+	deferred = 0;
+	frame_deferred = false;
+}
+
+/**
+ *  @desc Decides whether the classified tracks should be rechecked on this frame. The
+ *  first frame of a run is never a recheck.
+ *
+ *  @param int milliseconds - timestamp of the frame
+ *  @param double foreground - fraction of the frame covered by shapes
+ *  @param int active_tracks - number of shapes being tracked
+ *
+ *  @returns true if a recheck is due and the budget allows it
+ */
+bool DetectionScheduler::recheck_due(int milliseconds, double foreground, int active_tracks)
+{
+	lock_guard<mutex> guard(lock);
+	int interval;
+
+	frame_deferred = false;	//called once per frame, before within_budget()
+	if (!started)
+	{
+		started = true;
+		last_recheck_ms = milliseconds;
+		last_recheck_foreground = foreground;
+		return false;
+	}
+
+	if (fabs(foreground - last_recheck_foreground) >= SCHEDULE_FOREGROUND_CHANGE)
+	{
+		interval = activity_interval_ms;
+	}
+	else if (active_tracks > 0)
+	{
+		interval = tracking_interval_ms;
+	}
+	else
+	{
+		interval = idle_interval_ms;
+	}
+
+	if (milliseconds - last_recheck_ms < interval)
+	{
+		return false;
+	}
+	if (getTickCount() < resume_ticks)
+	{
+		deferred++;
+		frame_deferred = true;
+		return false;
+	}
+
+	last_recheck_ms = milliseconds;
+	last_recheck_foreground = foreground;
+	rechecks++;
+	return true;
+}
+
+/**
+ *  @desc Checks whether the PeopleFinder may run now, used for new tracks
+ *
+ *  @returns false while the budget is used up
+ */
+bool DetectionScheduler::within_budget()
+{
+	lock_guard<mutex> guard(lock);
+
+	if (getTickCount() < resume_ticks)
+	{
+		if (!frame_deferred)	//a recheck put off on the same frame has already counted it
+		{
+			deferred++;
+			frame_deferred = true;
+		}
+		return false;
+	}
+	return true;
+}
+
+/**
+ *  @desc Charges a run of the PeopleFinder to the budget
+ *
+ *  @param double cost_ms - time the run took
+ */
+void DetectionScheduler::record_cost(double cost_ms)
+{
+	lock_guard<mutex> guard(lock);
+	double wait_ms = cost_ms * (1.0 - cpu_budget) / cpu_budget;
+
+	resume_ticks = getTickCount() + (int64)(wait_ms * getTickFrequency() / 1000.0);
+}
+
+int DetectionScheduler::get_rechecks()
+{
+	lock_guard<mutex> guard(lock);
+	return rechecks;
+}
+
+/**
+ *  @returns int - frames on which a recheck or a new track was put off for the budget, each counted once
+ */
+int DetectionScheduler::get_deferred()
+{
+	lock_guard<mutex> guard(lock);
+	return deferred;
+}
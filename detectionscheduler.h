@@ -0,0 +1,69 @@
+#ifndef DETECTIONSCHEDULER_H
+#define DETECTIONSCHEDULER_H
+
+#include <mutex>
+#include <algorithm>
+#include <math.h>
+#include "opencv2/core.hpp"
+
+using namespace std;
+using namespace cv;
+
+#define SCHEDULE_FOREGROUND_CHANGE 0.02		//change in the fraction of the frame in shapes that counts as activity
+
+/**
+ *  @desc Preset trade-offs between how quickly shapes are classified and how much of
+ *  the CPU the PeopleFinder may use
+ */
+enum ScheduleProfile
+{
+	SCHEDULE_LOW_LATENCY,
+	SCHEDULE_BALANCED,
+	SCHEDULE_LOW_CPU
+};
+
+/**
+ *	@file detectionscheduler.h
+ *  @desc Decides when a stream runs the PeopleFinder, in place of a fixed once a second
+ *  trigger. Intervals are measured on the video timestamps rather than by counting
+ *  frames, so streams with a fractional frame rate are handled the same as any other.
+ *
+ *  @param int activity_interval_ms - recheck interval while the foreground is changing
+ *  @param int tracking_interval_ms - recheck interval while shapes are tracked
+ *  @param int idle_interval_ms - recheck interval on an empty scene
+ *  @param double cpu_budget - fraction of the stream's time the PeopleFinder may take
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class DetectionScheduler
+{
+	private:
+		int activity_interval_ms;
+		int tracking_interval_ms;
+		int idle_interval_ms;
+		double cpu_budget;
+
+		bool started;
+		int last_recheck_ms;
+		double last_recheck_foreground;
+		int64 resume_ticks;			//tick count before which the budget is used up
+		int rechecks;
+		int deferred;
+		bool frame_deferred;		//this frame has already been counted as deferred
+		mutex lock;
+
+	public:
+		DetectionScheduler();
+		void set_profile(ScheduleProfile profile);
+		void set_intervals(int activity_ms, int tracking_ms, int idle_ms);
+		void set_cpu_budget(double budget);
+		void reset();
+		bool recheck_due(int milliseconds, double foreground, int active_tracks);
+		bool within_budget();
+		void record_cost(double cost_ms);
+		int get_rechecks();
+		int get_deferred();
+};
+
+#endif
@@ -0,0 +1,362 @@
+#include "detectionstore.h"
+
+/**
+ *	@file detectionstore.cpp
+ *  @desc Append-only binary store for the detections of one run, kept in three files
+ *  sharing a base path:
+ *
+ *  - <base>.det: a header (magic string, version, video path and BGS settings)
+ *    followed by one fixed size DetectionRecord per detection.
+ *  - <base>.blob: the encoded source and contour images packed end to end, the
+ *    records hold their offsets and sizes.
+ *  - <base>.idx: a sparse index with the frame number and timestamp of every
+ *    DETECTION_INDEX_STRIDE'th record.
+ *
+ *  Records are appended in frame order, so the index is sorted and finding the first
+ *  record at a frame or time is a binary search of the index followed by reading at
+ *  most DETECTION_INDEX_STRIDE records. Nothing is ever rewritten, so if a run stops
+ *  early every record written so far can still be read. Version 1 stores, from before
+ *  the records had a clip number, are still read with every clip number 0.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+DetectionStore::DetectionStore()
+	: record_count(0), blob_size(0), header_size(0), file_version(DETECTION_FILE_VERSION), record_size(sizeof(DetectionRecord)), writing(false), bgs_history(0), bgs_threshold(0)
+{}
+
+DetectionStore::~DetectionStore()
+{
+	close();
+}
+
+/**
+ *  @desc Creates the store files for a new run and writes the header
+ *
+ *  @param string base_path - path of the files without the extensions
+ *  @param string v_path - the video the detections come from
+ *  @param int history - BGS history length used for the video
+ *  @param double thresh - BGS distance to threshold used for the video
+ *
+ *  @returns false if the files couldn't be created
+ */
+bool DetectionStore::open_for_writing(string base_path, string v_path, int history, double thresh)
+{
+	unsigned int version = DETECTION_FILE_VERSION;
+	unsigned int path_length = (unsigned int)v_path.size();
+
+	close();
+	records.open(base_path + ".det", ios::out | ios::binary | ios::trunc);
+	blobs.open(base_path + ".blob", ios::out | ios::binary | ios::trunc);
+	index.open(base_path + ".idx", ios::out | ios::binary | ios::trunc);
+	if (!records.is_open() || !blobs.is_open() || !index.is_open())
+	{
+		close();
+		return false;
+	}
+
+	video_path = v_path;
+	bgs_history = history;
+	bgs_threshold = thresh;
+
+	records.write(DETECTION_FILE_MAGIC, 8);
+	records.write((const char *)&version, sizeof(version));
+	records.write((const char *)&bgs_history, sizeof(bgs_history));
+	records.write((const char *)&bgs_threshold, sizeof(bgs_threshold));
+	records.write((const char *)&path_length, sizeof(path_length));
+	records.write(video_path.c_str(), path_length);
+	header_size = (long long)records.tellp();
+
+	record_count = 0;
+	blob_size = 0;
+	index_entries.clear();
+	writing = true;
+
+	return records.good();
+}
+
+/**
+ *  @desc Appends a detection and its encoded images. The image offsets and sizes in the
+ *  record are filled in here.
+ *
+ *  @param DetectionRecord record - the detection
+ *  @param const vector<uchar> &src_image - encoded source image
+ *  @param const vector<uchar> &contour_image - encoded contour image
+ *
+ *  @returns false if the store isn't open for writing or a write failed
+ */
+bool DetectionStore::append(DetectionRecord record, const vector<uchar> &src_image, const vector<uchar> &contour_image)
+{
+	DetectionIndexEntry entry;
+
+	if (!writing)
+	{
+		return false;
+	}
+
+	record.src_offset = blob_size;
+	record.src_size = (unsigned int)src_image.size();
+	if (!src_image.empty())
+	{
+		blobs.write((const char *)&src_image[0], src_image.size());
+	}
+	blob_size += src_image.size();
+
+	record.contour_offset = blob_size;
+	record.contour_size = (unsigned int)contour_image.size();
+	if (!contour_image.empty())
+	{
+		blobs.write((const char *)&contour_image[0], contour_image.size());
+	}
+	blob_size += contour_image.size();
+
+	records.write((const char *)&record, sizeof(record));
+
+	if (record_count % DETECTION_INDEX_STRIDE == 0)
+	{
+		entry.frame_num = record.frame_num;
+		entry.mill_seconds = record.mill_seconds;
+		entry.record_index = record_count;
+		index.write((const char *)&entry, sizeof(entry));
+		index_entries.push_back(entry);
+	}
+	record_count++;
+
+	return records.good() && blobs.good() && index.good();
+}
+
+/**
+ *  @desc Pushes the appended records out to disk
+ */
+void DetectionStore::flush()
+{
+	if (writing)
+	{
+		blobs.flush();
+		records.flush();
+		index.flush();
+	}
+}
+
+/**
+ *  @desc Opens the store files of an earlier run and loads the sparse index
+ *
+ *  @param string base_path - path of the files without the extensions
+ *
+ *  @returns false if the files are missing or not a detection store of this version
+ */
+bool DetectionStore::open_for_reading(string base_path)
+{
+	char magic[8];
+	unsigned int version = 0, path_length = 0;
+	long long file_size;
+	DetectionIndexEntry entry;
+
+	close();
+	records.open(base_path + ".det", ios::in | ios::binary);
+	blobs.open(base_path + ".blob", ios::in | ios::binary);
+	index.open(base_path + ".idx", ios::in | ios::binary);
+	if (!records.is_open() || !blobs.is_open())
+	{
+		close();
+		return false;
+	}
+
+	records.read(magic, 8);
+	records.read((char *)&version, sizeof(version));
+	records.read((char *)&bgs_history, sizeof(bgs_history));
+	records.read((char *)&bgs_threshold, sizeof(bgs_threshold));
+	records.read((char *)&path_length, sizeof(path_length));
+	if (!records.good() || memcmp(magic, DETECTION_FILE_MAGIC, 8) != 0 || version < 1 || version > DETECTION_FILE_VERSION || path_length > 4096)
+	{
+		close();
+		return false;
+	}
+	video_path.assign(path_length, ' ');
+	if (path_length > 0)
+	{
+		records.read(&video_path[0], path_length);
+	}
+	header_size = (long long)records.tellg();
+	file_version = version;
+	record_size = version < 2 ? offsetof(DetectionRecord, clip_number) : sizeof(DetectionRecord);
+
+	records.seekg(0, ios::end);
+	file_size = (long long)records.tellg();
+	record_count = (unsigned int)((file_size - header_size) / record_size);	//a record cut short by a crash is ignored
+
+	index_entries.clear();
+	if (index.is_open())	//without an index the searches start from the first record
+	{
+		while (index.read((char *)&entry, sizeof(entry)))
+		{
+			if (entry.record_index < record_count)
+			{
+				index_entries.push_back(entry);
+			}
+		}
+	}
+
+	return true;
+}
+
+void DetectionStore::close()
+{
+	flush();
+	records.close();
+	blobs.close();
+	index.close();
+	records.clear();
+	blobs.clear();
+	index.clear();
+	writing = false;
+}
+
+unsigned int DetectionStore::get_record_count()
+{
+	return record_count;
+}
+
+/**
+ *  @desc Reads record n from a store opened for reading
+ *
+ *  @returns false if there is no such record
+ */
+bool DetectionStore::read_record(unsigned int n, DetectionRecord *record)
+{
+	if (writing || n >= record_count)
+	{
+		return false;
+	}
+
+	records.clear();
+	memset(record, 0, sizeof(DetectionRecord));	//older records leave the clip number 0
+	records.seekg(header_size + (long long)n * record_size);
+	records.read((char *)record, record_size);
+	return records.good();
+}
+
+/**
+ *  @desc Reads an image from the .blob file without decoding it
+ *
+ *  @param unsigned long long offset - position of the image
+ *  @param unsigned int size - number of encoded bytes
+ *  @param vector<uchar> *encoded - filled with the encoded bytes
+ *
+ *  @returns false if there is no image or it couldn't be read
+ */
+bool DetectionStore::read_encoded(unsigned long long offset, unsigned int size, vector<uchar> *encoded)
+{
+	encoded->resize(size);
+	if (writing || size == 0)
+	{
+		return false;
+	}
+
+	blobs.clear();
+	blobs.seekg(offset);
+	blobs.read((char *)&(*encoded)[0], size);
+	return blobs.good();
+}
+
+/**
+ *  @desc Reads and decodes an image from the .blob file
+ *
+ *  @param unsigned long long offset - position of the image
+ *  @param unsigned int size - number of encoded bytes
+ *
+ *  @returns Mat - the image, empty if it couldn't be read
+ */
+Mat DetectionStore::read_image(unsigned long long offset, unsigned int size)
+{
+	vector<uchar> encoded;
+
+	if (!read_encoded(offset, size, &encoded))
+	{
+		return Mat();
+	}
+	return imdecode(encoded, IMREAD_UNCHANGED);
+}
+
+/**
+ *  @desc Finds the first record at or after a frame
+ *
+ *  @param int frame_num - frame to look for
+ *
+ *  @returns unsigned int - the record number, or the record count if every record is earlier
+ */
+unsigned int DetectionStore::find_by_frame(int frame_num)
+{
+	DetectionRecord record;
+	unsigned int n = 0;
+
+	auto entry = lower_bound(index_entries.begin(), index_entries.end(), frame_num,
+		[](const DetectionIndexEntry &e, int value) { return e.frame_num < value; });
+	if (entry != index_entries.begin())
+	{
+		n = (entry - 1)->record_index;	//last indexed record before the frame, the answer is within the next stride
+	}
+
+	while (read_record(n, &record) && record.frame_num < frame_num)
+	{
+		n++;
+	}
+	return n;
+}
+
+/**
+ *  @desc Finds the first record at or after a video timestamp
+ *
+ *  @param int mill_seconds - timestamp to look for
+ *
+ *  @returns unsigned int - the record number, or the record count if every record is earlier
+ */
+unsigned int DetectionStore::find_by_time(int mill_seconds)
+{
+	DetectionRecord record;
+	unsigned int n = 0;
+
+	auto entry = lower_bound(index_entries.begin(), index_entries.end(), mill_seconds,
+		[](const DetectionIndexEntry &e, int value) { return e.mill_seconds < value; });
+	if (entry != index_entries.begin())
+	{
+		n = (entry - 1)->record_index;
+	}
+
+	while (read_record(n, &record) && record.mill_seconds < mill_seconds)
+	{
+		n++;
+	}
+	return n;
+}
+
+string DetectionStore::get_video_path()
+{
+	return video_path;
+}
+
+int DetectionStore::get_bgs_history()
+{
+	return bgs_history;
+}
+
+double DetectionStore::get_bgs_threshold()
+{
+	return bgs_threshold;
+}
+
+string DetectionStore::verdict_name(int code)
+{
+	switch (code)
+	{
+		case VERDICT_PEDESTRIAN:
+			return "Pedestrian";
+		case VERDICT_SOMETHING:
+			return "Something";
+		case VERDICT_NOISE:
+			return "Noise";
+		default:
+			return "Unknown";
+	}
+}
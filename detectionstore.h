@@ -0,0 +1,93 @@
+#ifndef DETECTIONSTORE_H
+#define DETECTIONSTORE_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <stddef.h>
+#include "opencv2/imgcodecs.hpp"
+#include "featuremodel.h"
+
+using namespace std;
+using namespace cv;
+
+#define DETECTION_FILE_MAGIC "ASCVDET"	//8 bytes including the terminator
+#define DETECTION_FILE_VERSION 2		//version 1 stores have no clips
+#define DETECTION_INDEX_STRIDE 64		//records between entries in the sparse index
+
+/**
+ *  @desc One detection as stored in the .det file. Every record is the same size so
+ *  record n can be read straight from its offset. The images are kept encoded in
+ *  the .blob file.
+ */
+struct DetectionRecord
+{
+	unsigned long long src_offset;		//position of the source image in the .blob file
+	unsigned long long contour_offset;	//position of the contour image in the .blob file
+	unsigned int src_size;
+	unsigned int contour_size;
+	int frame_num;
+	int mill_seconds;
+	int box_x, box_y, box_width, box_height;	//where the shape was in the frame
+	int verdict;						//Verdict, see featuremodel.h
+	int feature_score;					//number of features inside the trained ranges
+	int image_format;					//LogImageFormat the images were encoded with
+	int track_id;						//ShapeTracker ID of the shape, 0 if untracked
+	int clip_number;					//ClipRecorder clip of the event, 0 without one
+};
+
+/**
+ *  @desc Entry in the sparse index, written for every DETECTION_INDEX_STRIDE'th record
+ */
+struct DetectionIndexEntry
+{
+	int frame_num;
+	int mill_seconds;
+	unsigned int record_index;
+};
+
+class DetectionStore
+{
+	private:
+		fstream records;
+		fstream blobs;
+		fstream index;
+		vector<DetectionIndexEntry> index_entries;
+		unsigned int record_count;
+		unsigned long long blob_size;
+		long long header_size;
+		unsigned int file_version;
+		size_t record_size;				//version 1 records end before the clip number
+		bool writing;
+
+		string video_path;
+		int bgs_history;
+		double bgs_threshold;
+
+	public:
+		DetectionStore();
+		~DetectionStore();
+		bool open_for_writing(string base_path, string v_path, int history, double thresh);
+		bool append(DetectionRecord record, const vector<uchar> &src_image, const vector<uchar> &contour_image);
+		void flush();
+		bool open_for_reading(string base_path);
+		void close();
+
+		unsigned int get_record_count();
+		bool read_record(unsigned int n, DetectionRecord *record);
+		bool read_encoded(unsigned long long offset, unsigned int size, vector<uchar> *encoded);
+		Mat read_image(unsigned long long offset, unsigned int size);
+		unsigned int find_by_frame(int frame_num);
+		unsigned int find_by_time(int mill_seconds);
+
+		string get_video_path();
+		int get_bgs_history();
+		double get_bgs_threshold();
+
+		static string verdict_name(int code);
+};
+
+#endif
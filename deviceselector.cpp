@@ -0,0 +1,129 @@
+#include "deviceselector.h"
+
+/**
+ *	@file deviceselector.cpp
+ *  @desc Times a stream's front end on the OpenCL device and the CPU and keeps it on
+ *  whichever is faster. The first few frames of each trial are left out of the timing
+ *  so the OpenCL kernels being built, and the caches filling, aren't counted against
+ *  either device. begin_frame() and end_frame() must be called from the same thread
+ *  around each frame.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+DeviceSelector::DeviceSelector()
+	: mode(ACCEL_CPU), available(false), device(false), settled_device(false), phase(0), phase_frames(0),
+	device_ms(0), cpu_ms(0), device_frames(0), switches(0), start_ticks(0)
+{}
+
+/**
+ *  @desc Chooses the mode, call before the first frame
+ *
+ *  @param AccelMode accel_mode - CPU, OpenCL or automatic
+ */
+void DeviceSelector::set_mode(AccelMode accel_mode)
+{
+	mode = accel_mode;
+	available = mode != ACCEL_CPU && ocl::haveOpenCL();
+	device = available;
+	settled_device = available;
+	phase = 0;
+	phase_frames = 0;
+	device_ms = 0;
+	cpu_ms = 0;
+}
+
+AccelMode DeviceSelector::get_mode()
+{
+	return mode;
+}
+
+/**
+ *  @desc Starts timing a frame and says where it should run
+ *
+ *  @returns true if the frame should run on the OpenCL device
+ */
+bool DeviceSelector::begin_frame()
+{
+	if (mode == ACCEL_AUTO && available)
+	{
+		if (phase == 0 && phase_frames == DEVICE_TRIAL_FRAMES)
+		{
+			phase = 1;
+			phase_frames = 0;
+		}
+		else if (phase == 1 && phase_frames == DEVICE_TRIAL_FRAMES)
+		{
+			if ((device_ms <= cpu_ms) != settled_device)
+			{
+				switches++;
+			}
+			settled_device = device_ms <= cpu_ms;
+			phase = 2;
+			phase_frames = 0;
+		}
+		else if (phase == 2 && phase_frames == DEVICE_SETTLE_FRAMES)
+		{
+			phase = 0;
+			phase_frames = 0;
+			device_ms = 0;
+			cpu_ms = 0;
+		}
+		device = (phase == 0) || (phase == 2 && settled_device);
+	}
+
+	if (device)
+	{
+		device_frames++;
+	}
+	start_ticks = getTickCount();
+	return device;
+}
+
+/**
+ *  @desc Stops timing the frame started by begin_frame()
+ */
+void DeviceSelector::end_frame()
+{
+	double elapsed_ms = (getTickCount() - start_ticks) * 1000.0 / getTickFrequency();
+
+	phase_frames++;
+	if (phase < 2 && phase_frames > DEVICE_WARMUP_FRAMES)
+	{
+		if (phase == 0)
+		{
+			device_ms += elapsed_ms;
+		}
+		else
+		{
+			cpu_ms += elapsed_ms;
+		}
+	}
+}
+
+int DeviceSelector::get_device_frames()
+{
+	return device_frames;
+}
+
+int DeviceSelector::get_switches()
+{
+	return switches;
+}
+
+/**
+ *  @desc Describes the mode, for the stream report
+ */
+string DeviceSelector::describe()
+{
+	if (mode == ACCEL_CPU)
+	{
+		return "CPU";
+	}
+	if (!available)
+	{
+		return "CPU (no OpenCL device)";
+	}
+	return mode == ACCEL_AUTO ? "automatic" : "OpenCL";
+}
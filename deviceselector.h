@@ -0,0 +1,65 @@
+#ifndef DEVICESELECTOR_H
+#define DEVICESELECTOR_H
+
+#include <string>
+#include "opencv2/core.hpp"
+#include "opencv2/core/ocl.hpp"
+
+using namespace std;
+using namespace cv;
+
+#define DEVICE_TRIAL_FRAMES 30		//frames timed on each device when choosing between them
+#define DEVICE_WARMUP_FRAMES 3		//frames at the start of a trial left out of the timing
+#define DEVICE_SETTLE_FRAMES 900	//frames run on the chosen device before trying both again
+
+/**
+ *  @desc Where a stream runs background subtraction and noise filtering
+ */
+enum AccelMode
+{
+	ACCEL_CPU,			//always on the CPU
+	ACCEL_OPENCL,		//on the OpenCL device whenever there is one
+	ACCEL_AUTO			//whichever is faster for this stream at the moment
+};
+
+/**
+ *	@file deviceselector.h
+ *  @desc Chooses, frame by frame, whether a stream's front end runs on the OpenCL
+ *  device or the CPU. In ACCEL_AUTO mode both are timed for DEVICE_TRIAL_FRAMES frames
+ *  and the faster one is used for the next DEVICE_SETTLE_FRAMES frames. A device
+ *  shared by several streams gets slower as they queue work on it, so streams move
+ *  to the CPU when the device is busy and back when it frees up.
+ *
+ *  @param AccelMode mode - CPU, OpenCL or automatic
+ *  @param bool available - an OpenCL device was found
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class DeviceSelector
+{
+	private:
+		AccelMode mode;
+		bool available;
+		bool device;				//the current frame runs on the device
+		bool settled_device;		//choice made by the last trial
+		int phase;					//0 timing the device, 1 timing the CPU, 2 settled
+		int phase_frames;
+		double device_ms;
+		double cpu_ms;
+		int device_frames;
+		int switches;
+		int64 start_ticks;
+
+	public:
+		DeviceSelector();
+		void set_mode(AccelMode accel_mode);
+		AccelMode get_mode();
+		bool begin_frame();
+		void end_frame();
+		int get_device_frames();
+		int get_switches();
+		string describe();
+};
+
+#endif
@@ -0,0 +1,216 @@
+#include "featuremodel.h"
+
+/**
+ *	@file featuremodel.cpp
+ *  @desc A node is in range when min <= node < max on both axes, as
+ *  PeopleFinder::is_within_bound() has always checked it. Where the build supports
+ *  OpenCV's SIMD types one skeleton is scored 4 nodes at a time, and a batch is
+ *  scored 4 skeletons at a time, one node after another. Otherwise each node is
+ *  checked in turn.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+FeatureModel::FeatureModel()
+{
+	reset();
+}
+
+/**
+ *  @desc Empties every range, ready for training
+ */
+void FeatureModel::reset()
+{
+	int i;
+
+	for (i = 0; i < FEATURE_LANES; i++)
+	{
+		min_x[i] = i < FEATURE_NODES ? 1000 : INT_MAX;
+		min_y[i] = i < FEATURE_NODES ? 1000 : INT_MAX;
+		max_x[i] = i < FEATURE_NODES ? 0 : INT_MIN;
+		max_y[i] = i < FEATURE_NODES ? 0 : INT_MIN;
+	}
+}
+
+/**
+ *  @desc Widens the ranges to take in a training skeleton
+ *
+ *  @param const vector<Point> &nodes - positions of each feature in the skeleton
+ */
+void FeatureModel::widen(const vector<Point> &nodes)
+{
+	int i;
+
+	for (i = 0; i < FEATURE_NODES; i++)
+	{
+		min_x[i] = min(min_x[i], nodes[i].x);
+		min_y[i] = min(min_y[i], nodes[i].y);
+		max_x[i] = max(max_x[i], nodes[i].x);
+		max_y[i] = max(max_y[i], nodes[i].y);
+	}
+}
+
+/**
+ *  @desc Widens the ranges to take in the ranges of a model trained on other files
+ *
+ *  @param const FeatureModel &other - a model with at least one skeleton
+ */
+void FeatureModel::merge(const FeatureModel &other)
+{
+	int i;
+
+	for (i = 0; i < FEATURE_NODES; i++)
+	{
+		min_x[i] = min(min_x[i], other.min_x[i]);
+		min_y[i] = min(min_y[i], other.min_y[i]);
+		max_x[i] = max(max_x[i], other.max_x[i]);
+		max_y[i] = max(max_y[i], other.max_y[i]);
+	}
+}
+
+void FeatureModel::set_range(int node, Point min, Point max)
+{
+	min_x[node] = min.x;
+	min_y[node] = min.y;
+	max_x[node] = max.x;
+	max_y[node] = max.y;
+}
+
+Point FeatureModel::get_min(int node) const
+{
+	return Point(min_x[node], min_y[node]);
+}
+
+Point FeatureModel::get_max(int node) const
+{
+	return Point(max_x[node], max_y[node]);
+}
+
+/**
+ *  @desc Scores one skeleton
+ *
+ *  @param const vector<Point> &nodes - positions of each feature in the skeleton
+ *
+ *  @returns unsigned int - bit i set when node i is in range
+ */
+unsigned int FeatureModel::score_mask(const vector<Point> &nodes) const
+{
+	unsigned int mask = 0;
+	int i;
+
+#if CV_SIMD128
+	int xs[FEATURE_LANES] = { 0 }, ys[FEATURE_LANES] = { 0 };
+	v_int32x4 v_x, v_y, in_range;
+
+	for (i = 0; i < FEATURE_NODES; i++)
+	{
+		xs[i] = nodes[i].x;
+		ys[i] = nodes[i].y;
+	}
+	for (i = 0; i < FEATURE_LANES; i += 4)
+	{
+		v_x = v_load(xs + i);
+		v_y = v_load(ys + i);
+		in_range = (v_x >= v_load(min_x + i)) & (v_x < v_load(max_x + i)) & (v_y >= v_load(min_y + i)) & (v_y < v_load(max_y + i));
+		mask |= (unsigned int)v_signmask(in_range) << i;
+	}
+#else
+	for (i = 0; i < FEATURE_NODES; i++)
+	{
+		if (nodes[i].x >= min_x[i] && nodes[i].x < max_x[i] && nodes[i].y >= min_y[i] && nodes[i].y < max_y[i])
+		{
+			mask |= 1u << i;
+		}
+	}
+#endif
+
+	return mask;
+}
+
+/**
+ *  @desc Scores every skeleton of a batch in one pass
+ *
+ *  @param const SkeletonBatch &batch - the skeletons
+ *  @param vector<unsigned int> *masks - filled with the bitmask of each skeleton
+ */
+void FeatureModel::score_batch(const SkeletonBatch &batch, vector<unsigned int> *masks) const
+{
+	int i, s;
+
+	masks->assign(batch.stride, 0);
+
+#if CV_SIMD128
+	v_int32x4 v_x, v_y, in_range, v_mask;
+
+	for (s = 0; s < batch.stride; s += 4)
+	{
+		v_mask = v_setall_s32(0);
+		for (i = 0; i < FEATURE_NODES; i++)
+		{
+			v_x = v_load(&batch.xs[i * batch.stride + s]);
+			v_y = v_load(&batch.ys[i * batch.stride + s]);
+			in_range = (v_x >= v_setall_s32(min_x[i])) & (v_x < v_setall_s32(max_x[i])) &
+				(v_y >= v_setall_s32(min_y[i])) & (v_y < v_setall_s32(max_y[i]));
+			v_mask = v_mask | (in_range & v_setall_s32(1 << i));
+		}
+		v_store(&(*masks)[s], v_reinterpret_as_u32(v_mask));
+	}
+#else
+	int x, y;
+
+	for (i = 0; i < FEATURE_NODES; i++)
+	{
+		for (s = 0; s < batch.count; s++)
+		{
+			x = batch.xs[i * batch.stride + s];
+			y = batch.ys[i * batch.stride + s];
+			if (x >= min_x[i] && x < max_x[i] && y >= min_y[i] && y < max_y[i])
+			{
+				(*masks)[s] |= 1u << i;
+			}
+		}
+	}
+#endif
+
+	masks->resize(batch.count);
+}
+
+/**
+ *  @desc Counts the features in range
+ *
+ *  @param unsigned int mask - bitmask from score_mask() or score_batch()
+ *
+ *  @returns int feature_score - number of bits set
+ */
+int FeatureModel::mask_score(unsigned int mask)
+{
+	int feature_score = 0;
+
+	while (mask != 0)
+	{
+		mask &= mask - 1;
+		feature_score++;
+	}
+	return feature_score;
+}
+
+/**
+ *  @desc Turns a feature score into the classification
+ *
+ *  @param int feature_score - number of features in range
+ *
+ *  @returns Verdict - the classification
+ */
+Verdict FeatureModel::judge_score(int feature_score)
+{
+	if (feature_score >= PEDESTRIAN_MIN_SCORE)
+	{
+		return VERDICT_PEDESTRIAN;
+	}
+	if (feature_score >= SOMETHING_MIN_SCORE)
+	{
+		return VERDICT_SOMETHING;
+	}
+	return VERDICT_NOISE;
+}
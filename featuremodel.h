@@ -0,0 +1,53 @@
+#ifndef FEATUREMODEL_H
+#define FEATUREMODEL_H
+
+#include <vector>
+#include "opencv2/core.hpp"
+#include <opencv2/core/hal/intrin.hpp>
+#include "skeletonbatch.h"
+
+using namespace std;
+using namespace cv;
+
+#define FEATURE_LANES 12			//FEATURE_NODES rounded up to whole 4 lane SIMD registers
+#define PEDESTRIAN_MIN_SCORE 7		//features in range for a pedestrian
+#define SOMETHING_MIN_SCORE 3		//features in range for something that isn't noise
+
+enum Verdict { VERDICT_NONE = -1, VERDICT_NOISE = 0, VERDICT_SOMETHING = 1, VERDICT_PEDESTRIAN = 2 };	//the codes stored in DetectionRecord::verdict
+
+/**
+ *	@file featuremodel.h
+ *  @desc The trained ranges of the PeopleFinder, the smallest and largest x and y of
+ *  each feature node, kept as four arrays so a register of 4 ranges is one load. The
+ *  padding lane past the last node has an empty range, so it never scores.
+ *
+ *  A skeleton is scored as a bitmask with bit i set when node i is in range, and its
+ *  score is the number of bits set. The verdicts are an enum, turned into a name only
+ *  where they are written out, see DetectionStore::verdict_name().
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class FeatureModel
+{
+	private:
+		int min_x[FEATURE_LANES];
+		int min_y[FEATURE_LANES];
+		int max_x[FEATURE_LANES];
+		int max_y[FEATURE_LANES];
+
+	public:
+		FeatureModel();
+		void reset();
+		void widen(const vector<Point> &nodes);
+		void merge(const FeatureModel &other);
+		void set_range(int node, Point min, Point max);
+		Point get_min(int node) const;
+		Point get_max(int node) const;
+		unsigned int score_mask(const vector<Point> &nodes) const;
+		void score_batch(const SkeletonBatch &batch, vector<unsigned int> *masks) const;
+		static int mask_score(unsigned int mask);
+		static Verdict judge_score(int feature_score);
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef FRAMEJOB_H
+#define FRAMEJOB_H
+
+#include <string>
+#include <vector>
+#include "opencv2/core.hpp"
+#include "componentblob.h"
+#include "featuremodel.h"
+
+using namespace std;
+using namespace cv;
+
+/**
+ *	@file framejob.h
+ *  @desc Everything the pipeline knows about one video frame. Each stage fills in its
+ *  own fields before the job is handed to the next stage, so no stage has to reach
+ *  back into the state of another.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+struct FrameJob
+{
+	int frame_number;
+	int milliseconds;
+	bool run_detection;				//true when the PeopleFinder should be run on this frame
+	bool warm_up;					//true while only priming the background models before a segment
+
+	Mat frame;						//source frame from the capture
+	Mat grey;						//greyscale frame, only when the capture decodes straight to grey
+	Mat filtered_mask;				//BGS frame with the noise reduced
+	Mat contour_image;				//contour and hull annotations, only drawn when displayed
+
+	vector<vector<Point>> contours;
+	vector<vector<Point>> hull_list;
+	int hull_size;					//hulls, or blobs when the ComponentDetector is used
+	vector<ComponentBlob> blobs;	//only filled by the ComponentDetector
+	vector<BlobRun> blob_runs;
+	vector<Rect> hull_boxes;		//box of each hull in the mask
+
+	vector<Mat> src_shapes;			//source images of the larger shapes
+	vector<Mat> large_shapes;		//contour shapes sent to the PeopleFinder
+	vector<Rect> shape_boxes;		//position of each larger shape in the frame
+	vector<int> hull_tracks;		//ShapeTracker ID of each hull
+	vector<int> shape_tracks;		//ShapeTracker ID of each larger shape
+	vector<Verdict> verdicts;
+	vector<int> scores;				//number of features in range for each shape
+
+	FrameJob()
+		: frame_number(0), milliseconds(0), run_detection(false), warm_up(false), hull_size(0)
+	{}
+};
+
+#endif
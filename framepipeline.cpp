@@ -0,0 +1,137 @@
+#include "framepipeline.h"
+
+/**
+ *	@file framepipeline.cpp
+ *  @desc Runs the video analysis as a chain of stages, each on its own thread, joined
+ *  by bounded queues. The source produces frame jobs, every stage works on one job at
+ *  a time in frame order, and the sink consumes the finished jobs on the calling
+ *  thread (so it can safely use the display windows).
+ *
+ *  A stage that falls behind fills its input queue, which blocks the stages before it
+ *  rather than letting frames pile up in memory.
+ *
+ *  @param size_t queue_size - number of jobs that can wait between two stages
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+FramePipeline::FramePipeline(size_t q_size)
+	: queue_size(q_size), stopping(false)
+{}
+
+/**
+ *  @desc Sets the function that fills each new job, it should return false once there
+ *  are no more frames.
+ */
+void FramePipeline::set_source(function<bool(FrameJob *)> src)
+{
+	source = src;
+}
+
+/**
+ *  @desc Appends a stage to the end of the pipeline, stages run in the order added
+ */
+void FramePipeline::add_stage(function<void(FrameJob *)> stage)
+{
+	stages.push_back(stage);
+}
+
+/**
+ *  @desc Sets the function that receives finished jobs, it should return false to
+ *  stop the pipeline early.
+ */
+void FramePipeline::set_sink(function<bool(FrameJob *)> snk)
+{
+	sink = snk;
+}
+
+/**
+ *  @desc Starts the source and stage threads and runs the sink until the source is
+ *  exhausted or the sink asks to stop. Jobs still in flight after a stop request are
+ *  drained without being given to the sink.
+ *
+ *  @returns int - number of jobs consumed by the sink
+ */
+int FramePipeline::run()
+{
+	vector<BoundedQueue<FrameJob> *> queues;
+	vector<thread> workers;
+	FrameJob job;
+	int consumed = 0;
+	int i;
+
+	stopping = false;
+	for (i = 0; i <= stages.size(); i++)
+	{
+		queues.push_back(new BoundedQueue<FrameJob>(queue_size));
+	}
+
+	workers.push_back(thread(&FramePipeline::run_source, this, queues[0]));
+	for (i = 0; i < stages.size(); i++)
+	{
+		workers.push_back(thread(&FramePipeline::run_stage, this, i, queues[i], queues[i + 1]));
+	}
+
+	while (queues.back()->pop(&job))
+	{
+		if (!stopping)
+		{
+			if (!sink(&job))
+			{
+				stop();
+			}
+			consumed++;
+		}
+	}
+
+	for (i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+	for (i = 0; i < queues.size(); i++)
+	{
+		delete queues[i];
+	}
+
+	return consumed;
+}
+
+/**
+ *  @desc Asks the source to stop producing jobs, the remaining jobs are flushed
+ */
+void FramePipeline::stop()
+{
+	stopping = true;
+}
+
+void FramePipeline::run_source(BoundedQueue<FrameJob> *out)
+{
+	while (!stopping)
+	{
+		FrameJob job;
+		if (!source(&job) || !out->push(move(job)))
+		{
+			break;
+		}
+	}
+	out->close();
+}
+
+void FramePipeline::run_stage(int stage, BoundedQueue<FrameJob> *in, BoundedQueue<FrameJob> *out)
+{
+	FrameJob job;
+
+	while (in->pop(&job))
+	{
+		if (!stopping)
+		{
+			stages[stage](&job);
+		}
+		if (!out->push(move(job)))
+		{
+			break;
+		}
+	}
+	out->close();
+}
@@ -0,0 +1,36 @@
+#ifndef FRAMEPIPELINE_H
+#define FRAMEPIPELINE_H
+
+#include <iostream>
+#include <stdio.h>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include "boundedqueue.h"
+#include "framejob.h"
+
+using namespace std;
+
+class FramePipeline
+{
+	private:
+		size_t queue_size;
+		function<bool(FrameJob *)> source;
+		vector<function<void(FrameJob *)>> stages;
+		function<bool(FrameJob *)> sink;
+		atomic<bool> stopping;
+
+		void run_source(BoundedQueue<FrameJob> *out);
+		void run_stage(int stage, BoundedQueue<FrameJob> *in, BoundedQueue<FrameJob> *out);
+
+	public:
+		FramePipeline(size_t q_size);
+		void set_source(function<bool(FrameJob *)> src);
+		void add_stage(function<void(FrameJob *)> stage);
+		void set_sink(function<bool(FrameJob *)> snk);
+		int run();
+		void stop();
+};
+
+#endif
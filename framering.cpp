@@ -0,0 +1,129 @@
+#include "framering.h"
+
+/**
+ *	@file framering.cpp
+ *  @desc A pushed frame is copied into its slot under the lock, so a reader never sees
+ *  half a frame. A slot that is being read is only overwritten once the reader is
+ *  done, which holds push() up for at most one read at a time.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+FrameRing::FrameRing()
+	: pushed(0)
+{}
+
+/**
+ *  @desc Allocates every slot and empties the ring
+ *
+ *  @param Size size - size of the frames
+ *  @param int type - OpenCV type of the frames
+ *  @param int capacity - frames to keep
+ */
+void FrameRing::allocate(Size size, int type, int capacity)
+{
+	lock_guard<mutex> lock(ring_mutex);
+	int i;
+
+	slots.resize(capacity);
+	for (i = 0; i < capacity; i++)
+	{
+		slots[i].image.create(size, type);
+		slots[i].reading = false;
+	}
+	pushed = 0;
+}
+
+/**
+ *  @desc Copies a frame over the oldest one. A frame of another size or type than the
+ *  slots is kept as a black frame, so the slots are never reallocated.
+ *
+ *  @param const Mat &frame - the newest frame
+ */
+void FrameRing::push(const Mat &frame)
+{
+	unique_lock<mutex> lock(ring_mutex);
+	RingSlot *slot;
+
+	if (slots.empty())
+	{
+		return;
+	}
+	slot = &slots[pushed % slots.size()];
+	slot_released.wait(lock, [slot] { return !slot->reading; });
+
+	if (frame.size() == slot->image.size() && frame.type() == slot->image.type())
+	{
+		frame.copyTo(slot->image);
+	}
+	else
+	{
+		slot->image.setTo(Scalar::all(0));
+	}
+	pushed++;
+}
+
+/**
+ *  @desc Borrows the pixels of a frame still in the ring, until end_read()
+ *
+ *  @param long long n - number of the frame
+ *  @param Mat *image - shares the slot's pixels
+ *
+ *  @returns false if the frame hasn't been pushed yet or has been overwritten
+ */
+bool FrameRing::begin_read(long long n, Mat *image)
+{
+	lock_guard<mutex> lock(ring_mutex);
+
+	if (slots.empty() || n >= pushed || n < pushed - (long long)slots.size() || n < 0)
+	{
+		return false;
+	}
+	slots[n % slots.size()].reading = true;
+	*image = slots[n % slots.size()].image;
+	return true;
+}
+
+/**
+ *  @desc Hands back a frame from begin_read(), the image must not be used afterwards
+ */
+void FrameRing::end_read(long long n)
+{
+	{
+		lock_guard<mutex> lock(ring_mutex);
+
+		slots[n % slots.size()].reading = false;
+	}
+	slot_released.notify_all();
+}
+
+long long FrameRing::get_pushed()
+{
+	lock_guard<mutex> lock(ring_mutex);
+
+	return pushed;
+}
+
+/**
+ *  @returns long long - number of the oldest frame still in the ring
+ */
+long long FrameRing::get_oldest()
+{
+	lock_guard<mutex> lock(ring_mutex);
+
+	return max(pushed - (long long)slots.size(), 0ll);
+}
+
+int FrameRing::get_capacity()
+{
+	return (int)slots.size();
+}
+
+/**
+ *  @returns size_t - bytes of pixels allocated for the slots
+ */
+size_t FrameRing::get_memory_bytes()
+{
+	return slots.empty() ? 0 : slots.size() * slots[0].image.total() * slots[0].image.elemSize();
+}
@@ -0,0 +1,56 @@
+#ifndef FRAMERING_H
+#define FRAMERING_H
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include "opencv2/core.hpp"
+
+using namespace std;
+using namespace cv;
+
+/**
+ *  @desc One frame held by the ring
+ */
+struct RingSlot
+{
+	Mat image;				//allocated once by allocate(), every frame is copied into it
+	bool reading;			//a reader has the pixels, push() waits before overwriting them
+};
+
+/**
+ *	@file framering.h
+ *  @desc The most recent frames of a stream, in a fixed number of images allocated up
+ *  front. Frames are numbered in the order they are pushed from 0, and frame n is
+ *  kept in slot n % capacity until capacity more frames have been pushed, so memory
+ *  use never grows past allocate(). A reader borrows a slot's pixels with begin_read()
+ *  and hands them back with end_read(). Frames are pushed from one thread and read
+ *  from another.
+ *
+ *  @param vector<RingSlot> slots - the images
+ *  @param long long pushed - frames pushed so far, the newest is pushed - 1
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class FrameRing
+{
+	private:
+		vector<RingSlot> slots;
+		long long pushed;
+		mutex ring_mutex;
+		condition_variable slot_released;
+
+	public:
+		FrameRing();
+		void allocate(Size size, int type, int capacity);
+		void push(const Mat &frame);
+		bool begin_read(long long n, Mat *image);
+		void end_read(long long n);
+		long long get_pushed();
+		long long get_oldest();
+		int get_capacity();
+		size_t get_memory_bytes();
+};
+
+#endif
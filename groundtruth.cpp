@@ -0,0 +1,161 @@
+#include "groundtruth.h"
+
+/**
+ *	@file groundtruth.cpp
+ *  @desc Reads the labels for a video and scores detections against them. A truth file
+ *  has one pedestrian per line as "frame x y width height" in pixels of the full frame,
+ *  a line with only a frame number marks a frame labelled with nobody in view, and
+ *  lines starting with '#' are skipped. Frame numbers count from 1, as in the record log,
+ *  so the rows of ground_truth_experiment.xlsx can be saved in this layout.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+GroundTruth::GroundTruth()
+{}
+
+/**
+ *  @desc Reads the labels from a truth file, adding them to any already read
+ *
+ *  @param string path - path of the truth file
+ *
+ *  @returns true if the file was read
+ */
+bool GroundTruth::load(string path)
+{
+	ifstream file(path);
+	string line;
+	int frame_number, x, y, width, height;
+
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	while (getline(file, line))
+	{
+		if (line.empty() || line[0] == '#')
+		{
+			continue;
+		}
+
+		istringstream fields(line);
+		if (!(fields >> frame_number))
+		{
+			cout << "Skipping truth line \"" << line << "\" in " << path << endl;
+		}
+		else if (fields >> x >> y >> width >> height)
+		{
+			add_label(frame_number, Rect(x, y, width, height));
+		}
+		else if (fields.eof())
+		{
+			add_empty_frame(frame_number);
+		}
+		else
+		{
+			cout << "Skipping truth line \"" << line << "\" in " << path << endl;
+		}
+	}
+
+	return true;
+}
+
+void GroundTruth::add_label(int frame_number, Rect box)
+{
+	labels[frame_number].push_back(box);
+}
+
+/**
+ *  @desc Marks a frame as labelled with no pedestrians, so any detection on it is a
+ *  false alarm
+ */
+void GroundTruth::add_empty_frame(int frame_number)
+{
+	labels[frame_number];
+}
+
+int GroundTruth::get_labelled_frames()
+{
+	return (int)labels.size();
+}
+
+bool GroundTruth::is_labelled(int frame_number)
+{
+	return labels.count(frame_number) > 0;
+}
+
+/**
+ *  @returns vector<Rect> - the pedestrians labelled in the frame, empty if it has none or wasn't labelled
+ */
+vector<Rect> GroundTruth::get_boxes(int frame_number)
+{
+	map<int, vector<Rect>>::iterator found = labels.find(frame_number);
+
+	return found == labels.end() ? vector<Rect>() : found->second;
+}
+
+/**
+ *  @desc Matches the detections on a labelled frame to its pedestrians, best overlap
+ *  first. Each pedestrian is found by at most one detection overlapping it by
+ *  GROUND_TRUTH_MIN_OVERLAP, the other detections are false alarms. Frames that
+ *  weren't labelled add nothing.
+ *
+ *  @param int frame_number - the frame, from 1
+ *  @param const vector<Rect> &detections - pedestrians found in the frame
+ *  @param int *true_positives - add the pedestrians found
+ *  @param int *false_positives - add the detections that matched nobody
+ *  @param int *false_negatives - add the pedestrians missed
+ */
+void GroundTruth::match(int frame_number, const vector<Rect> &detections, int *true_positives, int *false_positives, int *false_negatives)
+{
+	vector<Rect> truth;
+	vector<bool> truth_used, detection_used;
+	double best, overlap;
+	int best_truth, best_detection, matched = 0;
+	int i, j;
+
+	if (!is_labelled(frame_number))
+	{
+		return;
+	}
+	truth = get_boxes(frame_number);
+	truth_used.assign(truth.size(), false);
+	detection_used.assign(detections.size(), false);
+
+	while (true)
+	{
+		best = GROUND_TRUTH_MIN_OVERLAP;
+		best_truth = -1;
+		best_detection = -1;
+		for (i = 0; i < truth.size(); i++)
+		{
+			for (j = 0; j < detections.size(); j++)
+			{
+				if (truth_used[i] || detection_used[j])
+				{
+					continue;
+				}
+				overlap = ShapeTracker::overlap(truth[i], detections[j]);
+				if (overlap >= best)
+				{
+					best = overlap;
+					best_truth = i;
+					best_detection = j;
+				}
+			}
+		}
+		if (best_truth < 0)
+		{
+			break;
+		}
+		truth_used[best_truth] = true;
+		detection_used[best_detection] = true;
+		matched++;
+	}
+
+	*true_positives += matched;
+	*false_positives += (int)detections.size() - matched;
+	*false_negatives += (int)truth.size() - matched;
+}
@@ -0,0 +1,46 @@
+#ifndef GROUNDTRUTH_H
+#define GROUNDTRUTH_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include "opencv2/core.hpp"
+#include "shapetracker.h"
+
+using namespace std;
+using namespace cv;
+
+#define GROUND_TRUTH_MIN_OVERLAP 0.5	//overlap a detection needs with a labelled pedestrian to count as finding it
+
+/**
+ *	@file groundtruth.h
+ *  @desc The pedestrians labelled by hand in some frames of a video, read from
+ *  <video path>.truth. Detections on a labelled frame are matched to the labels to
+ *  count the pedestrians found, missed and the false alarms. Frames that were never
+ *  labelled are not scored.
+ *
+ *  @param map<int, vector<Rect>> labels - pedestrian boxes of each labelled frame, by frame number
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class GroundTruth
+{
+	private:
+		map<int, vector<Rect>> labels;
+
+	public:
+		GroundTruth();
+		bool load(string path);
+		void add_label(int frame_number, Rect box);
+		void add_empty_frame(int frame_number);
+		int get_labelled_frames();
+		bool is_labelled(int frame_number);
+		vector<Rect> get_boxes(int frame_number);
+		void match(int frame_number, const vector<Rect> &detections, int *true_positives, int *false_positives, int *false_negatives);
+};
+
+#endif
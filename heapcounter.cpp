@@ -0,0 +1,55 @@
+#include "heapcounter.h"
+#include <new>
+#include <stdlib.h>
+
+static atomic<bool> counting_allocations(false);
+static atomic<long long> heap_allocation_count(0);
+
+void *operator new(size_t size)
+{
+	void *memory;
+
+	if (counting_allocations.load(memory_order_relaxed))
+	{
+		heap_allocation_count.fetch_add(1, memory_order_relaxed);
+	}
+	memory = malloc(size == 0 ? 1 : size);
+	if (memory == NULL)
+	{
+		throw bad_alloc();
+	}
+	return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+	free(memory);
+}
+
+/**
+ *  @desc Resets the count and starts counting
+ */
+void HeapCounter::start()
+{
+	heap_allocation_count.store(0, memory_order_relaxed);
+	counting_allocations.store(true, memory_order_relaxed);
+}
+
+/**
+ *  @desc Stops counting
+ *
+ *  @returns long long - the allocations made since start()
+ */
+long long HeapCounter::stop()
+{
+	counting_allocations.store(false, memory_order_relaxed);
+	return heap_allocation_count.load(memory_order_relaxed);
+}
+
+/**
+ *  @returns long long - the allocations counted so far
+ */
+long long HeapCounter::get_count()
+{
+	return heap_allocation_count.load(memory_order_relaxed);
+}
@@ -0,0 +1,26 @@
+#ifndef HEAPCOUNTER_H
+#define HEAPCOUNTER_H
+
+#include <atomic>
+
+using namespace std;
+
+/**
+ *	@file heapcounter.h
+ *  @desc Counts the heap allocations made through operator new between start() and
+ *  stop(). heapcounter.cpp replaces the global operator new and delete, outside of a
+ *  count they only pay for one relaxed load of the flag. Works in every build, unlike
+ *  the debug CRT's allocation hook. Allocations from every thread are counted.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class HeapCounter
+{
+	public:
+		static void start();
+		static long long stop();
+		static long long get_count();
+};
+
+#endif
@@ -0,0 +1,41 @@
+#include "knnmodel.h"
+
+/**
+ *	@file knnmodel.cpp
+ *  @desc Passes each zone through OpenCV's KNN subtractor, with shadow detection off
+ *  as BGS has always run it.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+KnnModel::KnnModel(int history, double threshold)
+	: knn(createBackgroundSubtractorKNN(history, threshold, false))
+{}
+
+void KnnModel::apply(InputArray grey, OutputArray fgmask)
+{
+	frame_size = grey.size();
+	knn->apply(grey, fgmask);
+}
+
+bool KnnModel::runs_on_device()
+{
+	return true;
+}
+
+/**
+ *  @desc Estimates the model's memory from OpenCV's layout, three sets of NSamples
+ *  samples per pixel of a value and a flag byte each, plus three sample indices
+ *
+ *  @returns size_t - bytes held for the zone, 0 before the first frame
+ */
+size_t KnnModel::get_memory_bytes()
+{
+	return (size_t)frame_size.area() * (3 * knn->getNSamples() * 2 + 3);
+}
+
+string KnnModel::get_name()
+{
+	return "KNN";
+}
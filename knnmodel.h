@@ -0,0 +1,35 @@
+#ifndef KNNMODEL_H
+#define KNNMODEL_H
+
+#include <opencv2/video.hpp>
+#include "backgroundmodel.h"
+
+using namespace std;
+using namespace cv;
+
+/**
+ *	@file knnmodel.h
+ *  @desc OpenCV's KNN background subtractor behind the BackgroundModel interface. Takes
+ *  a Mat or a UMat, so it also runs on the OpenCL device.
+ *
+ *  @param int history - BGS history length
+ *  @param double threshold - BGS squared distance to threshold
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class KnnModel : public BackgroundModel
+{
+	private:
+		Ptr<BackgroundSubtractorKNN> knn;
+		Size frame_size;
+
+	public:
+		KnnModel(int history, double threshold);
+		void apply(InputArray grey, OutputArray fgmask);
+		bool runs_on_device();
+		size_t get_memory_bytes();
+		string get_name();
+};
+
+#endif
@@ -0,0 +1,334 @@
+#include "livesource.h"
+
+/**
+ *	@file livesource.cpp
+ *  @desc The reader thread reads frames as fast as the camera sends them. Each one goes
+ *  into the jitter buffer, pushing out the oldest when the buffer is full, so a slow
+ *  analysis never makes the camera's own buffer back up. read() hands out the oldest
+ *  frame that is still fresh, which smooths out bursts from the network, and drops any
+ *  that have waited longer than LIVE_MAX_LATENCY_MS.
+ *
+ *  When the camera stops sending frames, the connection is closed and reopened. The
+ *  wait doubles after each failed attempt, up to LIVE_RECONNECT_MAX_MS. A camera that
+ *  comes back at another resolution has its frames resized to the first one's size,
+ *  so the background models carry on. How quickly a silent camera is noticed depends
+ *  on the backend, FFmpeg gives up on a read after 30 seconds.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+mutex LiveSource::open_sources_lock;
+vector<LiveSource *> LiveSource::open_sources;
+
+LiveSource::LiveSource()
+	: running(false), connected(false), start_ticks(0), frames_delivered(0), frames_dropped(0), reconnects(0), last_milliseconds(0)
+{}
+
+LiveSource::~LiveSource()
+{
+	release();
+}
+
+/**
+ *  @desc Checks whether a video path is a network camera rather than a file
+ *
+ *  @param const string &path - path or URL of the video
+ *
+ *  @returns true for rtsp://, rtsps://, http:// and https:// URLs
+ */
+bool LiveSource::is_live_url(const string &path)
+{
+	return path.compare(0, 7, "rtsp://") == 0 || path.compare(0, 8, "rtsps://") == 0
+		|| path.compare(0, 7, "http://") == 0 || path.compare(0, 8, "https://") == 0;
+}
+
+/**
+ *  @desc Hides the user name and password of a camera URL, for printing it
+ *
+ *  @param const string &path - path or URL of the video
+ *
+ *  @returns string - the URL with any user:password@ replaced by ***@, a file path unchanged
+ */
+string LiveSource::mask_credentials(const string &path)
+{
+	size_t scheme_end = path.find("://"), host_start, host_end, at;
+
+	if (scheme_end == string::npos)
+	{
+		return path;
+	}
+	host_start = scheme_end + 3;
+	host_end = path.find_first_of("/?#", host_start);
+	at = path.rfind('@', host_end == string::npos ? path.size() : host_end);
+	if (at == string::npos || at < host_start)
+	{
+		return path;
+	}
+	return path.substr(0, host_start) + "***" + path.substr(at);
+}
+
+/**
+ *  @desc Chooses the backend and greyscale mode, call before open(). Frame skipping is
+ *  ignored, the jitter buffer already drops frames the analysis can't keep up with.
+ */
+void LiveSource::set_settings(const CaptureSettings &capture_settings)
+{
+	capture.set_settings(capture_settings);
+}
+
+/**
+ *  @desc Connects to the camera and starts the reader thread. The first connection is
+ *  made here so a wrong URL is reported straight away.
+ *
+ *  @param const string &camera_url - RTSP or HTTP URL of the camera
+ *
+ *  @returns false if the camera couldn't be opened
+ */
+bool LiveSource::open(const string &camera_url)
+{
+	release();
+
+	url = camera_url;
+	buffer.clear();
+	frame_size = Size();
+	frames_delivered = 0;
+	frames_dropped = 0;
+	reconnects = 0;
+	last_milliseconds = 0;
+
+	if (!capture.open(url))
+	{
+		return false;
+	}
+	capture.set(CAP_PROP_BUFFERSIZE, 1);	//only some backends honour this, the jitter buffer bounds the latency either way
+
+	start_ticks = getTickCount();
+	connected = true;
+	running = true;
+	reader = thread(&LiveSource::read_loop, this);
+
+	lock_guard<mutex> guard(open_sources_lock);
+	open_sources.push_back(this);
+	return true;
+}
+
+/**
+ *  @desc Waits for the next fresh frame. Frames that waited longer than
+ *  LIVE_MAX_LATENCY_MS are dropped, unless it is the only one. While the camera is
+ *  reconnecting this keeps waiting.
+ *
+ *  @param Mat *frame - the colour frame, or the grey frame in greyscale mode
+ *  @param Mat *grey - the grey frame in greyscale mode
+ *
+ *  @returns false once stop() has been called
+ */
+bool LiveSource::read(Mat *frame, Mat *grey)
+{
+	unique_lock<mutex> guard(lock);
+	int64 stale_ticks = (int64)(LIVE_MAX_LATENCY_MS * getTickFrequency() / 1000.0);
+
+	has_frame.wait(guard, [this] { return !running || !buffer.empty(); });
+	if (buffer.empty())
+	{
+		return false;
+	}
+
+	while (buffer.size() > 1 && getTickCount() - buffer.front().ticks > stale_ticks)
+	{
+		buffer.pop_front();
+		frames_dropped++;
+	}
+
+	*frame = buffer.front().frame;
+	*grey = buffer.front().grey;
+	last_milliseconds = (int)((buffer.front().ticks - start_ticks) * 1000.0 / getTickFrequency());
+	buffer.pop_front();
+	frames_delivered++;
+	return true;
+}
+
+/**
+ *  @desc Wakes read() and asks the reader thread to finish, without waiting for it.
+ *  Safe to call from any thread.
+ */
+void LiveSource::stop()
+{
+	{
+		lock_guard<mutex> guard(lock);
+		running = false;
+	}
+	has_frame.notify_all();
+}
+
+/**
+ *  @desc Calls stop() on every open source, for ending every live stream at once from
+ *  the console's Ctrl+C handler
+ */
+void LiveSource::stop_all()
+{
+	lock_guard<mutex> guard(open_sources_lock);
+	int i;
+
+	for (i = 0; i < open_sources.size(); i++)
+	{
+		open_sources[i]->stop();
+	}
+}
+
+/**
+ *  @desc Stops the reader thread and closes the camera
+ */
+void LiveSource::release()
+{
+	{
+		lock_guard<mutex> guard(open_sources_lock);
+
+		open_sources.erase(remove(open_sources.begin(), open_sources.end(), this), open_sources.end());
+	}
+	stop();
+	if (reader.joinable())
+	{
+		reader.join();
+	}
+	capture.release();
+	connected = false;
+}
+
+/**
+ *  @desc Number of frames handed out by read(), counting from 1
+ */
+int LiveSource::get_frame_number()
+{
+	return frames_delivered;
+}
+
+/**
+ *  @desc When the last frame read arrived, in ms since the camera was opened
+ */
+int LiveSource::get_milliseconds()
+{
+	return last_milliseconds;
+}
+
+/**
+ *  @desc Frames dropped by the jitter buffer, either pushed out or stale
+ */
+int LiveSource::get_frames_dropped()
+{
+	return frames_dropped;
+}
+
+int LiveSource::get_reconnects()
+{
+	return reconnects;
+}
+
+bool LiveSource::is_connected()
+{
+	return connected;
+}
+
+string LiveSource::get_backend_name()
+{
+	return capture.get_backend_name();
+}
+
+/**
+ *  @desc Reader thread, reads frames into the jitter buffer and reconnects whenever the
+ *  camera stops sending them
+ */
+void LiveSource::read_loop()
+{
+	Mat frame, grey;
+
+	while (running)
+	{
+		frame = Mat();	//fresh images every time, the buffered ones are still in use
+		grey = Mat();
+		if (!capture.read(&frame, &grey))
+		{
+			if (!reconnect())
+			{
+				break;
+			}
+			continue;
+		}
+		push_frame(frame, grey);
+	}
+	stop();		//wakes a waiting read()
+}
+
+/**
+ *  @desc Adds a frame to the jitter buffer, dropping the oldest if it is full
+ */
+void LiveSource::push_frame(Mat frame, Mat grey)
+{
+	LiveFrame live_frame;
+
+	if (frame_size.area() == 0)
+	{
+		frame_size = frame.size();
+	}
+	else if (frame.size() != frame_size)	//the camera came back at another resolution
+	{
+		resize(frame, frame, frame_size, 0, 0, INTER_AREA);
+		if (!grey.empty())
+		{
+			grey = frame;	//in greyscale mode the frame is the grey image
+		}
+	}
+
+	live_frame.frame = frame;
+	live_frame.grey = grey;
+	live_frame.ticks = getTickCount();
+
+	{
+		lock_guard<mutex> guard(lock);
+		if (buffer.size() >= LIVE_BUFFER_FRAMES)
+		{
+			buffer.pop_front();
+			frames_dropped++;
+		}
+		buffer.push_back(live_frame);
+	}
+	has_frame.notify_one();
+}
+
+/**
+ *  @desc Closes the lost connection and keeps reopening it, waiting longer after each
+ *  failure, until it opens or stop() is called
+ *
+ *  @returns false if stopped before the camera came back
+ */
+bool LiveSource::reconnect()
+{
+	int wait_ms = LIVE_RECONNECT_MIN_MS;
+	int waited;
+
+	connected = false;
+	capture.release();
+	cout << "Lost the connection to " << mask_credentials(url) << ", reconnecting" << endl;
+
+	while (running)
+	{
+		for (waited = 0; waited < wait_ms && running; waited += 100)
+		{
+			this_thread::sleep_for(chrono::milliseconds(100));
+		}
+		if (!running)
+		{
+			break;
+		}
+		if (capture.open(url))
+		{
+			capture.set(CAP_PROP_BUFFERSIZE, 1);
+			connected = true;
+			reconnects++;
+			cout << "Reconnected to " << mask_credentials(url) << endl;
+			return true;
+		}
+		wait_ms = min(wait_ms * 2, LIVE_RECONNECT_MAX_MS);
+	}
+	return false;
+}
@@ -0,0 +1,94 @@
+#ifndef LIVESOURCE_H
+#define LIVESOURCE_H
+
+#include <iostream>
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include "opencv2/core.hpp"
+#include "opencv2/imgproc.hpp"
+#include "capturesource.h"
+
+using namespace std;
+using namespace cv;
+
+#define LIVE_BUFFER_FRAMES 3			//jitter buffer, the oldest frame is dropped when a new one doesn't fit
+#define LIVE_MAX_LATENCY_MS 250			//frames waiting longer than this are stale and dropped when reading
+#define LIVE_RECONNECT_MIN_MS 500		//first wait before reconnecting, doubled after each failure
+#define LIVE_RECONNECT_MAX_MS 8000		//longest wait between reconnection attempts
+
+/**
+ *  @desc One frame waiting in the jitter buffer
+ */
+struct LiveFrame
+{
+	Mat frame;
+	Mat grey;
+	int64 ticks;		//when the frame arrived
+};
+
+/**
+ *	@file livesource.h
+ *  @desc Reads a live RTSP/HTTP camera on its own thread into a small jitter buffer, so
+ *  the analysis always works on a recent frame instead of a growing backlog. A lost
+ *  connection is reopened with a backoff while read() waits, so the stream carries on
+ *  (and its background models stay warm) once the camera is back.
+ *
+ *  @param CaptureSource capture - the camera connection, only used by the reader thread
+ *  @param deque<LiveFrame> buffer - frames waiting to be read, at most LIVE_BUFFER_FRAMES
+ *  @param Size frame_size - size of the first frame, later frames are resized to it
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class LiveSource
+{
+	private:
+		CaptureSource capture;
+		string url;
+		deque<LiveFrame> buffer;
+		mutex lock;
+		condition_variable has_frame;
+		thread reader;
+		atomic<bool> running;
+		atomic<bool> connected;
+		Size frame_size;
+		int64 start_ticks;
+		int frames_delivered;
+		atomic<int> frames_dropped;
+		atomic<int> reconnects;
+		int last_milliseconds;
+
+		void read_loop();
+		bool reconnect();
+		void push_frame(Mat frame, Mat grey);
+
+		static mutex open_sources_lock;
+		static vector<LiveSource *> open_sources;	//every source with a reader thread, for stop_all()
+
+	public:
+		LiveSource();
+		~LiveSource();
+		static bool is_live_url(const string &path);
+		static string mask_credentials(const string &path);
+		void set_settings(const CaptureSettings &capture_settings);
+		bool open(const string &camera_url);
+		bool read(Mat *frame, Mat *grey);
+		void stop();
+		static void stop_all();
+		void release();
+		int get_frame_number();
+		int get_milliseconds();
+		int get_frames_dropped();
+		int get_reconnects();
+		bool is_connected();
+		string get_backend_name();
+};
+
+#endif
@@ -1,7 +1,14 @@
 #include <iostream>
+#include <stdlib.h>
+#include <ctype.h>
 #include "opencv2/highgui/highgui.hpp"
 #include "bgs.h"
+#include "streammanager.h"
+#include "recordlog.h"
 #include "peoplefinder.h"
+#include "benchmark.h"
+#include "segmentrunner.h"
+#include "parametersweep.h"
 
 using namespace cv;
 using namespace std;
@@ -18,20 +25,569 @@ using namespace std;
  *  The video surveillance trains the PeopleFinder classifier using the images in the training
  *  path directory, and runs the video file to search for pedestrians via BGS.
  *
+ *  The headless video surveillance runs the same analysis without any display windows.
+ *  It can also be started straight from the command line, skipping the menu:
+ *  AutoSurvCV.exe --headless <training path|default> <video path|default> <history> <threshold>
+ *
+ *  Several videos can be analysed at once, sharing one trained classifier:
+ *  AutoSurvCV.exe --streams <training path|default> <history> <threshold> <video path> [<video path> ...]
+ *
+ *  A recorded video can be analysed offline in segments, one per core by default, each
+ *  primed with the frames before it (the history length by default), into one record log:
+ *  AutoSurvCV.exe --offline <training path|default> <video path|default> <history> <threshold> [<segments> [<warm-up frames>]]
+ *
+ *  Every step of the analysis can be timed on a recorded video, saving fps, per step
+ *  latencies, allocations and peak memory as JSON:
+ *  AutoSurvCV.exe --benchmark <training path|default> <video path|default> [<frames> [<output file>]]
+ *
+ *  Settings can be compared on a recorded video in one pass, decoding it once for all of
+ *  them, every combination of the comma separated values is run and its fps, CPU time
+ *  per frame and precision and recall against <video path>.truth are saved as CSV:
+ *  AutoSurvCV.exe --sweep <training path|default> <video path|default> <histories> <thresholds> [<scales> [<cadences> [<frames> [<output file>]]]]
+ *
+ *  The HTML table of an earlier run can be made from its record log, optionally only
+ *  between two video timestamps in seconds:
+ *  AutoSurvCV.exe --report <record log path> [<start seconds> <end seconds>]
+ *
+ *  The training directory can be compiled once into a memory-mapped file of preprocessed
+ *  masks and their skeletons, which training, the demo and the benchmark then read
+ *  instead of decoding every image, add images to leave out the skeletons:
+ *  AutoSurvCV.exe --compile-dataset <training path|default> [images]
+ *
+ *  Any of the video analysis options can be preceded by:
+ *  --schedule <latency|balanced|cpu> to trade how quickly shapes are classified against CPU use,
+ *  --capture <default|ffmpeg|hardware> to choose the decoder, --grey to decode straight to
+ *  greyscale, --skip-frames to drop frames when the analysis falls behind, --scale <1|2|4>
+ *  to run background subtraction on shrunk frames, --accel <cpu|opencl|auto> to run it
+ *  on the OpenCL device, --background <knn|vibe> to choose the background model, --blobs <contours|components>
+ *  to choose how blobs are found in the mask, --log-format <png|jpeg|raw> [<level>] to choose how the
+ *  record log's images are saved, --clips <seconds before> <seconds after> to save a clip
+ *  of the video around every pedestrian and --metrics <port> to serve live figures for Prometheus at
+ *  http://127.0.0.1:<port>/metrics, with --metrics-address <IPv4 address> to serve them on another
+ *  interface (0.0.0.0 for every interface).
+ *
  *	@author Alex O'Donnell
  *	@version 1.00
  */
 
-int main()
+/**
+ *  @desc Console handler for Ctrl+C and Ctrl+Break. The first press asks every stream
+ *  to finish, so the record logs are closed and the reports printed, a second press
+ *  ends the program straight away.
+ *
+ *  @param DWORD event - the console event
+ *
+ *  @returns TRUE if the event was handled
+ */
+static BOOL WINAPI on_console_stop(DWORD event)
+{
+	if ((event != CTRL_C_EVENT && event != CTRL_BREAK_EVENT) || BGS::is_stop_requested())
+	{
+		return FALSE;
+	}
+	cout << "Stopping, press Ctrl+C again to quit straight away" << endl;
+	BGS::request_stop();
+	return TRUE;
+}
+
+/**
+ *  @desc The settings that can come before any of the video analysis options, shared by
+ *  every way of running the analysis.
+ */
+struct AnalysisOptions
+{
+	ScheduleProfile schedule_profile = SCHEDULE_BALANCED;
+	CaptureSettings capture_settings;
+	int bgs_scale = 1;
+	AccelMode accel_mode = ACCEL_CPU;
+	int metrics_port = 0;
+	string metrics_address = METRICS_DEFAULT_ADDRESS;
+	BackgroundEngine background_engine = BACKGROUND_KNN;
+	BlobEngine blob_engine = BLOB_CONTOURS;
+	double clip_before = 0;
+	double clip_after = 0;
+	LogImageFormat log_format = LOG_IMAGE_PNG;
+	int log_level = 1;
+};
+
+/**
+ *  @desc Passes the analysis settings to a StreamManager or SegmentRunner, which take
+ *  the same setters for them
+ *
+ *  @param Runner *runner - the streams or segments to set up
+ *  @param const AnalysisOptions &options - the settings from the command line
+ */
+template<class Runner>
+static void configure_analysis(Runner *runner, const AnalysisOptions &options)
+{
+	runner->set_schedule_profile(options.schedule_profile);
+	runner->set_log_format(options.log_format, options.log_level);
+	runner->set_capture(options.capture_settings);
+	runner->set_bgs_scale(options.bgs_scale);
+	runner->set_accel_mode(options.accel_mode);
+	runner->set_background_engine(options.background_engine);
+	runner->set_blob_engine(options.blob_engine);
+	runner->set_clip_length(options.clip_before, options.clip_after);
+}
+
+/**
+ *  @desc Passes the analysis settings to a StreamManager, including where to serve
+ *  its metrics
+ *
+ *  @param StreamManager *manager - the streams to set up
+ *  @param const AnalysisOptions &options - the settings from the command line
+ */
+static void configure_streams(StreamManager *manager, const AnalysisOptions &options)
+{
+	configure_analysis(manager, options);
+	manager->set_metrics_port(options.metrics_port);
+	manager->set_metrics_address(options.metrics_address);
+}
+
+int main(int argc, char *argv[])
 {	
 	string response;
 	string training_path = "training/PedCut2013/data/completeData/left_groundtruth/*.*";
 	string video_path = "videos/CVLAB/campus4-c1.avi";
 	int bgs_history = 750;
 	double bgs_threshold = 500;
+	bool headless = false;
+	AnalysisOptions options;
+	int skip;
+
+	SetConsoleCtrlHandler(on_console_stop, TRUE);
+
+	while (argc > 1)	//settings that may come before any of the other options
+	{
+		skip = 0;
+		if (argc > 2 && string(argv[1]).compare("--schedule") == 0)
+		{
+			if (string(argv[2]).compare("latency") == 0)
+			{
+				options.schedule_profile = SCHEDULE_LOW_LATENCY;
+			}
+			else if (string(argv[2]).compare("balanced") == 0)
+			{
+				options.schedule_profile = SCHEDULE_BALANCED;
+			}
+			else if (string(argv[2]).compare("cpu") == 0)
+			{
+				options.schedule_profile = SCHEDULE_LOW_CPU;
+			}
+			else
+			{
+				cout << "Usage: --schedule <latency|balanced|cpu>" << endl;
+				return 1;
+			}
+			skip = 2;
+		}
+		else if (argc > 2 && string(argv[1]).compare("--capture") == 0)
+		{
+			if (string(argv[2]).compare("default") == 0)
+			{
+				options.capture_settings.backend = CAPTURE_DEFAULT;
+			}
+			else if (string(argv[2]).compare("ffmpeg") == 0)
+			{
+				options.capture_settings.backend = CAPTURE_FFMPEG;
+			}
+			else if (string(argv[2]).compare("hardware") == 0)
+			{
+				options.capture_settings.backend = CAPTURE_HARDWARE;
+			}
+			else
+			{
+				cout << "Usage: --capture <default|ffmpeg|hardware>" << endl;
+				return 1;
+			}
+			skip = 2;
+		}
+		else if (argc > 2 && string(argv[1]).compare("--accel") == 0)
+		{
+			if (string(argv[2]).compare("cpu") == 0)
+			{
+				options.accel_mode = ACCEL_CPU;
+			}
+			else if (string(argv[2]).compare("opencl") == 0)
+			{
+				options.accel_mode = ACCEL_OPENCL;
+			}
+			else if (string(argv[2]).compare("auto") == 0)
+			{
+				options.accel_mode = ACCEL_AUTO;
+			}
+			else
+			{
+				cout << "Usage: --accel <cpu|opencl|auto>" << endl;
+				return 1;
+			}
+			skip = 2;
+		}
+		else if (argc > 2 && string(argv[1]).compare("--scale") == 0)
+		{
+			if (string(argv[2]).compare("1") == 0 || string(argv[2]).compare("2") == 0 || string(argv[2]).compare("4") == 0)
+			{
+				options.bgs_scale = atoi(argv[2]);
+			}
+			else
+			{
+				cout << "Usage: --scale <1|2|4>" << endl;
+				return 1;
+			}
+			skip = 2;
+		}
+		else if (argc > 2 && string(argv[1]).compare("--background") == 0)
+		{
+			if (string(argv[2]).compare("knn") == 0)
+			{
+				options.background_engine = BACKGROUND_KNN;
+			}
+			else if (string(argv[2]).compare("vibe") == 0)
+			{
+				options.background_engine = BACKGROUND_VIBE;
+			}
+			else
+			{
+				cout << "Usage: --background <knn|vibe>" << endl;
+				return 1;
+			}
+			skip = 2;
+		}
+		else if (argc > 2 && string(argv[1]).compare("--blobs") == 0)
+		{
+			if (string(argv[2]).compare("contours") == 0)
+			{
+				options.blob_engine = BLOB_CONTOURS;
+			}
+			else if (string(argv[2]).compare("components") == 0)
+			{
+				options.blob_engine = BLOB_COMPONENTS;
+			}
+			else
+			{
+				cout << "Usage: --blobs <contours|components>" << endl;
+				return 1;
+			}
+			skip = 2;
+		}
+		else if (argc > 3 && string(argv[1]).compare("--clips") == 0)
+		{
+			options.clip_before = atof(argv[2]);
+			options.clip_after = atof(argv[3]);
+			skip = 3;
+		}
+		else if (argc > 2 && string(argv[1]).compare("--log-format") == 0)
+		{
+			if (string(argv[2]).compare("png") == 0)
+			{
+				options.log_format = LOG_IMAGE_PNG;
+				options.log_level = 1;
+			}
+			else if (string(argv[2]).compare("jpeg") == 0)
+			{
+				options.log_format = LOG_IMAGE_JPEG;
+				options.log_level = 90;
+			}
+			else if (string(argv[2]).compare("raw") == 0)
+			{
+				options.log_format = LOG_IMAGE_RAW;
+				options.log_level = 0;
+			}
+			else
+			{
+				cout << "Usage: --log-format <png|jpeg|raw> [<PNG compression 0-9 or JPEG quality 0-100>]" << endl;
+				return 1;
+			}
+			skip = 2;
+			if (argc > 3 && isdigit((unsigned char)argv[3][0]))	//the level is optional
+			{
+				options.log_level = atoi(argv[3]);
+				skip = 3;
+			}
+		}
+		else if (argc > 2 && string(argv[1]).compare("--metrics") == 0)
+		{
+			options.metrics_port = atoi(argv[2]);
+			skip = 2;
+		}
+		else if (argc > 2 && string(argv[1]).compare("--metrics-address") == 0)
+		{
+			options.metrics_address = argv[2];
+			skip = 2;
+		}
+		else if (string(argv[1]).compare("--grey") == 0)
+		{
+			options.capture_settings.grey_only = true;
+			skip = 1;
+		}
+		else if (string(argv[1]).compare("--skip-frames") == 0)
+		{
+			options.capture_settings.skip_frames = true;
+			skip = 1;
+		}
+
+		if (skip == 0)
+		{
+			break;
+		}
+		argv[skip] = argv[0];
+		argv += skip;
+		argc -= skip;
+	}
+
+	if (argc > 1 && string(argv[1]).compare("--headless") == 0)	//skip the menu, any missing arguments fall back to the defaults
+	{
+		if (argc > 2 && string(argv[2]).compare("default") != 0)
+		{
+			training_path = argv[2];
+		}
+		if (argc > 3 && string(argv[3]).compare("default") != 0)
+		{
+			video_path = argv[3];
+		}
+		if (argc > 4)
+		{
+			bgs_history = atoi(argv[4]);
+		}
+		if (argc > 5)
+		{
+			bgs_threshold = atof(argv[5]);
+		}
+		StreamManager manager(training_path, true);
+		configure_streams(&manager, options);
+		manager.add_stream(video_path, bgs_history, bgs_threshold);
+		manager.run();
+		return 0;
+	}
+
+	if (argc > 1 && string(argv[1]).compare("--offline") == 0)	//split an archived video into segments analysed in parallel
+	{
+		if (argc < 6)
+		{
+			cout << "Usage: AutoSurvCV.exe --offline <training path|default> <video path|default> <history> <threshold> [<segments> [<warm-up frames>]]" << endl;
+			return 1;
+		}
+		if (string(argv[2]).compare("default") != 0)
+		{
+			training_path = argv[2];
+		}
+		if (string(argv[3]).compare("default") != 0)
+		{
+			video_path = argv[3];
+		}
+		bgs_history = atoi(argv[4]);
+		bgs_threshold = atof(argv[5]);
+
+		SegmentRunner runner(training_path, video_path, bgs_history, bgs_threshold);
+		if (argc > 6)
+		{
+			runner.set_segment_count(atoi(argv[6]));
+		}
+		if (argc > 7)
+		{
+			runner.set_warmup_frames(atoi(argv[7]));
+		}
+		configure_analysis(&runner, options);
+		runner.run();
+		return runner.get_merged_log().empty() ? 1 : 0;
+	}
+
+	if (argc > 1 && string(argv[1]).compare("--benchmark") == 0)	//time every step of the analysis and save the results as JSON
+	{
+		string output_path = "benchmark.json";
+		int frames = 0;
+
+		if (argc > 2 && string(argv[2]).compare("default") != 0)
+		{
+			training_path = argv[2];
+		}
+		if (argc > 3 && string(argv[3]).compare("default") != 0)
+		{
+			video_path = argv[3];
+		}
+		if (argc > 4)
+		{
+			frames = atoi(argv[4]);
+		}
+		if (argc > 5)
+		{
+			output_path = argv[5];
+		}
+
+		Benchmark benchmark(training_path, video_path, frames);
+		benchmark.set_background_engine(options.background_engine);
+		benchmark.set_blob_engine(options.blob_engine);
+		if (!benchmark.run())
+		{
+			return 1;
+		}
+		benchmark.write_json(cout);
+		if (!benchmark.save_json(output_path))
+		{
+			cout << "Couldn't write " << output_path << endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	if (argc > 1 && string(argv[1]).compare("--sweep") == 0)	//compare settings on one video, decoded once for all of them
+	{
+		string output_path = "sweep.csv";
+		string item;
+		vector<int> histories, scales;
+		vector<double> thresholds;
+		vector<ScheduleProfile> profiles;
+		int frames = 0;
+
+		if (argc < 6)
+		{
+			cout << "Usage: AutoSurvCV.exe --sweep <training path|default> <video path|default> <histories> <thresholds> [<scales> [<cadences> [<frames> [<output file>]]]]" << endl;
+			cout << "e.g. --sweep default default 250,500,750 200,500 1,2,4 latency,balanced,cpu" << endl;
+			return 1;
+		}
+		if (string(argv[2]).compare("default") != 0)
+		{
+			training_path = argv[2];
+		}
+		if (string(argv[3]).compare("default") != 0)
+		{
+			video_path = argv[3];
+		}
+		stringstream history_list(argv[4]);
+		while (getline(history_list, item, ','))
+		{
+			histories.push_back(atoi(item.c_str()));
+		}
+		stringstream threshold_list(argv[5]);
+		while (getline(threshold_list, item, ','))
+		{
+			thresholds.push_back(atof(item.c_str()));
+		}
+		stringstream scale_list(argc > 6 ? argv[6] : "");
+		while (getline(scale_list, item, ','))
+		{
+			scales.push_back(max(atoi(item.c_str()), 1));
+		}
+		if (scales.empty())
+		{
+			scales.push_back(options.bgs_scale);
+		}
+		stringstream profile_list(argc > 7 ? argv[7] : "");
+		while (getline(profile_list, item, ','))
+		{
+			if (item.compare("latency") == 0)
+			{
+				profiles.push_back(SCHEDULE_LOW_LATENCY);
+			}
+			else if (item.compare("balanced") == 0)
+			{
+				profiles.push_back(SCHEDULE_BALANCED);
+			}
+			else if (item.compare("cpu") == 0)
+			{
+				profiles.push_back(SCHEDULE_LOW_CPU);
+			}
+			else
+			{
+				cout << "Unknown cadence \"" << item << "\", the cadences are latency, balanced and cpu" << endl;
+				return 1;
+			}
+		}
+		if (profiles.empty())
+		{
+			profiles.push_back(options.schedule_profile);
+		}
+		if (argc > 8)
+		{
+			frames = atoi(argv[8]);
+		}
+		if (argc > 9)
+		{
+			output_path = argv[9];
+		}
+
+		ParameterSweep sweep(training_path, video_path, frames);
+		sweep.add_grid(histories, thresholds, scales, profiles);
+		sweep.set_capture(options.capture_settings);
+		sweep.set_background_engine(options.background_engine);
+		sweep.set_blob_engine(options.blob_engine);
+		if (!sweep.run())
+		{
+			return 1;
+		}
+		sweep.write_table(cout);
+		if (!sweep.save_table(output_path))
+		{
+			cout << "Couldn't write " << output_path << endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	if (argc > 2 && string(argv[1]).compare("--report") == 0)	//write the HTML table for a stored run
+	{
+		RecordLog rlog;
+		int start_ms = 0, end_ms = INT_MAX;
+
+		if (argc > 4)
+		{
+			start_ms = (int)(atof(argv[3]) * 1000);
+			end_ms = (int)(atof(argv[4]) * 1000);
+		}
+		if (!rlog.write_html_view(argv[2], start_ms, end_ms))
+		{
+			cout << "Couldn't read the record log " << argv[2] << endl;
+			return 1;
+		}
+		cout << "Wrote " << argv[2] << ".html" << endl;
+		return 0;
+	}
+
+	if (argc > 1 && string(argv[1]).compare("--compile-dataset") == 0)	//decode the training images once for every later run
+	{
+		ThreadPool pool(0);
+
+		if (argc > 2 && string(argv[2]).compare("default") != 0)
+		{
+			training_path = argv[2];
+		}
+		PeopleFinder pf = PeopleFinder(vector<Point>(11), vector<Point>(11), training_path);
+		if (!pf.compile_dataset(&pool, !(argc > 3 && string(argv[3]).compare("images") == 0)))
+		{
+			cout << "Couldn't write the compiled dataset" << endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	if (argc > 1 && string(argv[1]).compare("--streams") == 0)	//one stream per video path, always headless
+	{
+		if (argc < 6)
+		{
+			cout << "Usage: AutoSurvCV.exe --streams <training path|default> <history> <threshold> <video path> [<video path> ...]" << endl;
+			return 1;
+		}
+		if (string(argv[2]).compare("default") != 0)
+		{
+			training_path = argv[2];
+		}
+		bgs_history = atoi(argv[3]);
+		bgs_threshold = atof(argv[4]);
+
+		StreamManager manager(training_path, true);
+		configure_streams(&manager, options);
+		for (int i = 5; i < argc; i++)
+		{
+			manager.add_stream(argv[i], bgs_history, bgs_threshold);
+		}
+		manager.run();
+		return 0;
+	}
+
 	cout << "---Welcome to AutoSurvCV. Please type an option from the menu---" << endl;
 	cout << "1. Training Demo" << endl;
 	cout << "2. Run Video Surveillance" << endl;
+	cout << "3. Run Video Surveillance (Headless)" << endl;
 	cout << "Q. Quit" << endl;
 
 	while (true)
@@ -46,13 +602,14 @@ int main()
 			{
 				training_path = response;
 			}
-			PeopleFinder pf = PeopleFinder(vector<Point>(11), vector<Point>(11), training_path, false);
+			PeopleFinder pf = PeopleFinder(vector<Point>(11), vector<Point>(11), training_path);
 			pf.demo();
 			break;
 		}
 
-		if (response.compare("2") == 0)
+		if (response.compare("2") == 0 || response.compare("3") == 0)
 		{
+			headless = (response.compare("3") == 0);
 			cout << "Enter the path of the training directory you wish to use." << endl;
 			cout << "Input 'default' to use the default training directory: " << training_path << endl;
 			cin >> response;
@@ -84,8 +641,10 @@ int main()
 				cout << "Please enter a number" << endl;
 				break;
 			}
-			BGS bgs = BGS(training_path, video_path, bgs_history, bgs_threshold);
-			bgs.run();
+			StreamManager manager(training_path, headless);
+			configure_streams(&manager, options);
+			manager.add_stream(video_path, bgs_history, bgs_threshold);
+			manager.run();
 			break;
 		}
 		if (response.compare("Q") == 0 || response.compare("q") == 0)
@@ -0,0 +1,261 @@
+#include "metricsserver.h"
+#include <winsock2.h>	//kept out of the header, it must be included before windows.h
+#include <ws2tcpip.h>
+
+#pragma comment(lib, "Ws2_32.lib")
+
+/**
+ *	@file metricsserver.cpp
+ *  @desc Serves the live stream figures for Prometheus to scrape. The figures aren't
+ *  protected, so the listening socket is bound to the loopback interface unless another
+ *  address is asked for; closing it from stop() wakes the blocked accept() so the
+ *  server thread can finish.
+ *
+ *  Every family is written once with its HELP and TYPE lines, followed by a line per
+ *  stream, as the text format expects.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+MetricsServer::MetricsServer()
+	: listen_socket(INVALID_SOCKET), running(false), port(0), bind_address(METRICS_DEFAULT_ADDRESS)
+{}
+
+MetricsServer::~MetricsServer()
+{
+	stop();
+}
+
+/**
+ *  @desc Opens the port and starts answering scrapes on a new thread
+ *
+ *  @param int listen_port - TCP port to listen on
+ *  @param string listen_address - IPv4 address of the interface to listen on, 0.0.0.0 for every interface
+ *
+ *  @returns false if Winsock couldn't start, the address isn't valid or the port couldn't be opened
+ */
+bool MetricsServer::start(int listen_port, string listen_address)
+{
+	WSADATA wsa_data;
+	sockaddr_in address;
+	SOCKET sock;
+	BOOL reuse = TRUE;
+
+	if (running)
+	{
+		return true;
+	}
+	if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0)
+	{
+		cout << "Metrics: couldn't start Winsock" << endl;
+		return false;
+	}
+
+	sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (sock == INVALID_SOCKET)
+	{
+		cout << "Metrics: couldn't create a socket" << endl;
+		WSACleanup();
+		return false;
+	}
+	setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse, sizeof(reuse));
+
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons((u_short)listen_port);
+	if (inet_pton(AF_INET, listen_address.c_str(), &address.sin_addr) != 1)
+	{
+		cout << "Metrics: " << listen_address << " isn't an IPv4 address" << endl;
+		closesocket(sock);
+		WSACleanup();
+		return false;
+	}
+	if (::bind(sock, (sockaddr *)&address, sizeof(address)) == SOCKET_ERROR || listen(sock, SOMAXCONN) == SOCKET_ERROR)
+	{
+		cout << "Metrics: couldn't listen on " << listen_address << ":" << listen_port << endl;
+		closesocket(sock);
+		WSACleanup();
+		return false;
+	}
+
+	listen_socket = (uintptr_t)sock;
+	port = listen_port;
+	bind_address = listen_address;
+	running = true;
+	listener = thread(&MetricsServer::serve, this);
+	cout << "Metrics: serving http://" << (bind_address.compare("0.0.0.0") == 0 ? "<host>" : bind_address) << ":" << port << "/metrics" << endl;
+	return true;
+}
+
+/**
+ *  @desc Closes the port and waits for the server thread to finish
+ */
+void MetricsServer::stop()
+{
+	if (!running)
+	{
+		return;
+	}
+	running = false;
+	closesocket((SOCKET)listen_socket);
+	listener.join();
+	listen_socket = INVALID_SOCKET;
+	WSACleanup();
+}
+
+bool MetricsServer::is_running()
+{
+	return running;
+}
+
+int MetricsServer::get_port()
+{
+	return port;
+}
+
+string MetricsServer::get_address()
+{
+	return bind_address;
+}
+
+/**
+ *  @desc Adds a stream to the figures served, the stream must outlive its registration
+ *
+ *  @param StreamMetrics *metrics - the stream's figures
+ */
+void MetricsServer::add_stream(StreamMetrics *metrics)
+{
+	lock_guard<mutex> guard(lock);
+	streams.push_back(metrics);
+}
+
+/**
+ *  @desc Stops serving a stream's figures, call before the stream is deleted
+ *
+ *  @param StreamMetrics *metrics - the stream's figures
+ */
+void MetricsServer::remove_stream(StreamMetrics *metrics)
+{
+	lock_guard<mutex> guard(lock);
+	streams.erase(remove(streams.begin(), streams.end(), metrics), streams.end());
+}
+
+/**
+ *  @desc Writes the figures of every registered stream in the Prometheus text format
+ *
+ *  @returns string - the body of a /metrics response
+ */
+string MetricsServer::render()
+{
+	lock_guard<mutex> guard(lock);
+	stringstream out;
+	int c, g, i;
+
+	for (c = 0; c < STREAM_COUNTERS; c++)
+	{
+		out << "# HELP " << StreamMetrics::get_counter_name((StreamCounter)c) << " " << StreamMetrics::get_counter_help((StreamCounter)c) << "\n";
+		out << "# TYPE " << StreamMetrics::get_counter_name((StreamCounter)c) << " counter\n";
+		for (i = 0; i < streams.size(); i++)
+		{
+			streams[i]->write_counter(out, (StreamCounter)c);
+		}
+	}
+
+	for (g = 0; g < STREAM_GAUGES; g++)
+	{
+		out << "# HELP " << StreamMetrics::get_gauge_name((StreamGauge)g) << " " << StreamMetrics::get_gauge_help((StreamGauge)g) << "\n";
+		out << "# TYPE " << StreamMetrics::get_gauge_name((StreamGauge)g) << " gauge\n";
+		for (i = 0; i < streams.size(); i++)
+		{
+			streams[i]->write_gauge(out, (StreamGauge)g);
+		}
+	}
+
+	out << "# HELP autosurv_fps Average frames per second since the stream started.\n";
+	out << "# TYPE autosurv_fps gauge\n";
+	for (i = 0; i < streams.size(); i++)
+	{
+		streams[i]->write_fps(out);
+	}
+
+	out << "# HELP autosurv_stage_seconds Time taken by each stage of the pipeline.\n";
+	out << "# TYPE autosurv_stage_seconds histogram\n";
+	for (i = 0; i < streams.size(); i++)
+	{
+		streams[i]->write_stage_histograms(out);
+	}
+
+	return out.str();
+}
+
+/**
+ *  @desc Server thread, answers connections until stop() closes the socket
+ */
+void MetricsServer::serve()
+{
+	SOCKET client;
+
+	while (running)
+	{
+		client = accept((SOCKET)listen_socket, NULL, NULL);
+		if (client == INVALID_SOCKET)
+		{
+			continue;	//stop() closed the socket, or the client gave up
+		}
+		answer((uintptr_t)client);
+		closesocket(client);
+	}
+}
+
+/**
+ *  @desc Reads one request and answers it, /metrics and / get the figures and
+ *  anything else gets a 404
+ *
+ *  @param uintptr_t client - the connected SOCKET
+ */
+void MetricsServer::answer(uintptr_t client)
+{
+	char request[METRICS_REQUEST_SIZE];
+	string request_line, body, status, text;
+	stringstream response;
+	DWORD timeout = 2000;
+	int received, sent, total = 0;
+
+	setsockopt((SOCKET)client, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));	//don't let a silent client hold up the next scrape
+	received = recv((SOCKET)client, request, sizeof(request) - 1, 0);
+	if (received <= 0)
+	{
+		return;
+	}
+	request[received] = '\0';
+	request_line = string(request).substr(0, string(request).find("\r\n"));
+
+	if (request_line.compare(0, 13, "GET /metrics ") == 0 || request_line.compare(0, 6, "GET / ") == 0)
+	{
+		status = "200 OK";
+		body = render();
+	}
+	else
+	{
+		status = "404 Not Found";
+		body = "Metrics are served at /metrics\n";
+	}
+
+	response << "HTTP/1.1 " << status << "\r\n"
+		<< "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+		<< "Content-Length: " << body.size() << "\r\n"
+		<< "Connection: close\r\n\r\n"
+		<< body;
+
+	text = response.str();
+	while (total < (int)text.size())
+	{
+		sent = send((SOCKET)client, text.c_str() + total, (int)text.size() - total, 0);
+		if (sent == SOCKET_ERROR)
+		{
+			return;
+		}
+		total += sent;
+	}
+}
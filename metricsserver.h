@@ -0,0 +1,60 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include "streammetrics.h"
+
+using namespace std;
+
+#define METRICS_REQUEST_SIZE 1024	//bytes of a request read, enough for the request line
+#define METRICS_DEFAULT_ADDRESS "127.0.0.1"	//only this machine can scrape unless another address is chosen
+
+/**
+ *	@file metricsserver.h
+ *  @desc A minimal HTTP server that answers GET /metrics with the figures of every
+ *  registered stream in the Prometheus text format. It runs on its own thread and
+ *  serves one connection at a time, scrapes only read the streams' atomics so they
+ *  never hold up the pipelines.
+ *
+ *  @param vector<StreamMetrics *> streams - the streams being reported, not owned
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class MetricsServer
+{
+	private:
+		mutex lock;
+		vector<StreamMetrics *> streams;
+		uintptr_t listen_socket;	//a SOCKET, kept as its underlying type so winsock2.h stays out of this header
+		thread listener;
+		atomic<bool> running;
+		int port;
+		string bind_address;
+
+		void serve();
+		void answer(uintptr_t client);
+
+	public:
+		MetricsServer();
+		~MetricsServer();
+		bool start(int listen_port, string listen_address);
+		void stop();
+		bool is_running();
+		int get_port();
+		string get_address();
+		void add_stream(StreamMetrics *metrics);
+		void remove_stream(StreamMetrics *metrics);
+		string render();
+};
+
+#endif
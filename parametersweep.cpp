@@ -0,0 +1,310 @@
+#include <windows.h>
+#include "parametersweep.h"
+
+/**
+ *	@file parametersweep.cpp
+ *  @desc Every lane is given no share of the pool, so its background model and its
+ *  PeopleFinder both run on the thread analysing the lane's frame. The thread's user and
+ *  kernel time across BGS::analyse_frame() is then the lane's CPU time, which leaves
+ *  out the time the thread was waiting or preempted. Windows counts it in scheduler
+ *  ticks, so it is only accurate summed over many frames. The lanes' fps are what one
+ *  core would manage with that setting, while the pool keeps every core busy with a
+ *  lane each. The lanes don't write record logs, their pedestrians are taken from the
+ *  tracker's verdicts once each frame is analysed.
+ *
+ *  A labelled pedestrian counts as found on a frame if a hull whose track is judged a
+ *  pedestrian overlaps it, so a pedestrian followed from an earlier detection still
+ *  counts on the frames after. Frames that weren't labelled are analysed but not scored.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+/**
+ *  @desc CPU time the calling thread has used so far
+ *
+ *  @returns double - user and kernel time in milliseconds
+ */
+static double thread_cpu_ms()
+{
+	FILETIME created, exited, kernel, user;
+
+	if (!GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user))
+	{
+		return 0;
+	}
+	return ((((unsigned long long)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime)
+		+ (((unsigned long long)user.dwHighDateTime << 32) | user.dwLowDateTime)) / 10000.0;	//100 ns units
+}
+
+ParameterSweep::ParameterSweep(string t_path, string v_path, int frames_to_run)
+	: training_path(t_path), video_path(v_path), max_frames(frames_to_run), background_engine(BACKGROUND_KNN), blob_engine(BLOB_CONTOURS),
+	labelled_frames(0), wall_ms(0)
+{}
+
+void ParameterSweep::add_config(const SweepConfig &config)
+{
+	configs.push_back(config);
+}
+
+/**
+ *  @desc Adds a setting for every combination of the values given
+ *
+ *  @param const vector<int> &histories - BGS history lengths
+ *  @param const vector<double> &thresholds - BGS thresholds
+ *  @param const vector<int> &scales - downscale factors, 1 for full resolution
+ *  @param const vector<ScheduleProfile> &profiles - detection cadences
+ */
+void ParameterSweep::add_grid(const vector<int> &histories, const vector<double> &thresholds, const vector<int> &scales, const vector<ScheduleProfile> &profiles)
+{
+	SweepConfig config;
+	int h, t, s, p;
+
+	for (h = 0; h < histories.size(); h++)
+	{
+		for (t = 0; t < thresholds.size(); t++)
+		{
+			for (s = 0; s < scales.size(); s++)
+			{
+				for (p = 0; p < profiles.size(); p++)
+				{
+					config.bgs_history = histories[h];
+					config.bgs_threshold = thresholds[t];
+					config.bgs_scale = scales[s];
+					config.schedule_profile = profiles[p];
+					add_config(config);
+				}
+			}
+		}
+	}
+}
+
+int ParameterSweep::get_config_count()
+{
+	return (int)configs.size();
+}
+
+void ParameterSweep::set_capture(const CaptureSettings &settings)
+{
+	capture_settings = settings;
+}
+
+/**
+ *  @desc Chooses the background model of every lane, call before run()
+ *
+ *  @param BackgroundEngine engine - KNN or ViBe
+ */
+void ParameterSweep::set_background_engine(BackgroundEngine engine)
+{
+	background_engine = engine;
+}
+
+/**
+ *  @desc Chooses how every lane finds the blobs, call before run()
+ *
+ *  @param BlobEngine engine - contours and hulls, or connected components
+ */
+void ParameterSweep::set_blob_engine(BlobEngine engine)
+{
+	blob_engine = engine;
+}
+
+/**
+ *  @desc Trains or loads the PeopleFinder, then decodes the video once, analysing every
+ *  frame with each setting in parallel and scoring the labelled frames
+ *
+ *  @returns false if there was nothing to sweep or the video couldn't be opened
+ */
+bool ParameterSweep::run()
+{
+	ThreadPool pool(0);
+	PeopleFinder pf(vector<Point>(11), vector<Point>(11), training_path);
+	GroundTruth truth;
+	CaptureSource capture;
+	vector<BGS *> lanes;
+	vector<vector<Rect>> pedestrians;
+	stringstream ss;
+	Mat frame, grey;
+	int frames = 0, frame_number, milliseconds;
+	int64 start_ticks;
+	int i;
+
+	BGS::clear_stop_request();
+	results.clear();
+	if (configs.empty())
+	{
+		cout << "No settings to sweep" << endl;
+		return false;
+	}
+
+	pf.train_or_load(&pool);
+	if (truth.load(video_path + ".truth"))
+	{
+		printf("Scoring against %d labelled frames\n", truth.get_labelled_frames());
+	}
+	else
+	{
+		cout << "No ground truth in " << video_path << ".truth, only the speed is measured" << endl;
+	}
+	labelled_frames = truth.get_labelled_frames();
+
+	capture.set_settings(capture_settings);
+	if (!capture.open(video_path) || !capture.read(&frame, &grey))
+	{
+		cout << "Couldn't open the video " << video_path << endl;
+		return false;
+	}
+
+	results.resize(configs.size());
+	pedestrians.resize(configs.size());
+	for (i = 0; i < configs.size(); i++)
+	{
+		ss.str("");
+		ss << "_sweep" << i + 1;
+		lanes.push_back(new BGS(ss.str(), video_path, configs[i].bgs_history, configs[i].bgs_threshold, true, &pf, &pool));
+		lanes[i]->set_pool_share(0);	//the lanes are the parallelism, each runs on one thread
+		lanes[i]->set_log_records(false);
+		lanes[i]->set_schedule_profile(configs[i].schedule_profile);
+		lanes[i]->set_bgs_scale(configs[i].bgs_scale);
+		lanes[i]->set_background_engine(background_engine);
+		lanes[i]->set_blob_engine(blob_engine);
+		lanes[i]->prepare(frame);
+
+		results[i].config = configs[i];
+		results[i].frames = 0;
+		results[i].cpu_ms = 0;
+		results[i].true_positives = 0;
+		results[i].false_positives = 0;
+		results[i].false_negatives = 0;
+	}
+	printf("Sweeping %d settings over %s\n", (int)lanes.size(), video_path.c_str());
+
+	start_ticks = getTickCount();
+	do
+	{
+		frame_number = (int)capture.get(CV_CAP_PROP_POS_FRAMES);
+		milliseconds = (int)capture.get(CV_CAP_PROP_POS_MSEC);
+
+		pool.parallel_for((int)lanes.size(), [&](int lane)
+		{
+			FrameJob job;
+			double lane_cpu_ms = thread_cpu_ms();
+
+			job.frame = frame;	//shared, the lanes only read it
+			job.grey = grey;
+			job.frame_number = frame_number;
+			job.milliseconds = milliseconds;
+			lanes[lane]->analyse_frame(&job);
+			results[lane].cpu_ms += thread_cpu_ms() - lane_cpu_ms;
+			results[lane].frames++;
+
+			if (truth.is_labelled(frame_number))
+			{
+				lanes[lane]->get_pedestrian_boxes(job, &pedestrians[lane]);
+				truth.match(frame_number, pedestrians[lane], &results[lane].true_positives, &results[lane].false_positives, &results[lane].false_negatives);
+			}
+		});
+		frames++;
+	} while ((max_frames <= 0 || frames < max_frames) && !BGS::is_stop_requested() && capture.read(&frame, &grey));
+	wall_ms = (getTickCount() - start_ticks) * 1000.0 / getTickFrequency();
+	capture.release();
+
+	for (i = 0; i < lanes.size(); i++)
+	{
+		score(&results[i]);
+		delete lanes[i];
+	}
+	printf("Analysed %d frames with %d settings in %.1f s (%.1f frames per second over every setting)\n", frames, (int)lanes.size(), wall_ms / 1000.0,
+		wall_ms > 0 ? frames * lanes.size() * 1000.0 / wall_ms : 0.0);
+	return true;
+}
+
+/**
+ *  @desc Works out a lane's precision, recall, fps and time per frame from its counts
+ *
+ *  @param SweepResult *result - a lane with its frames, CPU time and matches counted
+ */
+void ParameterSweep::score(SweepResult *result)
+{
+	int detections = result->true_positives + result->false_positives;
+	int labelled = result->true_positives + result->false_negatives;
+
+	result->precision = detections > 0 ? (double)result->true_positives / detections : -1;
+	result->recall = labelled > 0 ? (double)result->true_positives / labelled : -1;
+	result->ms_per_frame = result->frames > 0 ? result->cpu_ms / result->frames : 0;
+	result->fps = result->cpu_ms > 0 ? result->frames * 1000.0 / result->cpu_ms : 0;
+}
+
+const vector<SweepResult>& ParameterSweep::get_results()
+{
+	return results;
+}
+
+/**
+ *  @desc Writes the results of the last run as CSV, a row per setting in the order
+ *  they were added. Precision and recall are "n/a" when there was nothing to score.
+ *
+ *  @param ostream &out - where to write
+ */
+void ParameterSweep::write_table(ostream &out)
+{
+	int i;
+
+	out << fixed << setprecision(3);
+	out << "history,threshold,scale,cadence,frames,fps,cpu_ms_per_frame,true_positives,false_positives,false_negatives,precision,recall\n";
+	for (i = 0; i < results.size(); i++)
+	{
+		out << results[i].config.bgs_history << "," << results[i].config.bgs_threshold << "," << results[i].config.bgs_scale << ","
+			<< profile_name(results[i].config.schedule_profile) << "," << results[i].frames << "," << results[i].fps << "," << results[i].ms_per_frame << ","
+			<< results[i].true_positives << "," << results[i].false_positives << "," << results[i].false_negatives << ",";
+		if (results[i].precision < 0)
+		{
+			out << "n/a,";
+		}
+		else
+		{
+			out << results[i].precision << ",";
+		}
+		if (results[i].recall < 0)
+		{
+			out << "n/a\n";
+		}
+		else
+		{
+			out << results[i].recall << "\n";
+		}
+	}
+}
+
+/**
+ *  @desc Writes the results of the last run to a CSV file
+ *
+ *  @returns false if the file couldn't be written
+ */
+bool ParameterSweep::save_table(string path)
+{
+	ofstream file(path);
+
+	if (!file.is_open())
+	{
+		return false;
+	}
+	write_table(file);
+	return file.good();
+}
+
+/**
+ *  @returns string - the name the profile is given on the command line
+ */
+string ParameterSweep::profile_name(ScheduleProfile profile)
+{
+	if (profile == SCHEDULE_LOW_LATENCY)
+	{
+		return "latency";
+	}
+	if (profile == SCHEDULE_LOW_CPU)
+	{
+		return "cpu";
+	}
+	return "balanced";
+}
@@ -0,0 +1,98 @@
+#ifndef PARAMETERSWEEP_H
+#define PARAMETERSWEEP_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <stdio.h>
+#include "bgs.h"
+#include "peoplefinder.h"
+#include "threadpool.h"
+#include "capturesource.h"
+#include "framejob.h"
+#include "groundtruth.h"
+
+using namespace std;
+using namespace cv;
+
+/**
+ *  @desc The settings of one lane of a sweep
+ */
+struct SweepConfig
+{
+	int bgs_history;
+	double bgs_threshold;
+	int bgs_scale;						//factor the frames are shrunk by for background subtraction
+	ScheduleProfile schedule_profile;	//how often uncertain tracks are classified again
+};
+
+/**
+ *  @desc What one lane of a sweep cost and how well it found the labelled pedestrians
+ */
+struct SweepResult
+{
+	SweepConfig config;
+	int frames;
+	double cpu_ms;				//user and kernel time of the threads that analysed the lane's frames
+	int true_positives;
+	int false_positives;
+	int false_negatives;
+	double precision;			//-1 when there was no detection on a labelled frame
+	double recall;				//-1 when there was no labelled pedestrian
+	double fps;					//frames a core would analyse per second at this setting
+	double ms_per_frame;
+};
+
+/**
+ *	@file parametersweep.h
+ *  @desc Runs a recorded video through many settings of the analysis at once. Each
+ *  frame is decoded once and handed to one BGS per setting, so the sweep pays for
+ *  decoding once rather than once per setting, and the BGSs analyse the frame in
+ *  parallel on the thread pool. Each setting's CPU time, fps and precision and recall
+ *  against the video's GroundTruth are written as a table, to pick the cheapest
+ *  setting that finds enough of the pedestrians.
+ *
+ *  @param string training_path - training images for the PeopleFinder
+ *  @param string video_path - the recorded video, its labels are read from <video path>.truth
+ *  @param int max_frames - frames to analyse, 0 for the whole video
+ *  @param vector<SweepConfig> configs - the settings to compare
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class ParameterSweep
+{
+	private:
+		string training_path;
+		string video_path;
+		int max_frames;
+		vector<SweepConfig> configs;
+		vector<SweepResult> results;
+		CaptureSettings capture_settings;
+		BackgroundEngine background_engine;
+		BlobEngine blob_engine;
+		int labelled_frames;
+		double wall_ms;
+
+	public:
+		ParameterSweep(string t_path, string v_path, int frames_to_run);
+		void add_config(const SweepConfig &config);
+		void add_grid(const vector<int> &histories, const vector<double> &thresholds, const vector<int> &scales, const vector<ScheduleProfile> &profiles);
+		int get_config_count();
+		void set_capture(const CaptureSettings &settings);
+		void set_background_engine(BackgroundEngine engine);
+		void set_blob_engine(BlobEngine engine);
+		bool run();
+		const vector<SweepResult>& get_results();
+		void write_table(ostream &out);
+		bool save_table(string path);
+
+		static void score(SweepResult *result);
+		static string profile_name(ScheduleProfile profile);
+};
+
+#endif
@@ -7,31 +7,31 @@
  *  This gives it a range of values for each feature, the PeopleFinder uses the feature ranges
  *  to judge how well the features derived from the video shapes are placed.
  *	
- *  @param vector<Point> min_range - minimum x/y positions of each feature from training
- *  @param vector<Point> max_range - maximum x/y positions of each feature from training
+ *  @param FeatureModel model - minimum and maximum x/y positions of each feature from training
  *  @param string training_path - path of the training image directory 
- *  @param bool bad_skel_flag - boolean flag that is raised if it fails to build a skeleton
+ *
+ *  The classifier holds no per-shape state, each call to create_skeleton() reports a
+ *  failed skeleton through its own flag so that shapes can be classified in parallel.
  *
  *	@author Alex O'Donnell
  *	@version 1.2
  */
 
-PeopleFinder::PeopleFinder(vector<Point> min, vector<Point> max, string path, bool bad)
-	: min_range(min), max_range(max), training_path(path), bad_skel_flag(bad)
-{}
+PeopleFinder::PeopleFinder(vector<Point> min, vector<Point> max, string path)
+	: training_path(path)
+{
+	for (int i = 0; i < FEATURE_NODES; i++)
+	{
+		model.set_range(i, min[i], max[i]);
+	}
+}
 
 /**
  *  @desc initialises the range values
  */
 void PeopleFinder::init()
 {
-	int i;
-
-	for (i = 0; i < 11; i++)
-	{
-		min_range[i] = Point(1000, 1000);
-		max_range[i] = Point(0, 0);
-	}
+	model.reset();
 }
 
 /**
@@ -40,219 +40,665 @@ void PeopleFinder::init()
  *  shape. Attempts to create a feature skeleton within each image, which is used to 
  *  compare the minimum and maximum boundaries of where the classifier will look for
  *  features during testing.
+ *
+ *  Images are streamed, each worker loads and skeletonises one file at a time and keeps
+ *  its own ranges, so only one image per worker is ever held in memory. The ranges of
+ *  the workers are merged once every file has been seen.
+ *
+ *  When the directory has been compiled with compile_dataset() the images come from the
+ *  mapped .dataset file instead, with nothing to decode, and if it holds skeletons of
+ *  this version they are used as they are.
+ *
+ *  @param ThreadPool *pool - workers to train on, NULL trains on the calling thread
  */
-void PeopleFinder::train()
+void PeopleFinder::train(ThreadPool *pool)
 {
-	vector<string> filenames(2000);
-	vector<Mat> images(2000);
-	vector<Point> feature_nodes(11);
-	Mat tempimg, contourimg, contoursonly, distimg;
-	int i = 0;
+	vector<string> filenames;
 	const string directory = training_path;
-	BlobDetector bd = BlobDetector(vector<Mat>(20));
+	DatasetCache cache;
+	unsigned long long dataset_hash;
+	bool cached;
+	int num_parts = 1;
+	int file_count, i;
+	atomic<int> next_file(0);
 
 	init();
 
-	filenames = search_dataset_files(directory); //FORMAT: place folder in AutoSurvCV, forward slashes and end in "*.*"
-	images = load_dataset_files(filenames, directory);
-	cout << "Training the PeopleFinder classifier... Please Wait..." << endl;
-	while (!images[i].rows == 0)
+	dataset_hash = hash_dataset_files(directory);
+	cached = cache.open(cache_file_path(dataset_hash, ".dataset"), dataset_hash, MODEL_FILE_VERSION);
+	if (cached)
 	{
-		contourimg = bd.highlight_contours(&images[i], &images[i], &contoursonly);
-		feature_nodes = create_skeleton(&contoursonly);
-		i++;
+		file_count = (int)cache.get_count();
+		cout << "Training from the compiled dataset" << (cache.has_skeletons() ? " and its skeletons" : "") << endl;
+	}
+	else
+	{
+		filenames = search_dataset_files(directory); //FORMAT: place folder in AutoSurvCV, forward slashes and end in "*.*"
+		file_count = (int)filenames.size();
+	}
+	if (pool != NULL)
+	{
+		num_parts = pool->get_size() + 1;
+	}
+
+	vector<FeatureModel> part_models(num_parts);
+	vector<int> part_count(num_parts, 0);
+
+	auto train_part = [this, &filenames, &directory, &cache, cached, file_count, &next_file, &part_models, &part_count](int part)
+	{
+		BlobDetector bd;
+		SkeletonWorkspace *workspace = get_thread_workspace();
+		Mat image, contourimg, contoursonly;
+		vector<Point> stored_nodes;
+		bool bad_skel_flag;
+		int file;
+
+		while ((file = next_file++) < file_count)
+		{
+			if (cached && cache.has_skeletons())
+			{
+				if (cache.get_skeleton(file, &stored_nodes))	//images whose skeleton was bad are skipped, as they would be here
+				{
+					part_models[part].widen(stored_nodes);
+					part_count[part]++;
+				}
+			}
+			else
+			{
+				if (cached)
+				{
+					image = cache.get_image(file);
+				}
+				else if (!load_dataset_file(filenames[file], directory, &image))
+				{
+					continue;
+				}
+
+				bad_skel_flag = false;
+				contourimg = bd.highlight_contours(&image, &image, &contoursonly);
+				const vector<Point>& feature_nodes = create_skeleton(&contoursonly, workspace, &bad_skel_flag);
+
+				if (!bad_skel_flag)
+				{
+					part_models[part].widen(feature_nodes);
+					part_count[part]++;
+				}
+			}
+		}
+	};
+
+	cout << "Training the PeopleFinder classifier on " << file_count << " files... Please Wait..." << endl;
+	if (pool != NULL)
+	{
+		pool->parallel_for(num_parts, train_part);
+	}
+	else
+	{
+		train_part(0);
+	}
 
-		if (!bad_skel_flag) 
+	for (i = 0; i < num_parts; i++)	//merge the ranges found by each worker
+	{
+		if (part_count[i] > 0)
 		{
-			train_compare_ranges(feature_nodes);
+			model.merge(part_models[i]);
 		}
-		bad_skel_flag = false;
 	}
 	cout << "Classifier has been trained" << endl;
 }
 
 /**
- *  @desc Checks/Sets the boundaries for the classifier to use on the test data
+ *  @desc Loads the trained ranges from the model file for the current training directory,
+ *  only training the classifier if no matching model has been saved yet. The model file
+ *  is named after a hash of the training directory, so adding, removing or editing a
+ *  training image causes the classifier to be retrained.
  *
- *  @param vector<Point> feature nodes - positions of each feature in the current skeleton
+ *  @param ThreadPool *pool - workers to train on if the model has to be rebuilt
  */
-void PeopleFinder::train_compare_ranges(vector<Point> feature_nodes)
+void PeopleFinder::train_or_load(ThreadPool *pool)
 {
-	int i;
+	unsigned long long dataset_hash = hash_dataset_files(training_path);
+	string model_path = cache_file_path(dataset_hash, ".model");
+
+	if (load_model(model_path, dataset_hash))
+	{
+		cout << "Loaded the trained classifier from " << model_path << endl;
+		return;
+	}
+
+	train(pool);
+	if (save_model(model_path, dataset_hash))
+	{
+		cout << "Saved the trained classifier to " << model_path << endl;
+	}
+}
+
+/**
+ *  @desc Names a file kept alongside the training data for the current training
+ *  directory, after the hash of its files
+ *
+ *  @param unsigned long long dataset_hash - hash of the training directory
+ *  @param string extension - .model or .dataset
+ *
+ *  @returns string - path of the file
+ */
+string PeopleFinder::cache_file_path(unsigned long long dataset_hash, string extension)
+{
+	stringstream ss;
 
-	for (i = 0; i < 11; i++)
+	ss << resolve_directory("training/") << CACHE_FILE_PREFIX << hex << setw(16) << setfill('0') << dataset_hash << extension;
+	return ss.str();
+}
+
+/**
+ *  @desc Compiles the training directory into a .dataset file, see DatasetCache. Each
+ *  image is decoded, converted and resized once here, on the pool, then written in
+ *  directory order. Files are decoded DATASET_COMPILE_WINDOW at a time and each window
+ *  is written and freed before the next, so the training set is never held in memory
+ *  at once. Later training, demos and benchmarks read the compiled file until the
+ *  directory changes.
+ *
+ *  @param ThreadPool *pool - workers to decode on, NULL decodes on the calling thread
+ *  @param bool with_skeletons - also store the skeleton of each image
+ *
+ *  @returns false if the file couldn't be written
+ */
+bool PeopleFinder::compile_dataset(ThreadPool *pool, bool with_skeletons)
+{
+	const string directory = training_path;
+	unsigned long long dataset_hash = hash_dataset_files(directory);
+	string cache_path = cache_file_path(dataset_hash, ".dataset");
+	vector<string> filenames = search_dataset_files(directory);
+	vector<Mat> images(DATASET_COMPILE_WINDOW);
+	vector<vector<Point>> skeletons(DATASET_COMPILE_WINDOW);
+	vector<char> bad_flags(DATASET_COMPILE_WINDOW, 0);
+	DatasetCache writer;
+	int window_start = 0, window_size;
+	int i, written = 0;
+
+	auto compile_file = [this, &filenames, &directory, &images, &skeletons, &bad_flags, &window_start, with_skeletons](int slot)
 	{
-		if (feature_nodes[i].x <= min_range[i].x)
+		BlobDetector bd;
+		Mat contourimg, contoursonly;
+		bool bad_skel_flag = false;
+
+		bad_flags[slot] = 0;
+		if (!load_dataset_file(filenames[window_start + slot], directory, &images[slot]) || !with_skeletons)
 		{
-			min_range[i].x = feature_nodes[i].x;
+			return;
 		}
-		if (feature_nodes[i].y <= min_range[i].y)
+		contourimg = bd.highlight_contours(&images[slot], &images[slot], &contoursonly);
+		skeletons[slot] = create_skeleton(&contoursonly, get_thread_workspace(), &bad_skel_flag);
+		bad_flags[slot] = bad_skel_flag ? 1 : 0;
+	};
+
+	if (!writer.begin_writing(cache_path, dataset_hash, with_skeletons ? MODEL_FILE_VERSION : 0))
+	{
+		return false;
+	}
+
+	cout << "Compiling " << filenames.size() << " training files... Please Wait..." << endl;
+	for (window_start = 0; window_start < filenames.size(); window_start += window_size)
+	{
+		window_size = min((int)filenames.size() - window_start, DATASET_COMPILE_WINDOW);
+		if (pool != NULL)
 		{
-			min_range[i].y = feature_nodes[i].y;
+			pool->parallel_for(window_size, compile_file);
 		}
-		if (feature_nodes[i].x >= max_range[i].x)
+		else
 		{
-			max_range[i].x = feature_nodes[i].x;
+			for (i = 0; i < window_size; i++)
+			{
+				compile_file(i);
+			}
 		}
-		if (feature_nodes[i].y >= max_range[i].y)
+
+		for (i = 0; i < window_size; i++)
 		{
-			max_range[i].y = feature_nodes[i].y;
+			if (!images[i].empty())
+			{
+				writer.add_image(filenames[window_start + i], images[i], with_skeletons ? &skeletons[i] : NULL, bad_flags[i] != 0);
+				written++;
+				images[i].release();
+			}
 		}
 	}
+
+	if (!writer.finish_writing())
+	{
+		return false;
+	}
+	cout << "Compiled " << written << " images to " << cache_path << endl;
+	return true;
+}
+
+/**
+ *  @desc Writes the trained ranges to a binary model file. The file starts with a magic
+ *  string, the format version and the hash of the training directory it was built from,
+ *  followed by the number of feature nodes and the min/max x/y of each node.
+ *
+ *  @param string model_path - file to write
+ *  @param unsigned long long dataset_hash - hash of the training directory
+ *
+ *  @returns false if the file couldn't be written
+ */
+bool PeopleFinder::save_model(string model_path, unsigned long long dataset_hash)
+{
+	ofstream model_file(model_path, ios::binary | ios::trunc);
+	unsigned int version = MODEL_FILE_VERSION;
+	unsigned int node_count = FEATURE_NODES;
+	int range[4];
+	int i;
+
+	if (!model_file.is_open())
+	{
+		return false;
+	}
+
+	model_file.write(MODEL_FILE_MAGIC, 8);
+	model_file.write((const char *)&version, sizeof(version));
+	model_file.write((const char *)&dataset_hash, sizeof(dataset_hash));
+	model_file.write((const char *)&node_count, sizeof(node_count));
+	for (i = 0; i < node_count; i++)
+	{
+		range[0] = model.get_min(i).x;
+		range[1] = model.get_min(i).y;
+		range[2] = model.get_max(i).x;
+		range[3] = model.get_max(i).y;
+		model_file.write((const char *)range, sizeof(range));
+	}
+
+	return model_file.good();
+}
+
+/**
+ *  @desc Reads the trained ranges from a binary model file written by save_model()
+ *
+ *  @param string model_path - file to read
+ *  @param unsigned long long dataset_hash - hash the model must have been built from
+ *
+ *  @returns false if the file is missing, from another version or another training set
+ */
+bool PeopleFinder::load_model(string model_path, unsigned long long dataset_hash)
+{
+	ifstream model_file(model_path, ios::binary);
+	char magic[8];
+	unsigned int version = 0, node_count = 0;
+	unsigned long long file_hash = 0;
+	FeatureModel file_model;
+	int range[4];
+	int i;
+
+	if (!model_file.is_open())
+	{
+		return false;
+	}
+
+	model_file.read(magic, 8);
+	model_file.read((char *)&version, sizeof(version));
+	model_file.read((char *)&file_hash, sizeof(file_hash));
+	model_file.read((char *)&node_count, sizeof(node_count));
+	if (!model_file.good() || memcmp(magic, MODEL_FILE_MAGIC, 8) != 0 || version != MODEL_FILE_VERSION ||
+		file_hash != dataset_hash || node_count != FEATURE_NODES)
+	{
+		return false;
+	}
+
+	for (i = 0; i < node_count; i++)
+	{
+		model_file.read((char *)range, sizeof(range));
+		file_model.set_range(i, Point(range[0], range[1]), Point(range[2], range[3]));
+	}
+	if (!model_file.good())
+	{
+		return false;
+	}
+
+	model = file_model;
+	return true;
+}
+
+/**
+ *  @desc Hashes the name, size and modification time of every file in the training
+ *  directory (FNV-1a), without opening the files themselves. Directories, including
+ *  . and .., and the model and dataset cache files are left out, so saving a cache
+ *  doesn't change the hash it was saved under.
+ *
+ *  @param const string directory - training directory
+ *
+ *  @returns unsigned long long - hash of the directory listing
+ */
+unsigned long long PeopleFinder::hash_dataset_files(const string directory)
+{
+	HANDLE hFind;
+	WIN32_FIND_DATA data;
+	vector<string> entries;
+	stringstream ss;
+	unsigned long long hash = 14695981039346656037ULL;
+	string tempstr;
+	int i, j;
+
+	tempstr = resolve_directory(directory);
+	hFind = FindFirstFile(tempstr.c_str(), &data);
+	if (hFind != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0 ||
+				strncmp(data.cFileName, CACHE_FILE_PREFIX, strlen(CACHE_FILE_PREFIX)) == 0)
+			{
+				continue;
+			}
+			ss.str("");
+			ss << data.cFileName << "|" << data.nFileSizeHigh << ":" << data.nFileSizeLow << "|"
+				<< data.ftLastWriteTime.dwHighDateTime << ":" << data.ftLastWriteTime.dwLowDateTime;
+			entries.push_back(ss.str());
+		} while (FindNextFile(hFind, &data));
+		FindClose(hFind);
+	}
+	sort(entries.begin(), entries.end());	//listing order isn't guaranteed
+
+	ss.str("");
+	ss << MODEL_FILE_VERSION << "|" << directory;
+	entries.insert(entries.begin(), ss.str());
+	for (i = 0; i < entries.size(); i++)
+	{
+		for (j = 0; j < entries[i].size(); j++)
+		{
+			hash ^= (unsigned char)entries[i][j];
+			hash *= 1099511628211ULL;
+		}
+		hash ^= '\n';
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
 }
 
 /**
  *  @desc Similar to the train() function except it displays the feature skeletons
- *  it creates for each image in the training directory
+ *  it creates for each image in the training directory, read from the compiled
+ *  dataset when there is one
  */
 void PeopleFinder::demo()
 {
-	vector<string> filenames(2000);
-	vector<Mat> images(2000);
-	Mat tempimg, contourimg, contoursonly, distimg;
-	int i = 0;
+	vector<string> filenames;
+	Mat image, contourimg, contoursonly;
+	int i, file_count;
+	bool bad_skel_flag = false;
 	const string directory = training_path;
-	BlobDetector bd = BlobDetector(vector<Mat>(20));
+	unsigned long long dataset_hash = hash_dataset_files(directory);
+	DatasetCache cache;
+	bool cached = cache.open(cache_file_path(dataset_hash, ".dataset"), dataset_hash, MODEL_FILE_VERSION);
+	BlobDetector bd;
 
-	filenames = search_dataset_files(directory); //FORMAT: place folder in AutoSurvCV, forward slashes and end in "*.*"
-	images = load_dataset_files(filenames, directory);
-	while (!images[i].rows == 0)
+	if (cached)
+	{
+		file_count = (int)cache.get_count();
+	}
+	else
+	{
+		filenames = search_dataset_files(directory); //FORMAT: place folder in AutoSurvCV, forward slashes and end in "*.*"
+		file_count = (int)filenames.size();
+	}
+	for (i = 0; i < file_count; i++)
 	{
-		contourimg = bd.highlight_contours(&images[i], &images[i], &contoursonly);
-		create_skeleton(&contoursonly);
-		imshow("Ground Truth Data", images[i]);
+		if (cached)
+		{
+			image = cache.get_image(i);
+		}
+		else if (!load_dataset_file(filenames[i], directory, &image))
+		{
+			continue;
+		}
+		contourimg = bd.highlight_contours(&image, &image, &contoursonly);
+		create_skeleton(&contoursonly, get_thread_workspace(), &bad_skel_flag);
+		bad_skel_flag = false;
+		imshow("Ground Truth Data", image);
 		moveWindow("Ground Truth Data", 128, 128);
 		imshow("Contours Only", contoursonly);
 		moveWindow("Contours Only", 192, 128);
 		waitKey(0);
 		destroyWindow("Ground Truth Data");
 		destroyWindow("Contours Only");
-		i++;
 	}
 }
 
 /**
- *  @desc Creates a feature skeleton within each shape, and classifies them.
+ *  @desc Creates a feature skeleton within each shape, and classifies them. Every shape
+ *  is independent, so they are spread across the thread pool when one is given.
+ *
+ *  @param vector<Mat> *shapes - taken from the current contour frame
+ *  @param ThreadPool *pool - workers to classify the shapes on, NULL runs them in turn
  *
- *  @param vector<Point> *shapes - taken from the current contour frame
+ *  @returns vector<Verdict> verdicts - the classification of each shape
  */
-void PeopleFinder::test(vector<Mat> *shapes)
+vector<Verdict> PeopleFinder::test(vector<Mat> *shapes, ThreadPool *pool)
 {
-	vector<Point> skeleton;
-	verdicts = vector<string>(20);
-	int i = 0;
-	vector<Mat>& shapes_ref = *shapes;
-
-	while (shapes_ref[i].rows != 0)
-	{	
-		skeleton = create_skeleton(&shapes_ref[i]);
-		verdicts[i] = judge_features(skeleton);
-		i++;
-	}
+	return test(shapes, pool, pool != NULL ? pool->get_size() : 0, NULL);
 }
 
 /**
- *  @desc Classifies the skeleton, result depends on the number of features that fall within
- *  the minimum/maximum x/y ranges.
+ *  @desc As test(shapes, pool), but uses at most max_helpers of the pool's workers so
+ *  several video streams can share one pool, and can also return each shape's score.
+ *  The skeletons are built in parallel into one batch, which is then scored in a
+ *  single pass.
  *
- *  @param vector<Point> feature nodes - positions of each feature in the current skeleton
+ *  @param vector<Mat> *shapes - taken from the current contour frame
+ *  @param ThreadPool *pool - workers to classify the shapes on, NULL runs them in turn
+ *  @param int max_helpers - most workers to use alongside the calling thread
+ *  @param vector<int> *scores - filled with the feature score of each shape, may be NULL
  *
- *  @returns string verdict - the classification
+ *  @returns vector<Verdict> verdicts - the classification of each shape
  */
-string PeopleFinder::judge_features(vector<Point> nodes)
+vector<Verdict> PeopleFinder::test(vector<Mat> *shapes, ThreadPool *pool, int max_helpers, vector<int> *scores)
 {
-	string verdict;
-	int feature_score = 0;
+	SkeletonBatch batch;
+	vector<unsigned int> masks;
+	vector<Verdict> verdicts(shapes->size(), VERDICT_NONE);
+	int i, feature_score, built;
 
-	for (int i = 0; i < 11; i++)
+	if (scores != NULL)
 	{
-		if (is_within_bound(nodes[i], min_range[i].x, min_range[i].y , max_range[i].x, max_range[i].y))
+		scores->assign(shapes->size(), 0);
+	}
+
+	built = build_skeletons(shapes, pool, max_helpers, &batch);
+	score_batch(batch, &masks);
+	for (i = 0; i < built; i++)
+	{
+		feature_score = FeatureModel::mask_score(masks[i]);
+		verdicts[i] = judge_score(feature_score);
+		if (scores != NULL)
 		{
-			feature_score++;
+			(*scores)[i] = feature_score;
 		}
 	}
 
-	if (feature_score >= 7)
+	return verdicts;
+}
+
+/**
+ *  @desc Creates the feature skeleton of each shape into a batch, up to the first empty
+ *  shape. Every shape is independent, so they are spread across the pool when one is
+ *  given, each filling its own slot.
+ *
+ *  @param vector<Mat> *shapes - taken from the current contour frame
+ *  @param ThreadPool *pool - workers to build the skeletons on, NULL runs them in turn
+ *  @param int max_helpers - most workers to use alongside the calling thread
+ *  @param SkeletonBatch *batch - filled with one skeleton per shape
+ *
+ *  @returns int - skeletons built
+ */
+int PeopleFinder::build_skeletons(vector<Mat> *shapes, ThreadPool *pool, int max_helpers, SkeletonBatch *batch)
+{
+	vector<Mat>& shapes_ref = *shapes;
+	int i = 0;
+
+	while (i < shapes_ref.size() && shapes_ref[i].rows != 0)
 	{
-		verdict = "Pedestrian";
+		i++;
 	}
-	else if (feature_score >= 3)
+	batch->resize(i);
+
+	auto build_shape = [this, &shapes_ref, batch](int n)
+	{
+		bool bad_flag = false;
+
+		batch->set_skeleton(n, create_skeleton(&shapes_ref[n], get_thread_workspace(), &bad_flag));
+	};
+
+	if (pool != NULL)
 	{
-		verdict = "Something";
+		pool->parallel_for(i, build_shape, max_helpers);
 	}
 	else
 	{
-		verdict = "Noise";
+		for (int n = 0; n < i; n++)
+		{
+			build_shape(n);
+		}
 	}
 
-	return verdict;
+	return i;
 }
 
-vector<string> PeopleFinder::get_verdicts()
+/**
+ *  @desc Scores a batch of skeletons against the trained ranges in one pass. The batch
+ *  may hold the skeletons of several frames or streams.
+ *
+ *  @param const SkeletonBatch &batch - the skeletons
+ *  @param vector<unsigned int> *masks - filled with the bitmask of features in range of each skeleton
+ */
+void PeopleFinder::score_batch(const SkeletonBatch &batch, vector<unsigned int> *masks)
 {
-	return verdicts;
+	model.score_batch(batch, masks);
 }
 
-bool PeopleFinder::get_bad_flag()
+/**
+ *  @desc Classifies the skeleton, result depends on the number of features that fall within
+ *  the minimum/maximum x/y ranges.
+ *
+ *  @param vector<Point> feature nodes - positions of each feature in the current skeleton
+ *
+ *  @returns Verdict verdict - the classification
+ */
+Verdict PeopleFinder::judge_features(const vector<Point> &nodes)
+{
+	return judge_score(score_features(nodes));
+}
+
+/**
+ *  @desc Counts the features of the skeleton that fall within the minimum/maximum x/y
+ *  ranges.
+ *
+ *  @param vector<Point> feature nodes - positions of each feature in the current skeleton
+ *
+ *  @returns int feature_score - number of features in range
+ */
+int PeopleFinder::score_features(const vector<Point> &nodes)
+{
+	return FeatureModel::mask_score(score_feature_mask(nodes));
+}
+
+/**
+ *  @desc Finds which features of the skeleton fall within the minimum/maximum x/y ranges
+ *
+ *  @param vector<Point> feature nodes - positions of each feature in the current skeleton
+ *
+ *  @returns unsigned int - bit i set when feature i is in range
+ */
+unsigned int PeopleFinder::score_feature_mask(const vector<Point> &nodes)
+{
+	return model.score_mask(nodes);
+}
+
+/**
+ *  @desc Turns a feature score into the classification
+ *
+ *  @param int feature_score - number of features in range
+ *
+ *  @returns Verdict verdict - the classification
+ */
+Verdict PeopleFinder::judge_score(int feature_score)
 {
-	return bad_skel_flag;
+	return FeatureModel::judge_score(feature_score);
 }
 
 /**
  *  @desc Fills each pixel inside the contour shape with blue to distinguish them
  *  from outer pixels. Calls each body part detection function to create a vector of
- *  feature positions.
+ *  feature positions. Shapes from the ComponentDetector arrive already filled and skip
+ *  the fill.
  *
- *  @param Mat *contoursonly - the contour only shape
+ *  All scratch space comes from the workspace, so no memory is allocated per shape.
+ *  The returned nodes belong to the workspace and are overwritten by its next use.
+ *  The seed, corners and search rows come from the canvas geometry, so each canvas
+ *  size gets its own build of the kernels with the loop bounds fixed.
  *
- *  @returns vector<Point> nodes - the x/y positions of each body part
+ *  @param Canvas - the ShapeCanvasGeometry the shape was drawn on
+ *  @param Mat *contoursonly - the contour only shape, must match the canvas size
+ *  @param SkeletonWorkspace *workspace - reusable buffers for the current thread
+ *  @param bool *bad_flag - raised if it fails to build a skeleton
+ *
+ *  @returns const vector<Point>& nodes - the x/y positions of each body part
  */
-vector<Point> PeopleFinder::create_skeleton(Mat *contoursonly)
+template<class Canvas>
+const vector<Point>& PeopleFinder::create_skeleton(Mat *contoursonly, SkeletonWorkspace *workspace, bool *bad_flag)
 {
-	vector<Point> nodes(11);
-	vector<Point> shape_pixels(8192);
-	vector<Point> outline_pixels(4096);
+	vector<Point>& nodes = workspace->nodes;
+	const PixelRows& shape_pixels = workspace->shape_pixels;
+	const PixelRows& outline_pixels = workspace->outline_pixels;
 	Point halfway_node = Point(1000, 1000);
-	bool insideshape = false;
 	int arm_width;
-	int index_head = 0, index_torso = 0, index_waist = 0, index_shoulders = 0;
 	double halfway_dist;
 
-	if (contoursonly->at<Vec3b>(64, 32) != Vec3b(0, 0, 255)) // checks to see if the middle pixel overlaps with a contour
+	static_assert(Canvas::pixels <= ShapeCanvas::pixels, "SkeletonWorkspace is sized for ShapeCanvas, grow it for larger canvases");
+
+	fill(nodes.begin(), nodes.end(), Point(0, 0));
+
+	if (contoursonly->rows != Canvas::rows || contoursonly->cols != Canvas::cols || contoursonly->type() != CV_8UC3)
+	{
+		*bad_flag = true;
+		return nodes;
+	}
+
+	if (contoursonly->at<Vec3b>(Canvas::centre_row, Canvas::centre_col) != Vec3b(0, 0, 255) &&
+		contoursonly->at<Vec3b>(Canvas::centre_row, Canvas::centre_col) != Vec3b(64, 0, 0)) // checks to see if the middle pixel overlaps with a contour, canvases from the ComponentDetector come filled
 	{
-		floodFill(*contoursonly, Point(32, 64), Scalar(64, 0, 0)); //assumes the middle pixel always falls inside the shape
+		fill_shape<Canvas>(contoursonly, Point(Canvas::centre_col, Canvas::centre_row), Vec3b(64, 0, 0), workspace->fill_stack); //assumes the middle pixel always falls inside the shape
 	}
 
-	if (contoursonly->at<Vec3b>(0, 0) != Vec3b(64, 0, 0) && contoursonly->at<Vec3b>(64, 32) != Vec3b(0, 0, 255)) // if the fill is outside the center, skip the image(poor quality image)
+	if (contoursonly->at<Vec3b>(0, 0) != Vec3b(64, 0, 0) && contoursonly->at<Vec3b>(Canvas::centre_row, Canvas::centre_col) != Vec3b(0, 0, 255)) // if the fill is outside the center, skip the image(poor quality image)
 	{
-		highlight_pixels(contoursonly, &shape_pixels, &outline_pixels);
+		highlight_pixels<Canvas>(contoursonly, &workspace->shape_pixels, &workspace->outline_pixels);
 
-		nodes[0] = find_head_feature(shape_pixels, 5, &index_head);
-		nodes[1] = find_torso_feature(shape_pixels, 5, nodes[0], index_head, &index_torso);
-		if (is_within_bound(nodes[1], 0 , 0, contoursonly->rows, contoursonly->cols))	//Torso gives good indication on whether the shape is valid or not
+		nodes[0] = find_head_feature(shape_pixels, Canvas::threshold);
+		nodes[1] = find_torso_feature<Canvas>(shape_pixels, Canvas::threshold, nodes[0]);
+		if (is_within_bound(nodes[1], 0 , 0, Canvas::rows, Canvas::cols))	//Torso gives good indication on whether the shape is valid or not
 		{
-			nodes[2] = find_waist_feature(shape_pixels, 5, nodes[1], index_torso, &index_waist);
+			nodes[2] = find_waist_feature<Canvas>(shape_pixels, Canvas::threshold, nodes[1], bad_flag);
 			calc_halfway_torso_dist(nodes[1], nodes[2], &halfway_node, &halfway_dist);
 
-			nodes[3] = find_foot_feature(shape_pixels, 5, nodes[2], Point(127, 1), index_waist);
-			nodes[4] = find_foot_feature(shape_pixels, 5, nodes[2], Point(127, 63), index_waist);
+			nodes[3] = find_foot_feature<Canvas>(shape_pixels, Canvas::threshold, nodes[2], Point(Canvas::foot_row, Canvas::left_foot_col));
+			nodes[4] = find_foot_feature<Canvas>(shape_pixels, Canvas::threshold, nodes[2], Point(Canvas::foot_row, Canvas::right_foot_col));
 
-			set_shoulder_positions(shape_pixels, 5, nodes[1], &nodes[5], &nodes[6], &arm_width, index_torso, &index_shoulders);
-			nodes[7] = find_elbow_feature(shape_pixels, nodes[1], nodes[2], nodes[5], &arm_width, halfway_dist, halfway_node, index_shoulders);
-			nodes[8] = find_hand_feature(shape_pixels, outline_pixels, nodes[2], nodes[7], &arm_width, halfway_dist, halfway_node, contoursonly, index_shoulders);
-			nodes[9] = find_elbow_feature(shape_pixels, nodes[1], nodes[2], nodes[6], &arm_width, halfway_dist, halfway_node, index_shoulders);
-			nodes[10] = find_hand_feature(shape_pixels, outline_pixels, nodes[2], nodes[9], &arm_width, halfway_dist, halfway_node, contoursonly, index_shoulders);
+			set_shoulder_positions(shape_pixels, Canvas::threshold, nodes[1], &nodes[5], &nodes[6], &arm_width);
+			nodes[7] = find_elbow_feature(shape_pixels, nodes[1], nodes[2], nodes[5], &arm_width, halfway_dist, halfway_node, bad_flag);
+			nodes[8] = find_hand_feature(shape_pixels, outline_pixels, nodes[2], nodes[7], &arm_width, halfway_dist, halfway_node, contoursonly, bad_flag);
+			nodes[9] = find_elbow_feature(shape_pixels, nodes[1], nodes[2], nodes[6], &arm_width, halfway_dist, halfway_node, bad_flag);
+			nodes[10] = find_hand_feature(shape_pixels, outline_pixels, nodes[2], nodes[9], &arm_width, halfway_dist, halfway_node, contoursonly, bad_flag);
 
-			draw_skeleton(contoursonly, nodes);
+			draw_skeleton(contoursonly, nodes, bad_flag);
 		}
 		else
 		{
-			bad_skel_flag = true;
+			*bad_flag = true;
 		}
 	}
 	else
 	{
-		bad_skel_flag = true;
+		*bad_flag = true;
 	}
 	
 	return nodes;
@@ -260,119 +706,142 @@ vector<Point> PeopleFinder::create_skeleton(Mat *contoursonly)
 }
 
 /**
- *  @desc saves the x/y positions of the pixels within and on the outline of the shape
+ *  @desc Gets the skeleton workspace belonging to the calling thread, created on first use
  *
- *  @param Mat *contoursonly - the contours of the shape
- *  @param vector<Point> *shapes_pixels - x/y positions within the shape
- *  @param vector<Point> *outline_pixels - x/y positions in the outline of the shape
+ *  @returns SkeletonWorkspace * - workspace for this thread
  */
-void PeopleFinder::highlight_pixels(Mat *contoursonly, vector<Point> *shape_pixels, vector<Point> *outline_pixels)
+SkeletonWorkspace *PeopleFinder::get_thread_workspace()
 {
-	int i, j, k, m;
-	k = 0;
-	m = 0;
-	vector<Point>& shape_pixels_ref = *shape_pixels;
-	vector<Point>& outline_pixels_ref = *outline_pixels;
+	static thread_local SkeletonWorkspace workspace;
+	return &workspace;
+}
+
+/**
+ *  @desc Colours the 4-connected region of pixels matching the seed pixel, the same as
+ *  OpenCV's floodFill with no tolerance, but using a preallocated stack. Pixels are
+ *  coloured as they are pushed, so each is pushed at most once and the stack never
+ *  needs more than Canvas::pixels entries.
+ *
+ *  @param Canvas - the ShapeCanvasGeometry the shape was drawn on
+ *  @param Mat *contoursonly - the contours of the shape, one canvas in size
+ *  @param Point seed - x/y (column/row) position to start from
+ *  @param Vec3b colour - the fill colour
+ *  @param Point *fill_stack - scratch stack of at least Canvas::pixels entries
+ */
+template<class Canvas>
+void PeopleFinder::fill_shape(Mat *contoursonly, Point seed, Vec3b colour, Point *fill_stack)
+{
+	Vec3b *data = contoursonly->ptr<Vec3b>(0);
+	const int step = (int)(contoursonly->step / sizeof(Vec3b));
+	Vec3b target = data[seed.y * step + seed.x];
+	Vec3b *pixel;
+	Point current;
+	int top = 0;
+
+	if (target == colour)
+	{
+		return;
+	}
 
-	for (i = 0; i < contoursonly->rows; i++)
+	data[seed.y * step + seed.x] = colour;
+	fill_stack[top++] = seed;
+	while (top > 0)
 	{
-		for (j = 0; j < contoursonly->cols; j++)
+		current = fill_stack[--top];
+		pixel = data + current.y * step + current.x;
+
+		if (current.x > 0 && pixel[-1] == target)
 		{
-			if (contoursonly->at<Vec3b>(i, j) == Vec3b(64, 0, 0))
-			{
-				shape_pixels_ref[k] = Point(i, j);
-				k++;
-			}
-			if (contoursonly->at<Vec3b>(i, j) == Vec3b(0, 0, 255))
-			{
-				outline_pixels_ref[m] = Point(i, j);
-				m++;
-			}
+			pixel[-1] = colour;
+			fill_stack[top++] = Point(current.x - 1, current.y);
+		}
+		if (current.x < Canvas::cols - 1 && pixel[1] == target)
+		{
+			pixel[1] = colour;
+			fill_stack[top++] = Point(current.x + 1, current.y);
+		}
+		if (current.y > 0 && pixel[-step] == target)
+		{
+			pixel[-step] = colour;
+			fill_stack[top++] = Point(current.x, current.y - 1);
+		}
+		if (current.y < Canvas::rows - 1 && pixel[step] == target)
+		{
+			pixel[step] = colour;
+			fill_stack[top++] = Point(current.x, current.y + 1);
 		}
 	}
 }
 
 /**
- *  @desc locates the head position by searching for the highest offset pixel
+ *  @desc locates the head position by taking the highest pixel in the shape
  *
- *  @param vector<Point> shape_pixels - x/y positions inside the shape
+ *  @param const PixelRows &shape_pixels - x/y positions inside the shape
  *  @param int threshold - arbitrary offset
- *  @param int *index_head - index in the shape_pixels vector of the head pixel
  *
  *  @returns Point headnode - the head position
  */
-Point PeopleFinder::find_head_feature(vector<Point> shape_pixels, int threshold, int *index_head)
+Point PeopleFinder::find_head_feature(const PixelRows &shape_pixels, int threshold)
 {
-	int i = 0;
+	int row = shape_pixels.first_row(0);
 	Point headnode = Point(1000,1000);
 
-	while (shape_pixels[i] != Point(0, 0) && shape_pixels[i].x < headnode.x + threshold)	//Assume the head has been found after the first few rows have been searched
+	if (row < shape_pixels.rows)
 	{
-		if (shape_pixels[i].x < headnode.x)
-		{
-			headnode.x = shape_pixels[i].x;
-			headnode.y = shape_pixels[i].y;
-			*index_head = i;
-		}
-		i++;
+		headnode = shape_pixels.pixels[shape_pixels.row_begin(row)];
 	}
 	headnode.x += threshold;
 	return headnode;
 }
 
 /**
- *  @desc locates the torso position by taking the largest distance between each side
- *  of the shape in the upper region of the shape
+ *  @desc locates the torso position by taking the row with the shortest distance between
+ *  each side of the shape in the upper region of the shape
  *
- *  @param vector<Point> shape_pixels - x/y positions inside the shape
+ *  @param Canvas - the ShapeCanvasGeometry giving the search rows
+ *  @param const PixelRows &shape_pixels - x/y positions inside the shape
  *  @param int threshold - arbitrary offset
  *  @param Point head_feature - the head position
- *  @param int *index_head - index in the shape_pixels vector of the head pixel
- *  @param int *index_torso - index in the shape_pixels vector of the torso pixel
  *
  *  @returns Point torsonode - the torso position
  */
-Point PeopleFinder::find_torso_feature(vector<Point> shape_pixels, int threshold, Point head_feature, int index_head, int *index_torso)
+template<class Canvas>
+Point PeopleFinder::find_torso_feature(const PixelRows &shape_pixels, int threshold, Point head_feature)
 {
-	int i = index_head;	//Start the initial iterations from the head pixel
-	int lower_bound_x = 48; //half way down the image
+	int lower_bound_x = Canvas::torso_end_row;
 	Point torsonode = Point(1000, 1000);
 	Point best_fit_node = Point(1000, 1000);
-	Point current_row = shape_pixels[0];
 	int shortest_dist = 1000;
 	int current_dist = 0; //distance between two sides of the shape
-	int head_range_y = 10;
+	int row;
 
 	if (lower_bound_x < head_feature.x) //prevent out of bound errors, lower boundary for the torso must at least be lower than the head
 	{
 		lower_bound_x = head_feature.x + 1;
 	}
-
-	while (shape_pixels[i].x < head_feature.x + threshold && shape_pixels[i] != Point(0, 0)) //skip the pixels above the head feature
+	if (lower_bound_x > shape_pixels.rows)
 	{
-		i++;
+		lower_bound_x = shape_pixels.rows;
 	}
 
-	current_row = shape_pixels[i];
-	best_fit_node = shape_pixels[i];
+	row = shape_pixels.first_row(head_feature.x + threshold); //skip the rows above the head feature
+	if (row < shape_pixels.rows)
+	{
+		best_fit_node = shape_pixels.pixels[shape_pixels.row_begin(row)];
+	}
 
-	while (shape_pixels[i] != Point(0, 0) && shape_pixels[i].x < lower_bound_x)
+	for (; row < lower_bound_x; row++)
 	{
-		i++;
-		if (shape_pixels[i].x == current_row.x)
+		if (shape_pixels.row_size(row) == 0)
 		{
-			current_dist += 1;
+			continue;
 		}
-		else
+
+		current_dist = shape_pixels.row_size(row) - 1;
+		if (current_dist < shortest_dist)
 		{
-			if (current_dist < shortest_dist)
-			{
-				shortest_dist = current_dist;
-				best_fit_node = shape_pixels[i - 1];
-				*index_torso = i - 1;
-			}
-			current_dist = 0;
-			current_row = shape_pixels[i];
+			shortest_dist = current_dist;
+			best_fit_node = shape_pixels.pixels[shape_pixels.row_end(row) - 1];
 		}
 	}
 
@@ -383,27 +852,64 @@ Point PeopleFinder::find_torso_feature(vector<Point> shape_pixels, int threshold
 }
 
 /**
- *  @desc locates the torso position by searching for shortest distance between each side
+ *  @desc finds the longest unbroken run of pixels in the given rows, gaps caused by
+ *  arms/hands end a run
+ *
+ *  @param const PixelRows &shape_pixels - x/y positions inside the shape
+ *  @param int first_row - first row to search
+ *  @param int end_row - row to stop before
+ *  @param Point *best_fit_node - last pixel of the longest run, left unchanged if no run is longer than 1 pixel
+ *
+ *  @returns int largest_dist - length of the longest run minus one
+ */
+int PeopleFinder::find_widest_run(const PixelRows &shape_pixels, int first_row, int end_row, Point *best_fit_node)
+{
+	int largest_dist = 0;
+	int current_dist;
+	int i, row;
+
+	if (end_row > shape_pixels.rows)
+	{
+		end_row = shape_pixels.rows;
+	}
+
+	for (row = first_row < 0 ? 0 : first_row; row < end_row; row++)
+	{
+		for (i = shape_pixels.run_begin(row); i < shape_pixels.run_end(row); i++)
+		{
+			current_dist = shape_pixels.runs[i].end_col - shape_pixels.runs[i].start_col;
+			if (current_dist > largest_dist)
+			{
+				largest_dist = current_dist;
+				*best_fit_node = Point(row, shape_pixels.runs[i].end_col);
+			}
+		}
+	}
+
+	return largest_dist;
+}
+
+/**
+ *  @desc locates the waist position by searching for largest distance between each side
  *  of the shape in the lower region of the shape
  *
- *  @param vector<Point> shape_pixels - x/y positions inside the shape
+ *  @param Canvas - the ShapeCanvasGeometry giving the search rows
+ *  @param const PixelRows &shape_pixels - x/y positions inside the shape
  *  @param int threshold - arbitrary offset
  *  @param Point torso_feature - the torso position
- *  @param index_torso - index in the shape_pixels vector of the torso pixel
- *  @param *index_waist - index in the shape_pixels vector of the waist pixel
+ *  @param bool *bad_flag - raised if the search fails
  *
  *  @returns Point waistnode - the waist position
  */
-Point PeopleFinder::find_waist_feature(vector<Point> shape_pixels, int threshold, Point torso_feature, int index_torso, int *index_waist)
+template<class Canvas>
+Point PeopleFinder::find_waist_feature(const PixelRows &shape_pixels, int threshold, Point torso_feature, bool *bad_flag)
 {
-	int i = index_torso; //Start the search from the torso pixel
-	int upper_bound_x = 64; //half way down the image
-	int lower_bound_x = 80;
+	int upper_bound_x = Canvas::waist_start_row; //half way down the image
+	int lower_bound_x = Canvas::waist_end_row;
 	Point waistnode = Point(1000, 1000);
 	Point best_fit_node = Point(1000, 1000);
-	Point current_row = shape_pixels[0]; //uses the column (y) axis to check for discontinuities, e.g if it jumps from 1,1 -> 1,3 then 1,2 is a discontinuity
 	int largest_dist = 0;
-	int current_dist = 0; //distance between two sides of the shape
+	int row;
 
 	try
 	{
@@ -412,42 +918,17 @@ Point PeopleFinder::find_waist_feature(vector<Point> shape_pixels, int threshold
 			upper_bound_x = torso_feature.x + 1;
 		}
 
-		while (shape_pixels[i].x < upper_bound_x + threshold && shape_pixels[i] != Point(0,0)) //skip the pixels above the upper boundary, only searching lower half of the body
+		row = shape_pixels.first_row(upper_bound_x + threshold); //skip the rows above the upper boundary, only searching lower half of the body
+		if (row < shape_pixels.rows)
 		{
-			if ((upper_bound_x + threshold - shape_pixels[i].x) >= 8)	//If the shape_pixels search space is 8 rows away from the ideal waist, speed up
-			{
-				i += 100;
-			}
-			i++;
+			best_fit_node = shape_pixels.pixels[shape_pixels.row_begin(row)];
 		}
 
-		current_row = shape_pixels[i];
-		best_fit_node = current_row;
-
-		while (shape_pixels[i] != Point(0, 0) && shape_pixels[i].x < lower_bound_x)
-		{
-			i++;
-			current_row.y += 1; //by increasing the current rows' y position, we can ignore discontinuities cause by arms/hands
-			if (shape_pixels[i] == current_row)
-			{
-				current_dist += 1;
-			}
-			else
-			{
-				if (current_dist > largest_dist)
-				{
-					largest_dist = current_dist;
-					best_fit_node = shape_pixels[i - 1];
-					*index_waist = i - 1;
-				}
-				current_row = shape_pixels[i];
-				current_dist = 0;
-			}
-		}
+		largest_dist = find_widest_run(shape_pixels, row, lower_bound_x, &best_fit_node);
 	}
 	catch (Exception e)
 	{
-		bad_skel_flag = true;
+		*bad_flag = true;
 	}
 
 	waistnode.x = best_fit_node.x - threshold;
@@ -458,46 +939,46 @@ Point PeopleFinder::find_waist_feature(vector<Point> shape_pixels, int threshold
 
 /**
  *  @desc locates the foot position using Pythagoras to find the closest shape pixel to
- *  the corresponding corner. Assumes the feet are below the waist.
+ *  the corresponding corner. Assumes the feet are below the waist. Only the closest
+ *  pixel of each run needs measuring.
  *
- *  @param vector<Point> shape_pixels - x/y positions inside the shape
+ *  @param Canvas - the ShapeCanvasGeometry giving the search rows
+ *  @param const PixelRows &shape_pixels - x/y positions inside the shape
  *  @param int threshold - arbitrary offset
  *  @param Point waist_feature - the waist position
  *  @param Point corner - the corner of the image the pixel should be closest to.
- *  @param index_waist - index in the shape_pixels vector of the waist pixel
  *
  *  @returns Point footnode - the foot position
  */
-Point PeopleFinder::find_foot_feature(vector<Point> shape_pixels, int threshold, Point waist_feature, Point corner, int index_waist)
+template<class Canvas>
+Point PeopleFinder::find_foot_feature(const PixelRows &shape_pixels, int threshold, Point waist_feature, Point corner)
 {
-	int i = index_waist;
-	int upper_bound_x = 70;
+	int upper_bound_x = Canvas::foot_start_row;
 	Point footnode = Point(1000, 1000);
 	Point best_fit_node = Point(1000, 1000);
 	double distx, disty;
 	double current_dist;
 	double shortest_corner_dist = 10000;
+	int i, row, col;
 
 	if (upper_bound_x < waist_feature.x) //prevent out of bound errors, lower boundary for the torso must at least be lower than the head
 	{
 		upper_bound_x = waist_feature.x + 1;
 	}
 
-	while (shape_pixels[i].x < upper_bound_x + threshold && shape_pixels[i] != Point(0,0)) //skip the pixels above the upper boundary, only searching lower half of the body
-	{
-		i++;
-	}
-
-	while (shape_pixels[i] != Point(0, 0))
+	for (row = shape_pixels.first_row(upper_bound_x + threshold); row < shape_pixels.rows; row++) //only searching lower half of the body
 	{
-		i++;
-		distx = (corner.x - shape_pixels[i].x) * (corner.x - shape_pixels[i].x);
-		disty = (corner.y - shape_pixels[i].y) * (corner.y - shape_pixels[i].y);
-		current_dist = sqrt(distx + disty);
-		if (current_dist < shortest_corner_dist)
+		for (i = shape_pixels.run_begin(row); i < shape_pixels.run_end(row); i++)
 		{
-			shortest_corner_dist = current_dist;
-			best_fit_node = shape_pixels[i];
+			col = min(max(corner.y, shape_pixels.runs[i].start_col), shape_pixels.runs[i].end_col);
+			distx = (corner.x - row) * (corner.x - row);
+			disty = (corner.y - col) * (corner.y - col);
+			current_dist = sqrt(distx + disty);
+			if (current_dist < shortest_corner_dist)
+			{
+				shortest_corner_dist = current_dist;
+				best_fit_node = Point(row, col);
+			}
 		}
 	}
 
@@ -510,53 +991,28 @@ Point PeopleFinder::find_foot_feature(vector<Point> shape_pixels, int threshold,
  *  @desc sets the shoulder positions by taking the largest distances around the upper torso
  *  and setting them on each side of the shape
  *
- *  @param vector<Point> shape_pixels - x/y positions inside the shape
+ *  @param const PixelRows &shape_pixels - x/y positions inside the shape
  *  @param int threshold - arbitrary offset
  *  @param Point torso_feature - the torso position
  *  @param *left_shoulder - the left shoulder position
  *  @param *right_shoulder - the right shoulder position
  *  @param int *arm_width - tenth of the distance between shoulders
- *  @param int index_torso - index in the shape_pixels vector of the torso position
- *  @param int *index_shoulders- index in the shape_pixels vector of the right shoulder position
  */
-void PeopleFinder::set_shoulder_positions(vector<Point> shape_pixels, int threshold, Point torso_feature, Point *left_shoulder, Point *right_shoulder, int *arm_width, int index_torso, int *index_shoulders)
+void PeopleFinder::set_shoulder_positions(const PixelRows &shape_pixels, int threshold, Point torso_feature, Point *left_shoulder, Point *right_shoulder, int *arm_width)
 {
-	int i = index_torso;
 	int upper_bound_x = torso_feature.x;
 	int lower_bound_x = torso_feature.x + threshold;
 	Point best_fit_node = Point(1000, 1000);
-	Point current_row = shape_pixels[0]; //uses the column (y) axis to check for discontinuities, e.g if it jumps from 1,1 -> 1,3 then 1,2 is a discontinuity
 	int largest_dist = 0;
-	int current_dist = 0; //distance between two sides of the shape
+	int row;
 
-	while (shape_pixels[i].x < upper_bound_x)
+	row = shape_pixels.first_row(upper_bound_x);
+	if (row < shape_pixels.rows)
 	{
-		i++;
+		best_fit_node = shape_pixels.pixels[shape_pixels.row_begin(row)];
 	}
 
-	current_row = shape_pixels[i];
-	best_fit_node = shape_pixels[i];
-
-	while (shape_pixels[i] != Point(0, 0) && shape_pixels[i].x < lower_bound_x)
-	{
-		i++;
-		current_row.y += 1; //by increasing the current rows' y position, we can ignore discontinuities cause by arms/hands
-		if (shape_pixels[i] == current_row)
-		{
-			current_dist += 1;
-		}
-		else
-		{
-			if (current_dist > largest_dist)
-			{
-				largest_dist = current_dist;
-				best_fit_node = shape_pixels[i - 1];
-				*index_shoulders = i - 1;
-			}
-			current_row = shape_pixels[i];
-			current_dist = 0;
-		}
-	}
+	largest_dist = find_widest_run(shape_pixels, row, lower_bound_x, &best_fit_node);
 
 	*arm_width = largest_dist / 10;
 	if (*arm_width == 0)
@@ -595,73 +1051,84 @@ void PeopleFinder::calc_halfway_torso_dist(Point torso_feature, Point waist_feat
 
 /**
  *  @desc finds the elbow feature by following the corresponding side of the shape for
- *  halfway_dists length
+ *  halfway_dists length. Each row between the shoulder and the halfway node has one
+ *  candidate pixel, arm_width in from the side of the shape.
  *
- *  @param vector<Point> shape_pixels - x/y positions inside the shape
+ *  @param const PixelRows &shape_pixels - x/y positions inside the shape
  *  @param Point torso_feature - the torso position
  *  @param Point waist_feature - the waist position
  *  @param Point shoulder_feature - the shoulder position (elbow connected to)
  *  @param int *arm_width - tenth of the distance between shoulders
  *  @param double *halfway_dist - distance between the torso and waist halved
  *  @param Point *halfway_node - x/y position in the middle between the torso and waist
- *  @param int index_shoulders- index in the shape_pixels vector of the right shoulder position
+ *  @param bool *bad_flag - raised if the search fails
  *
  *  @returns Point elbow_node - the elbow position
  */
-Point PeopleFinder::find_elbow_feature(vector<Point> shape_pixels, Point torso_feature, Point waist_feature, Point shoulder_feature, int *arm_width, double halfway_dist, Point halfway_node, int index_shoulders)
+Point PeopleFinder::find_elbow_feature(const PixelRows &shape_pixels, Point torso_feature, Point waist_feature, Point shoulder_feature, int *arm_width, double halfway_dist, Point halfway_node, bool *bad_flag)
 {
-	int i = index_shoulders;
 	Point elbow_node = Point(1000, 1000);
 	Point best_fit_node = Point(1000, 1000);
 	Point valid_pixel = Point(1000, 1000);
 	double distx, disty;
 	double current_dist;
 	double closest_dist = 100000;
+	bool right_side = (shoulder_feature.y >= torso_feature.y); //right shoudler, assume were looking for the right elbow
+	int row, prev_row, last_row;
 
 	try
 	{
-		while (shape_pixels[i].x < shoulder_feature.x) //assume the elbows are not above the shoulder
+		row = shape_pixels.first_row(shoulder_feature.x); //assume the elbows are not above the shoulder
+		if (row >= shape_pixels.rows)
+		{
+			return elbow_node;
+		}
+
+		prev_row = row - 1;
+		while (prev_row >= 0 && shape_pixels.row_size(prev_row) == 0)
 		{
-			i++;
+			prev_row--;
 		}
-		
-		valid_pixel = Point(shape_pixels[i].x, shape_pixels[i].y + *arm_width);
-		best_fit_node = valid_pixel;
-		if (shoulder_feature.y >= torso_feature.y) //right shoudler, assume were looking for the right elbow
+		if (prev_row < 0)
 		{
-			valid_pixel = Point(shape_pixels[i].x, shape_pixels[i - 1].y - *arm_width);
+			prev_row = row;
 		}
-		i++;
-		
-		while (shape_pixels[i] != Point(0, 0) && shape_pixels[i].x <= halfway_node.x)
+
+		best_fit_node = Point(row, shape_pixels.pixels[shape_pixels.row_begin(row)].y + *arm_width);
+		last_row = min(halfway_node.x, shape_pixels.rows - 1);
+
+		for (; row <= last_row; row++)
 		{
-			i++;
-			if (shape_pixels[i] == valid_pixel)
+			if (shape_pixels.row_size(row) == 0)
+			{
+				continue;
+			}
+
+			valid_pixel = Point(row, shape_pixels.pixels[shape_pixels.row_begin(row)].y + *arm_width);
+			if (right_side)
+			{
+				valid_pixel = Point(row, shape_pixels.pixels[shape_pixels.row_end(prev_row) - 1].y - *arm_width);
+			}
+
+			if (shape_pixels.contains(valid_pixel.x, valid_pixel.y))
 			{
-				distx = (shape_pixels[i].x - shoulder_feature.x) * (shape_pixels[i].x - shoulder_feature.x);
-				disty = (shape_pixels[i].y - shoulder_feature.y) * (shape_pixels[i].y - shoulder_feature.y);
+				distx = (valid_pixel.x - shoulder_feature.x) * (valid_pixel.x - shoulder_feature.x);
+				disty = (valid_pixel.y - shoulder_feature.y) * (valid_pixel.y - shoulder_feature.y);
 				current_dist = sqrt(distx + disty);
 
 				if ((halfway_dist - current_dist) <= closest_dist)
 				{
 					closest_dist = halfway_dist - current_dist;
-					best_fit_node = shape_pixels[i];
-				}
-			}
-			if (shape_pixels[i].x != valid_pixel.x)
-			{
-				valid_pixel = Point(shape_pixels[i].x, shape_pixels[i].y + *arm_width);
-				if (shoulder_feature.y >= torso_feature.y) //right shoudler, assume were looking for the right elbow
-				{
-					valid_pixel = Point(shape_pixels[i].x, shape_pixels[i - 1].y - *arm_width);
+					best_fit_node = valid_pixel;
 				}
 			}
+			prev_row = row;
 		}
 
 	}
 	catch (Exception e)
 	{
-		bad_skel_flag = true;
+		*bad_flag = true;
 	}
 
 	elbow_node = best_fit_node;
@@ -674,57 +1141,45 @@ Point PeopleFinder::find_elbow_feature(vector<Point> shape_pixels, Point torso_f
  *  outline pixels, placing the goal node halfway dists length away in the average direction
  *  and finding the closest pixel within the shape
  *
- *  @param vector<Point> shape_pixels - x/y positions inside the shape
- *  @param vector<Point outline_pixels - x/y positions in the outline of the shape
+ *  @param const PixelRows &shape_pixels - x/y positions inside the shape
+ *  @param const PixelRows &outline_pixels - x/y positions in the outline of the shape
  *  @param Point waist_feature - the waist position
  *  @param Point elbow_feature - the elbow position
  *  @param int *arm_width - tenth of the distance between shoulders
  *  @param double *halfway_dist - distance between the torso and waist halved
  *  @param Point *halfway_node - x/y position in the middle between the torso and waist
  *  @param Mat *contours - the contour image 
- *  @param int index_shoulders- index in the shape_pixels vector of the right shoulder position
+ *  @param bool *bad_flag - raised if the search fails
  *
  *  @param Point hand_node - the hand position
  */
-Point PeopleFinder::find_hand_feature(vector<Point> shape_pixels, vector<Point> outline_pixels, Point waist_feature, Point elbow_feature, int *arm_width, double halfway_dist, Point halfway_node, Mat *contours, int index_shoulders)
+Point PeopleFinder::find_hand_feature(const PixelRows &shape_pixels, const PixelRows &outline_pixels, Point waist_feature, Point elbow_feature, int *arm_width, double halfway_dist, Point halfway_node, Mat *contours, bool *bad_flag)
 {
-	int i = elbow_feature.x, j = index_shoulders; //skip ahead using these idnex values to increase performance
+	int i, row;
 	Point hand_node = Point(1000, 1000);
 	Point best_fit_node = Point(1000, 1000);
 	Point prev_valid_pixel = Point(1000, 1000);
 	Point curr_pixel;
-	vector<Point> neighbours(8);
+	Point neighbours[8];
+	bool have_pixel = false;
 	int dist_iteration = 0;
 	double angle, average_angle = 0;
 
 	try
 	{
-		while (outline_pixels[i].x < elbow_feature.x - *arm_width && i < outline_pixels.size()-1 && outline_pixels[i] != Point(0,0))
+		row = outline_pixels.first_row(elbow_feature.x - *arm_width);
+		if (row < outline_pixels.rows)
 		{
-			if ((elbow_feature.x - *arm_width - outline_pixels[i].x) > 5)	//iterate faster if the goal pixel is far away
+			i = outline_pixels.row_begin(row); //get the first valid node
+			if (elbow_feature.y >= waist_feature.y && i > 0) //if looking for the right arm, assumes the right elbow is right of the waist
 			{
-				i += 10;
+				i--;
 			}
-			i++;
+			curr_pixel = outline_pixels.pixels[i];
+			have_pixel = true;
 		}
 
-	
-		while (shape_pixels[j].x < elbow_feature.x - *arm_width && shape_pixels[j] != Point(0,0))
-		{
-			if ((elbow_feature.x - *arm_width - shape_pixels[j].x) > 5)	//iterate faster if the goal pixel is far away
-			{
-				j += 100;
-			}
-			j++;
-		}
-
-		curr_pixel = outline_pixels[i]; //get the first valid node
-		if (elbow_feature.y >= waist_feature.y) //if looking for the right arm, assumes the right elbow is right of the waist
-		{
-			curr_pixel = outline_pixels[i - 1];
-		}
-
-		while (curr_pixel != Point(0, 0) && dist_iteration <= halfway_dist / 2) //examine neighbours, and follow the outline path for halfway_dist times
+		while (have_pixel && dist_iteration <= halfway_dist / 2) //examine neighbours, and follow the outline path for halfway_dist times
 		{
 			neighbours[0] = Point(curr_pixel.x + 1, curr_pixel.y + 1); //Lower right
 			neighbours[1] = Point(curr_pixel.x + 1, curr_pixel.y); //Lower mid
@@ -756,50 +1211,60 @@ Point PeopleFinder::find_hand_feature(vector<Point> shape_pixels, vector<Point>
 	}
 	catch (Exception e)
 	{
-		bad_skel_flag = true;
+		*bad_flag = true;
 	}
 
-	average_angle = average_angle / dist_iteration;
+	if (dist_iteration > 0)
+	{
+		average_angle = average_angle / dist_iteration;
+	}
 	best_fit_node = Point(elbow_feature.x + halfway_dist * cos(average_angle), elbow_feature.y + halfway_dist * sin(average_angle));
-	hand_node = find_closest_pixel(shape_pixels, best_fit_node, elbow_feature.x + halfway_dist, j);
+	hand_node = find_closest_pixel(shape_pixels, best_fit_node, elbow_feature.x + halfway_dist, elbow_feature.x - *arm_width);
 
 	return hand_node;
 }
 
 /**
- *  @desc finds the closest pixel inside the shape if the goal node is known
+ *  @desc finds the closest pixel inside the shape if the goal node is known, only the
+ *  closest pixel of each run in the search rows needs measuring
  *
- *  @param vector<Point> shape_pixels - x/y positions inside the shape
+ *  @param const PixelRows &shape_pixels - x/y positions inside the shape
  *  @param Point goal_node - the position its aiming for
  *  @param int x_bound - the lower boundary of the search space
- *  @param int n - current iteration of the shape_pixels
+ *  @param int first_row - the upper boundary of the search space
  *
  *  @returns Point best_fit_node - position in the shape closest to the goal
  */
-Point PeopleFinder::find_closest_pixel(vector<Point> shape_pixels, Point goal_node, int x_bound, int n) 
+Point PeopleFinder::find_closest_pixel(const PixelRows &shape_pixels, Point goal_node, int x_bound, int first_row) 
 {
-	Point best_fit_node;
+	Point best_fit_node = Point(1000, 1000);
 	double distx, disty;
 	double current_dist;
 	double best_dist = 1000;
-	
-	n += 200; //assume you won't find an ideal pixel in the first 200 iterations (increase speed)
+	int i, row, col;
 
-	while (shape_pixels[n] != Point(0, 0) && shape_pixels[n].x <= x_bound)
+	if (x_bound >= shape_pixels.rows)
 	{
-		n++;
-		if (shape_pixels[n] == goal_node)
-		{
-			best_fit_node = shape_pixels[n];
-			break;
-		}
-		distx = (goal_node.x - shape_pixels[n].x) * (goal_node.x - shape_pixels[n].x);
-		disty = (goal_node.y - shape_pixels[n].y) * (goal_node.y - shape_pixels[n].y);
-		current_dist = sqrt(distx + disty);
-		if (current_dist <= best_dist)
+		x_bound = shape_pixels.rows - 1;
+	}
+
+	for (row = first_row < 0 ? 0 : first_row; row <= x_bound; row++)
+	{
+		for (i = shape_pixels.run_begin(row); i < shape_pixels.run_end(row); i++)
 		{
-			best_dist = current_dist;
-			best_fit_node = shape_pixels[n];
+			col = min(max(goal_node.y, shape_pixels.runs[i].start_col), shape_pixels.runs[i].end_col);
+			if (row == goal_node.x && col == goal_node.y)
+			{
+				return goal_node;
+			}
+			distx = (goal_node.x - row) * (goal_node.x - row);
+			disty = (goal_node.y - col) * (goal_node.y - col);
+			current_dist = sqrt(distx + disty);
+			if (current_dist <= best_dist)
+			{
+				best_dist = current_dist;
+				best_fit_node = Point(row, col);
+			}
 		}
 	}
 
@@ -812,8 +1277,9 @@ Point PeopleFinder::find_closest_pixel(vector<Point> shape_pixels, Point goal_no
  *
  *  @param Mat *image - image for annotating on
  *  @param vector<Point> nodes - the body part feature nodes
+ *  @param bool *bad_flag - raised if drawing fails
  */
-void PeopleFinder::draw_skeleton(Mat * image, vector<Point> nodes)
+void PeopleFinder::draw_skeleton(Mat * image, const vector<Point> &nodes, bool *bad_flag)
 {
 	int i;
 
@@ -834,7 +1300,7 @@ void PeopleFinder::draw_skeleton(Mat * image, vector<Point> nodes)
 
 		for (i = 0; i < 11; i++)
 		{
-			if (nodes[i] != Point(0, 0))
+			if (is_within_bound(nodes[i], 0, 0, image->rows, image->cols))	//unset and failed nodes fall outside the image
 			{
 				image->at<Vec3b>(nodes[i].x, nodes[i].y) = Vec3b(0, 255, 0);
 				circle(*image, Point(nodes[i].y, nodes[i].x), 2, Scalar(0, 255, 0));
@@ -843,7 +1309,7 @@ void PeopleFinder::draw_skeleton(Mat * image, vector<Point> nodes)
 	}
 	catch (Exception e)
 	{
-		bad_skel_flag = true;
+		*bad_flag = true;
 	}
 }
 
@@ -864,19 +1330,16 @@ bool PeopleFinder::is_within_bound(Point node, int lower_x, int lower_y, int x_b
 }
 
 /**
- *  @desc searches through the training directory to get the file names of the images
+ *  @desc gets the full path of a directory inside the AutoSurvCV folder, using the
+ *  location of the executable
  *
- *  @param const string directory - training directory
+ *  @param const string directory - directory relative to the AutoSurvCV folder
  *
- *  @returns vector<string> - all the file names of the images
+ *  @returns string - the full path with forward slashes
  */
-vector<string> PeopleFinder::search_dataset_files(const string directory) //Function Credit: https://msdn.microsoft.com/en-us/library/windows/desktop/aa364418(v=vs.85).aspx
+string PeopleFinder::resolve_directory(const string directory)
 {
-	HANDLE hFind;
-	WIN32_FIND_DATA data;				//Credit: https://msdn.microsoft.com/en-us/library/windows/desktop/aa365740(v=vs.85).aspx
 	string workdirectory, tempstr;
-	vector<string> filenames(2000);
-	int i = 0;
 
 	char buffer[MAX_PATH];
 	GetModuleFileName(NULL, buffer, MAX_PATH);
@@ -886,6 +1349,24 @@ vector<string> PeopleFinder::search_dataset_files(const string directory) //Func
 	replace(tempstr.begin(), tempstr.end(), '\\', '/');
 
 	tempstr.append(directory);
+	return tempstr;
+}
+
+/**
+ *  @desc searches through the training directory to get the file names of the images
+ *
+ *  @param const string directory - training directory
+ *
+ *  @returns vector<string> - all the file names of the images
+ */
+vector<string> PeopleFinder::search_dataset_files(const string directory) //Function Credit: https://msdn.microsoft.com/en-us/library/windows/desktop/aa364418(v=vs.85).aspx
+{
+	HANDLE hFind;
+	WIN32_FIND_DATA data;				//Credit: https://msdn.microsoft.com/en-us/library/windows/desktop/aa365740(v=vs.85).aspx
+	string tempstr;
+	vector<string> filenames;
+
+	tempstr = resolve_directory(directory);
 	cout << tempstr << endl;
 	
 	hFind = FindFirstFile(tempstr.c_str(), &data);
@@ -894,8 +1375,7 @@ vector<string> PeopleFinder::search_dataset_files(const string directory) //Func
 		cout << "Saving file paths..." << endl;
 		do 
 		{
-			filenames[i] = data.cFileName;
-			i++;
+			filenames.push_back(data.cFileName);
 		} while (FindNextFile(hFind, &data));
 		FindClose(hFind);
 		cout << "File paths saved." << endl;
@@ -908,35 +1388,39 @@ vector<string> PeopleFinder::search_dataset_files(const string directory) //Func
 }
 
 /**
- *  @desc loads each image from the training directory
+ *  @desc loads an image from the training directory, converting it to greyscale and
+ *  resizing it to the 64x128 PeopleFinder size
  *
- *  @param vector<string> filenames - images to load
+ *  @param string filename - image to load
  *  @param const string directory - training directory
+ *  @param Mat *image - the loaded image
  *
- *  @returns vector<Mat> imgs - loaded images
+ *  @returns false if the file isn't an image
  */
-vector<Mat> PeopleFinder::load_dataset_files(vector<string> filenames, const string directory)
+bool PeopleFinder::load_dataset_file(string filename, const string directory, Mat *image)
 {
-	vector<Mat> imgs(2000);
-	Mat tempimg, resizeimg;
-	string directory_edit, fullpath;
-	int i = 0, j = 0;
+	Mat tempimg, greyimg;
+	string fullpath;
 
-	directory_edit = directory.substr(0, directory.find("*.*", 0));
-	cout << "Loading images from the file paths..." << endl;
-	while (!filenames[i].empty())
+	fullpath = directory.substr(0, directory.find("*.*", 0));
+	fullpath.append(filename);
+	tempimg = imread(fullpath);
+	if (tempimg.empty())
 	{
-		fullpath = directory_edit;
-		fullpath.append(filenames[i]);
-		tempimg = imread(fullpath);
-		if (!tempimg.empty())
-		{
-			cvtColor(tempimg, resizeimg, CV_BGRA2GRAY);
-			resize(resizeimg, imgs[j], Size(64, 128));
-			j++;
-		}
-		i++;
+		return false;
 	}
-	cout << "Images loaded." << endl;
-	return imgs;
+
+	cvtColor(tempimg, greyimg, CV_BGRA2GRAY);
+	resize(greyimg, *image, Size(SHAPE_CANVAS_COLS, SHAPE_CANVAS_ROWS));
+	return true;
 }
+
+/**
+ *  @desc Builds of the skeleton kernels. Add a block here to use another canvas size,
+ *  e.g. for ShapeCanvasGeometry<256, 128>, and grow SkeletonWorkspace to match.
+ */
+template const vector<Point>& PeopleFinder::create_skeleton<ShapeCanvas>(Mat *contoursonly, SkeletonWorkspace *workspace, bool *bad_flag);
+template void PeopleFinder::fill_shape<ShapeCanvas>(Mat *contoursonly, Point seed, Vec3b colour, Point *fill_stack);
+template Point PeopleFinder::find_torso_feature<ShapeCanvas>(const PixelRows &shape_pixels, int threshold, Point head_feature);
+template Point PeopleFinder::find_waist_feature<ShapeCanvas>(const PixelRows &shape_pixels, int threshold, Point torso_feature, bool *bad_flag);
+template Point PeopleFinder::find_foot_feature<ShapeCanvas>(const PixelRows &shape_pixels, int threshold, Point waist_feature, Point corner);
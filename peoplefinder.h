@@ -4,60 +4,158 @@
 
 #include <iostream>
 #include <stdio.h>
+#include <string.h>
 #include <windows.h>
 #include <string>
 #include <ctime>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
 #include <opencv2/highgui.hpp>
 #include <opencv2/video.hpp>
+#include <opencv2/core/hal/intrin.hpp>
 #include "blobdetector.h"
+#include "threadpool.h"
+#include "skeletonworkspace.h"
+#include "featuremodel.h"
+#include "skeletonbatch.h"
+#include "datasetcache.h"
 
 using namespace cv;
 using namespace std;
 
+#define MODEL_FILE_MAGIC "ASCVMDL"	//8 bytes including the terminator
+#define MODEL_FILE_VERSION 2		//increase whenever the model layout or the skeleton output changes
+#define CACHE_FILE_PREFIX "peoplefinder_"	//the model and dataset cache files kept in the training directory
+#define DATASET_COMPILE_WINDOW 256	//training images decoded at once while compiling the dataset
+
 class PeopleFinder
 {
 	private :
-		vector<Point> min_range;
-		vector<Point> max_range;
-		vector<string> verdicts;
+		FeatureModel model;		//min/max x/y of each feature from training
 		string training_path;
-		bool bad_skel_flag;
 
 	public :
-		PeopleFinder(vector<Point> min, vector<Point> max, string path, bool bad);
+		PeopleFinder(vector<Point> min, vector<Point> max, string path);
 		void init();
-		void train();
-		void train_compare_ranges(vector<Point> feature_nodes);
+		void train(ThreadPool *pool);
+		void train_or_load(ThreadPool *pool);
+		bool compile_dataset(ThreadPool *pool, bool with_skeletons);
+		string cache_file_path(unsigned long long dataset_hash, string extension);
+		bool save_model(string model_path, unsigned long long dataset_hash);
+		bool load_model(string model_path, unsigned long long dataset_hash);
+		unsigned long long hash_dataset_files(const string directory);
 		void demo();
-		void test(vector<Mat> *shapes);
-
-		string judge_features(vector<Point> nodes);
+		vector<Verdict> test(vector<Mat> *shapes, ThreadPool *pool);
+		vector<Verdict> test(vector<Mat> *shapes, ThreadPool *pool, int max_helpers, vector<int> *scores);
+		int build_skeletons(vector<Mat> *shapes, ThreadPool *pool, int max_helpers, SkeletonBatch *batch);
+		void score_batch(const SkeletonBatch &batch, vector<unsigned int> *masks);
 
-		vector<string> get_verdicts();
-		bool get_bad_flag();
+		Verdict judge_features(const vector<Point> &nodes);
+		int score_features(const vector<Point> &nodes);
+		unsigned int score_feature_mask(const vector<Point> &nodes);
+		Verdict judge_score(int feature_score);
 
-		vector<Point> create_skeleton(Mat * contoursonly);
+		//the skeleton kernels are built per canvas, see the instantiations at the end of peoplefinder.cpp
+		template<class Canvas = ShapeCanvas> const vector<Point>& create_skeleton(Mat * contoursonly, SkeletonWorkspace *workspace, bool *bad_flag);
+		static SkeletonWorkspace *get_thread_workspace();
+		template<class Canvas = ShapeCanvas> void fill_shape(Mat *contoursonly, Point seed, Vec3b colour, Point *fill_stack);
 
-		void highlight_pixels(Mat * contoursonly, vector<Point>* shape_pixels, vector<Point>* outline_pixels);
+		template<class Canvas = ShapeCanvas> void highlight_pixels(Mat * contoursonly, PixelRows *shape_pixels, PixelRows *outline_pixels);	//defined below the class, so it builds for any canvas
 
-		Point find_head_feature(vector<Point> shape_pixels, int threshold, int *index_head);
-		Point find_torso_feature(vector<Point> shape_pixels, int threshold, Point head_feature, int index_head, int *index_torso);
-		Point find_waist_feature(vector<Point> shape_pixels, int threshold, Point torso_feature, int index_torso, int *index_waist);
-		Point find_foot_feature(vector<Point> shape_pixels, int threshold, Point waist_feature, Point corner, int index_waist);
+		Point find_head_feature(const PixelRows &shape_pixels, int threshold);
+		template<class Canvas = ShapeCanvas> Point find_torso_feature(const PixelRows &shape_pixels, int threshold, Point head_feature);
+		template<class Canvas = ShapeCanvas> Point find_waist_feature(const PixelRows &shape_pixels, int threshold, Point torso_feature, bool *bad_flag);
+		template<class Canvas = ShapeCanvas> Point find_foot_feature(const PixelRows &shape_pixels, int threshold, Point waist_feature, Point corner);
+		int find_widest_run(const PixelRows &shape_pixels, int first_row, int end_row, Point *best_fit_node);
 
-		void set_shoulder_positions(vector<Point> shape_pixels, int threshold, Point torso_feature, Point * left_shoulder, Point * right_shoulder, int *arm_width, int index_torso, int *index_shoulders);
+		void set_shoulder_positions(const PixelRows &shape_pixels, int threshold, Point torso_feature, Point * left_shoulder, Point * right_shoulder, int *arm_width);
 		void calc_halfway_torso_dist(Point torso_feature, Point waist_feature, Point * halfway_node, double * halfway_dist);
 
-		Point find_elbow_feature(vector<Point> shape_pixels, Point torso_feature, Point waist_feature, Point shoulder_feature, int *arm_width, double halfway_dist, Point halfway_node, int index_shoulders);
-		Point find_hand_feature(vector<Point> shape_pixels, vector<Point> outline_pixels, Point waist_feature, Point elbow_feature, int *arm_width, double halfway_dist, Point halfway_node, Mat *contours, int index_shoulders);
-		Point find_closest_pixel(vector<Point> shape_pixels, Point goal_node, int x_bound, int n);
+		Point find_elbow_feature(const PixelRows &shape_pixels, Point torso_feature, Point waist_feature, Point shoulder_feature, int *arm_width, double halfway_dist, Point halfway_node, bool *bad_flag);
+		Point find_hand_feature(const PixelRows &shape_pixels, const PixelRows &outline_pixels, Point waist_feature, Point elbow_feature, int *arm_width, double halfway_dist, Point halfway_node, Mat *contours, bool *bad_flag);
+		Point find_closest_pixel(const PixelRows &shape_pixels, Point goal_node, int x_bound, int first_row);
 
-		void draw_skeleton(Mat *image, vector<Point> nodes);
+		void draw_skeleton(Mat *image, const vector<Point> &nodes, bool *bad_flag);
 
 		bool is_within_bound(Point node, int lower_x, int lower_y, int x_bound, int y_bound);
 
+		string resolve_directory(const string directory);
 		vector<string> search_dataset_files(const string directory);
-		vector<Mat> load_dataset_files(vector<string> filenames, const string directory);
+		bool load_dataset_file(string filename, const string directory, Mat *image);
 };
 
+/**
+ *  @desc saves the x/y positions of the pixels within and on the outline of the shape,
+ *  row by row, so the feature searches can go straight to the rows they need. Blocks of
+ *  16 pixels are compared at once with OpenCV's SIMD types where the build supports them,
+ *  the rest of each row is checked a pixel at a time. The row and column counts come
+ *  from the canvas, so the 64 column canvas is exactly four SIMD blocks with no tail.
+ *  A Mat that isn't one canvas in size leaves both lists empty.
+ *
+ *  @param Canvas - the ShapeCanvasGeometry the shape was drawn on
+ *  @param Mat *contoursonly - the contours of the shape, one canvas in size
+ *  @param PixelRows *shape_pixels - x/y positions within the shape
+ *  @param PixelRows *outline_pixels - x/y positions in the outline of the shape
+ */
+template<class Canvas>
+void PeopleFinder::highlight_pixels(Mat *contoursonly, PixelRows *shape_pixels, PixelRows *outline_pixels)
+{
+	int i, j;
+	const uchar *row_ptr;
+
+	if (contoursonly->rows != Canvas::rows || contoursonly->cols != Canvas::cols || contoursonly->type() != CV_8UC3)
+	{
+		shape_pixels->reset(0, 0);
+		outline_pixels->reset(0, 0);
+		shape_pixels->finish();
+		outline_pixels->finish();
+		return;
+	}
+
+	shape_pixels->reset(Canvas::rows, Canvas::cols);
+	outline_pixels->reset(Canvas::rows, Canvas::cols);
+
+#if CV_SIMD128
+	v_uint8x16 blue, green, red;
+	v_uint8x16 v_zero = v_setall_u8(0);
+	v_uint8x16 v_fill = v_setall_u8(64);		//Vec3b(64, 0, 0)
+	v_uint8x16 v_outline = v_setall_u8(255);	//Vec3b(0, 0, 255)
+#endif
+
+	for (i = 0; i < Canvas::rows; i++)
+	{
+		row_ptr = contoursonly->ptr<uchar>(i);
+		shape_pixels->begin_row(i);
+		outline_pixels->begin_row(i);
+		j = 0;
+
+#if CV_SIMD128
+		for (; j <= Canvas::cols - 16; j += 16)
+		{
+			v_load_deinterleave(row_ptr + j * 3, blue, green, red);
+			shape_pixels->add_pixel_mask(i, j, v_signmask((blue == v_fill) & (green == v_zero) & (red == v_zero)));
+			outline_pixels->add_pixel_mask(i, j, v_signmask((blue == v_zero) & (green == v_zero) & (red == v_outline)));
+		}
+#endif
+
+		for (; j < Canvas::cols; j++)
+		{
+			if (row_ptr[j * 3] == 64 && row_ptr[j * 3 + 1] == 0 && row_ptr[j * 3 + 2] == 0)
+			{
+				shape_pixels->add_pixel(i, j);
+			}
+			if (row_ptr[j * 3] == 0 && row_ptr[j * 3 + 1] == 0 && row_ptr[j * 3 + 2] == 255)
+			{
+				outline_pixels->add_pixel(i, j);
+			}
+		}
+	}
+
+	shape_pixels->finish();
+	outline_pixels->finish();
+}
+
 #endif
@@ -0,0 +1,182 @@
+#include "pixelrows.h"
+
+/**
+ *	@file pixelrows.cpp
+ *  @desc Builds and searches the row indexed pixel lists used by the PeopleFinder. The
+ *  lists are filled one row at a time with begin_row()/add_pixel(), in increasing
+ *  column order, and closed with finish().
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+PixelRows::PixelRows(int r, int c)
+	: rows(0), cols(0), count(0), run_count(0)
+{
+	reset(r, c);
+}
+
+/**
+ *  @desc Empties the lists for an image of the given size. Memory is only allocated when
+ *  the image is larger than any seen before, so the lists can be reused per shape.
+ *
+ *  @param int r - number of rows in the image
+ *  @param int c - number of columns in the image
+ */
+void PixelRows::reset(int r, int c)
+{
+	if (pixels.size() < r * c)
+	{
+		pixels.resize(r * c);
+	}
+	if (runs.size() < r * ((c + 1) / 2))	//the most runs a row can hold is every other pixel
+	{
+		runs.resize(r * ((c + 1) / 2));
+	}
+	if (row_start.size() < r + 1)
+	{
+		row_start.resize(r + 1);
+		row_run_start.resize(r + 1);
+	}
+
+	rows = r;
+	cols = c;
+	count = 0;
+	run_count = 0;
+	row_start[0] = 0;
+	row_run_start[0] = 0;
+}
+
+/**
+ *  @desc Starts the next row, rows must be started in order from 0
+ */
+void PixelRows::begin_row(int row)
+{
+	row_start[row] = count;
+	row_run_start[row] = run_count;
+}
+
+/**
+ *  @desc Adds a pixel to the current row, extending the last run if it is the next column
+ *
+ *  @param int row - the current row
+ *  @param int col - column of the pixel, must be greater than the last one added
+ */
+void PixelRows::add_pixel(int row, int col)
+{
+	if (run_count > row_run_start[row] && runs[run_count - 1].end_col == col - 1)
+	{
+		runs[run_count - 1].end_col = col;
+	}
+	else
+	{
+		runs[run_count].row = row;
+		runs[run_count].start_col = col;
+		runs[run_count].end_col = col;
+		runs[run_count].first_index = count;
+		run_count++;
+	}
+	pixels[count] = Point(row, col);
+	count++;
+}
+
+/**
+ *  @desc Adds up to 16 pixels of the current row from a bit mask, bit n set means the
+ *  pixel at col + n belongs in the lists. A full mask extends the runs in one step.
+ *
+ *  @param int row - the current row
+ *  @param int col - column of the first pixel in the mask
+ *  @param int mask - one bit per pixel, lowest bit first
+ */
+void PixelRows::add_pixel_mask(int row, int col, int mask)
+{
+	int n;
+
+	if (mask == 0)
+	{
+		return;
+	}
+
+	if (mask == 0xFFFF)
+	{
+		if (run_count > row_run_start[row] && runs[run_count - 1].end_col == col - 1)
+		{
+			runs[run_count - 1].end_col = col + 15;
+		}
+		else
+		{
+			runs[run_count].row = row;
+			runs[run_count].start_col = col;
+			runs[run_count].end_col = col + 15;
+			runs[run_count].first_index = count;
+			run_count++;
+		}
+		for (n = 0; n < 16; n++)
+		{
+			pixels[count + n] = Point(row, col + n);
+		}
+		count += 16;
+		return;
+	}
+
+	for (n = 0; n < 16; n++)
+	{
+		if (mask & (1 << n))
+		{
+			add_pixel(row, col + n);
+		}
+	}
+}
+
+/**
+ *  @desc Closes the lists after the last row has been added
+ */
+void PixelRows::finish()
+{
+	row_start[rows] = count;
+	row_run_start[rows] = run_count;
+}
+
+/**
+ *  @desc Finds the first row at or below from_row that holds any pixels
+ *
+ *  @param int from_row - row to start from
+ *
+ *  @returns int - the row, or rows if there are none
+ */
+int PixelRows::first_row(int from_row) const
+{
+	int row = from_row < 0 ? 0 : from_row;
+
+	while (row < rows && row_size(row) == 0)
+	{
+		row++;
+	}
+	return row < rows ? row : rows;
+}
+
+/**
+ *  @desc Checks whether the given position is one of the pixels
+ *
+ *  @param int row - row of the position
+ *  @param int col - column of the position
+ *
+ *  @returns true if the pixel is in the lists
+ */
+bool PixelRows::contains(int row, int col) const
+{
+	int i;
+
+	if (row < 0 || row >= rows)
+	{
+		return false;
+	}
+	for (i = run_begin(row); i < run_end(row); i++)
+	{
+		if (col >= runs[i].start_col && col <= runs[i].end_col)
+		{
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,65 @@
+#ifndef PIXELROWS_H
+#define PIXELROWS_H
+
+#include <vector>
+#include "opencv2/core.hpp"
+
+using namespace std;
+using namespace cv;
+
+/**
+ *  @desc One horizontal run of consecutive pixels in a row. Columns are inclusive,
+ *  first_index is the position of the run's first pixel in PixelRows::pixels.
+ */
+struct PixelRun
+{
+	int row;
+	int start_col;
+	int end_col;
+	int first_index;
+};
+
+/**
+ *	@file pixelrows.h
+ *  @desc The pixels of a shape stored row by row. Pixels are kept in raster order as
+ *  x = row, y = column (the PeopleFinder convention) with the index of the first pixel of
+ *  each row, and the same pixels are also grouped into horizontal runs. This lets the
+ *  feature searches go straight to a row and measure widths per run rather than walking
+ *  the whole pixel list. The number of pixels is stored explicitly, so there is no end
+ *  marker and a pixel at (0, 0) is as valid as any other.
+ *
+ *  @param int rows - number of rows in the image
+ *  @param int cols - number of columns in the image
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class PixelRows
+{
+	public:
+		vector<Point> pixels;
+		vector<int> row_start;			//index of the first pixel of each row, row_start[rows] == count
+		vector<PixelRun> runs;
+		vector<int> row_run_start;		//index of the first run of each row, row_run_start[rows] == run_count
+		int rows;
+		int cols;
+		int count;
+		int run_count;
+
+		PixelRows(int r, int c);
+		void reset(int r, int c);
+		void begin_row(int row);
+		void add_pixel(int row, int col);
+		void add_pixel_mask(int row, int col, int mask);
+		void finish();
+		int first_row(int from_row) const;
+		bool contains(int row, int col) const;
+
+		int row_begin(int row) const { return row_start[row]; }
+		int row_end(int row) const { return row_start[row + 1]; }
+		int row_size(int row) const { return row_start[row + 1] - row_start[row]; }
+		int run_begin(int row) const { return row_run_start[row]; }
+		int run_end(int row) const { return row_run_start[row + 1]; }
+};
+
+#endif
@@ -2,38 +2,277 @@
 
 /**
 *	@file recordlog.cpp
-*   @desc Creates/maintains a HTML file to store information on the pedestrians detected in 
-*   a table format.
+*   @desc Records the shapes classified during a run in a DetectionStore within the
+*   record_log directory, and can present them as a HTML table.
 *
-*   @param ofstream file - the output file stream
+*   @param DetectionStore store - the binary records of this run
 *	@param string current_date - for naming files
+*	@param string log_name - date and time of the run followed by the stream tag, names every file
 *   @param int total_records - for naming files
+*   @param bool html_view - write the HTML table when the log is closed
+*   @param StreamMetrics *metrics - given the writer's times and the queue depth, may be NULL
+*
+*   Records are written by a separate thread so encoding the images doesn't hold up the
+*   video. new_record() only queues the record, and if the writer falls LOG_QUEUE_SIZE
+*   records behind new records are dropped and counted instead of waiting.
 *
 *	@author Alex O'Donnell
-*	@version 1.3
+*	@version 1.5
+*/
+
+RecordLog::RecordLog()
+	: total_records(0), html_view(true), image_format(LOG_IMAGE_PNG), image_level(1), queue(LOG_QUEUE_SIZE), writing(false),
+	written_records(0), dropped_records(0), metrics(NULL), t_write(-1)
+{}
+
+RecordLog::~RecordLog()
+{
+	if (writing)
+	{
+		close_log();
+	}
+}
+
+/**
+*  @desc Chooses how the record images are encoded, call before init_log().
+*
+*  @param LogImageFormat format - PNG, JPEG or RAW (uncompressed bitmap)
+*  @param int level - PNG compression 0-9 or JPEG quality 0-100, ignored for RAW
+*/
+void RecordLog::set_image_format(LogImageFormat format, int level)
+{
+	image_format = format;
+	image_level = level;
+}
+
+/**
+*  @desc Chooses whether close_log() writes the HTML table for the run. The binary
+*  records are always written, and the table can be made from them later.
 */
+void RecordLog::set_html_view(bool enabled)
+{
+	html_view = enabled;
+}
+
+/**
+*  @desc Reports the writer's time per record, the queue depth and the written and
+*  dropped records to a stream's live figures. Call before init_log().
+*
+*  @param StreamMetrics *stream_metrics - the stream's figures, must outlive the log
+*/
+void RecordLog::set_metrics(StreamMetrics *stream_metrics)
+{
+	metrics = stream_metrics;
+	t_write = metrics != NULL ? metrics->add_stage("Log Writer") : -1;
+}
 
 /**
-*  @desc Initialises a HTML file within the record_log directory, setting up the page
-*  style and the table.
+*  @desc Creates the detection store for a new run within the record_log directory and
+*  starts the writer thread. Every run gets its own files, named after the date and
+*  time it started.
 *
-*  @param string videoPath - displays the path of the video file on the page
+*  @param string videoPath - path of the video file, kept in the store
 *  @param int bgs_history - history length used for the video
 *  @param double bgs_threshold - dist2threshold used for the video
+*  @param string stream_tag - added to the file names so each stream has its own log, may be empty
 */
-void RecordLog::init_log(string videoPath, int bgs_history, double bgs_threshold)
+void RecordLog::init_log(string videoPath, int bgs_history, double bgs_threshold, string stream_tag)
 {
-	stringstream ss;
-	string path;
-	
-
-	path = "record_log/";
 	current_date = get_date();
-	ss << current_date;
-	ss << ".html";
-	path.append(ss.str());
+	log_name = get_run_name(stream_tag);
+	total_records = 0;
+	written_records = 0;
+	dropped_records = 0;
+
+	if (!store.open_for_writing("record_log/" + log_name, videoPath, bgs_history, bgs_threshold))
+	{
+		cout << "Couldn't create the record log record_log/" << log_name << endl;
+	}
+
+	queue.reopen();
+	writing = true;
+	writer = thread(&RecordLog::write_records, this);
+}
+
+/**
+*  @desc Queues a new record for the writer thread. An image that is a region of a
+*  larger one, like a shape cut from the frame, is copied so the queued record doesn't
+*  keep the whole frame alive. Other images are not copied, so the caller must not
+*  draw on them afterwards.
+*
+*  @param int frame_num - number of frames into the video
+*  @param int mill_seconds - the timestamp of the video
+*  @param const Mat &src_image - the source of the large shape
+*  @param const Mat &contour_image - the PeopleFinder interpretation
+*  @param Verdict verdict - the classification
+*  @param Rect box - position of the shape in the frame
+*  @param int feature_score - number of features inside the trained ranges
+*  @param int track_id - ShapeTracker ID of the shape
+*  @param int clip_number - ClipRecorder clip of the event, 0 without one
+*
+*  @returns false if the writer is too far behind and the record was dropped
+*/
+bool RecordLog::new_record(int frame_num, int mill_seconds, const Mat &src_image, const Mat &contour_image, Verdict verdict, Rect box, int feature_score, int track_id, int clip_number)
+{
+	LogRecord record;
+
+	record.record_number = total_records + 1;
+	record.frame_num = frame_num;
+	record.mill_seconds = mill_seconds;
+	record.box = box;
+	record.feature_score = feature_score;
+	record.track_id = track_id;
+	record.clip_number = clip_number;
+	record.src_image = src_image.isSubmatrix() ? src_image.clone() : src_image;	//only the crop waits in the queue
+	record.contour_image = contour_image.isSubmatrix() ? contour_image.clone() : contour_image;
+	record.verdict = verdict;
+
+	if (!queue.try_push(move(record)))
+	{
+		dropped_records++;
+		if (metrics != NULL)
+		{
+			metrics->add(COUNTER_LOG_DROPPED, 1);
+		}
+		return false;
+	}
+	if (metrics != NULL)
+	{
+		metrics->set(GAUGE_LOG_QUEUE, (long long)queue.size());
+	}
+
+	total_records++;
+	return true;
+}
+
+/**
+*  @desc Writer thread, encodes the images of the queued records and appends them to
+*  the store. Whatever is waiting is taken as one batch (up to LOG_BATCH_SIZE records)
+*  and the store is flushed once per batch. Runs until close_log() closes the queue.
+*/
+void RecordLog::write_records()
+{
+	vector<LogRecord> batch;
+	LogRecord record;
+	DetectionRecord entry;
+	vector<uchar> src_encoded, contour_encoded;
+	int64 start_ticks;
+	int i;
+
+	batch.reserve(LOG_BATCH_SIZE);
+
+	while (queue.pop(&record))
+	{
+		batch.clear();
+		batch.push_back(move(record));
+		while (batch.size() < LOG_BATCH_SIZE && queue.try_pop(&record))
+		{
+			batch.push_back(move(record));
+		}
+
+		for (i = 0; i < batch.size(); i++)
+		{
+			start_ticks = getTickCount();
+			encode_image(batch[i].src_image, &src_encoded);
+			encode_image(batch[i].contour_image, &contour_encoded);
+
+			memset(&entry, 0, sizeof(entry));
+			entry.frame_num = batch[i].frame_num;
+			entry.mill_seconds = batch[i].mill_seconds;
+			entry.box_x = batch[i].box.x;
+			entry.box_y = batch[i].box.y;
+			entry.box_width = batch[i].box.width;
+			entry.box_height = batch[i].box.height;
+			entry.verdict = batch[i].verdict;
+			entry.feature_score = batch[i].feature_score;
+			entry.track_id = batch[i].track_id;
+			entry.clip_number = batch[i].clip_number;
+			entry.image_format = image_format;
+			store.append(entry, src_encoded, contour_encoded);
+			if (metrics != NULL)
+			{
+				metrics->observe(t_write, getTickCount() - start_ticks);
+			}
+		}
+
+		store.flush();
+		written_records += (int)batch.size();
+		if (metrics != NULL)
+		{
+			metrics->add(COUNTER_LOG_WRITTEN, (long long)batch.size());
+			metrics->set(GAUGE_LOG_QUEUE, (long long)queue.size());
+		}
+	}
+}
+
+/**
+*  @desc Encodes an image in the chosen format
+*
+*  @param const Mat &image - the image to encode
+*  @param vector<uchar> *encoded - the encoded bytes, empty if the image is
+*/
+void RecordLog::encode_image(const Mat &image, vector<uchar> *encoded)
+{
+	vector<int> params;
+
+	encoded->clear();
+	if (image.empty())
+	{
+		return;
+	}
 
-	file.open(path);
+	switch (image_format)
+	{
+		case LOG_IMAGE_JPEG:
+			params.push_back(CV_IMWRITE_JPEG_QUALITY);
+			params.push_back(image_level);
+			imencode(".jpg", image, *encoded, params);
+			break;
+		case LOG_IMAGE_RAW:
+			imencode(".bmp", image, *encoded);
+			break;
+		default:
+			params.push_back(CV_IMWRITE_PNG_COMPRESSION);
+			params.push_back(image_level);
+			imencode(".png", image, *encoded, params);
+			break;
+	}
+}
+
+/**
+*  @desc Writes the records of a run between two video timestamps as a HTML table,
+*  next to the store as <base>.html. The images are saved alongside it so the page
+*  can display them, and records with a clip link to it. The first record is found
+*  through the store's index.
+*
+*  @param string base_path - path of the store files without the extensions
+*  @param int start_ms - first video timestamp to include
+*  @param int end_ms - last video timestamp to include
+*
+*  @returns false if the store couldn't be read or the page couldn't be written
+*/
+bool RecordLog::write_html_view(string base_path, int start_ms, int end_ms)
+{
+	DetectionStore reader;
+	DetectionRecord record;
+	ofstream file;
+	string src_image_path, con_image_path, base_name;
+	size_t slash = base_path.find_last_of("/\\");
+	int hours, mins, secs;
+	unsigned int n;
+
+	if (!reader.open_for_reading(base_path))
+	{
+		return false;
+	}
+
+	file.open(base_path + ".html");
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	base_name = slash == string::npos ? base_path : base_path.substr(slash + 1);	//the clips are next to the table
 	file << "<html>\n";
 	file << "<style>\n";
 	file << "body {\n background-color: #ffeecc;\n}\n";
@@ -41,52 +280,44 @@ void RecordLog::init_log(string videoPath, int bgs_history, double bgs_threshold
 	file << "table, tr, th, td {\n border: 1px solid black;  border-collapse: collapse;\n}\n";
 	file << "</style>\n";
 	file << "<body>\n";
-	file << "<p>Source file: " << videoPath << "</p>\n";
-	file << "<p>BGS History Length: " << bgs_history << "</p>\n";
-	file << "<p>Distance to Threshold: " << bgs_threshold << "</p>\n";
+	file << "<p>Source file: " << reader.get_video_path() << "</p>\n";
+	file << "<p>BGS History Length: " << reader.get_bgs_history() << "</p>\n";
+	file << "<p>Distance to Threshold: " << reader.get_bgs_threshold() << "</p>\n";
 	file << "<table>\n";
 	file << "<tr>\n" << "<th>Frame Number</th>\n"
 		"<th>Timestamp</th>\n" <<
+		"<th>Track</th>\n" <<
 		"<th>Source</th>\n" <<
 		"<th>Analysis</th>\n" << 
-		"<th>Interpretation</th>\n" << "</tr>\n";
-	
-}
-
-/**
-*  @desc Creates a new table row and enters information into the log.
-*
-*  @param int frame_num - number of frames into the video
-*  @param int mill_seconds - the timestamp of the video
-*  @param Mat src_image - the source of the large shape
-*  @param Mat contour_image - the PeopleFinder interpretation
-*  @param string verdict - the classification
-*/
-void RecordLog::new_record(int frame_num, int mill_seconds, Mat src_image, Mat contour_image, string verdict)
-{
-	int hours, mins, secs;
-	string timestamp, src_image_path, con_image_path;
-	stringstream ss;
+		"<th>Interpretation</th>\n" <<
+		"<th>Clip</th>\n" << "</tr>\n";
 
-	convert_milliseconds(mill_seconds, &hours, &mins, &secs);
+	for (n = reader.find_by_time(start_ms); reader.read_record(n, &record) && record.mill_seconds <= end_ms; n++)
+	{
+		convert_milliseconds(record.mill_seconds, &hours, &mins, &secs);
 
-	total_records++;
+		src_image_path = save_image(base_path, "_SRC_IMAGE_", n + 1, record.image_format, reader.read_image(record.src_offset, record.src_size));
+		con_image_path = save_image(base_path, "_CNTR_IMAGE_", n + 1, record.image_format, reader.read_image(record.contour_offset, record.contour_size));
 
-	ss << setw(2) << setfill('0') << hours;
-	ss << ":";
-	ss << setw(2) << setfill('0') << mins;
-	ss << ":";
-	ss << setw(2) << setfill('0') << secs;
-	timestamp.append(ss.str());
+		file << "<tr>\n" << "<td>" << record.frame_num << "</td>" <<
+			"<td>" << setw(2) << setfill('0') << hours << ":" << setw(2) << setfill('0') << mins << ":" << setw(2) << setfill('0') << secs << "</td>\n" <<
+			"<td>" << record.track_id << "</td>\n" <<
+			"<td><img src = \"" << src_image_path << "\"></td>\n" <<
+			"<td><img src = \"" << con_image_path << "\"></td>\n" <<
+			"<td>" << DetectionStore::verdict_name(record.verdict) << "</td>\n" <<
+			"<td>";
+		if (record.clip_number != 0)
+		{
+			file << "<a href = \"" << ClipRecorder::clip_path(base_name, record.clip_number) << "\">Clip " << record.clip_number << "</a>";
+		}
+		file << "</td>\n" << "</tr>\n";
+	}
 
-	src_image_path = save_image("_SRC_IMAGE_", &src_image);
-	con_image_path = save_image("_CNTR_IMAGE_", &contour_image);
+	file << "</table>\n";
+	file << "</body>\n";
+	file << "</html>";
 
-	file << "<tr>\n" <<  "<td>" << frame_num << "</td>" <<
-		"<td>" << timestamp << "</td>\n" << 
-		"<td><img src = \"" << src_image_path << "\"></td>\n" << 
-		"<td><img src = \"" << con_image_path << "\"></td>\n" <<
-		"<td>" << verdict << "</td>\n" << "</tr>\n";
+	return file.good();
 }
 
 /**
@@ -114,24 +345,83 @@ string RecordLog::get_date()
 }
 
 /**
-*  @desc Saves the image so it can be displayed in the HTML table.
+*  @desc Names the files of a new run after the current date and time. If a run with
+*  the same name is already in the record_log directory a number is added, so a log is
+*  never overwritten.
 *
+*  @param string stream_tag - added after the time, may be empty
+*
+*  @returns string run_name - e.g. 2017_5_7_142501_cam1
+*/
+string RecordLog::get_run_name(string stream_tag)
+{
+	string base_name, run_name;
+	stringstream ss;
+	time_t now;
+	time(&now);
+	struct tm current_time;
+	localtime_s(&current_time, &now);
+	int attempt = 1;
+
+	ss << get_date() << "_" << setw(2) << setfill('0') << current_time.tm_hour <<
+		setw(2) << setfill('0') << current_time.tm_min << setw(2) << setfill('0') << current_time.tm_sec << stream_tag;
+	base_name = ss.str();
+	run_name = base_name;
+
+	while (ifstream("record_log/" + run_name + ".det").good())
+	{
+		attempt++;
+		ss.str("");
+		ss << base_name << "-" << attempt;
+		run_name = ss.str();
+	}
+
+	return run_name;
+}
+
+string RecordLog::get_log_name()
+{
+	return log_name;
+}
+
+/**
+*  @desc Saves an image from the store so it can be displayed in the HTML table.
+*
+*  @param string base_path - path of the store files, the image is saved next to them
 *  @param string type_name - whether the image is a source image or PeopleFinder interpretation
-*  @param Mat *image - the image to be saved
+*  @param int record_number - number of the record the image belongs to
+*  @param int format - LogImageFormat the image was stored in, picks the file extension
+*  @param const Mat &image - the image to be saved
 *
 *  @returns image_path - path for the table record so it can display the image
 */
-string RecordLog::save_image(string type_name, Mat *image)
+string RecordLog::save_image(string base_path, string type_name, int record_number, int format, const Mat &image)
 {
 	string image_path;
 	stringstream ss;
+	size_t slash = base_path.find_last_of("/\\");
 
-	ss << current_date;
+	ss << (slash == string::npos ? base_path : base_path.substr(slash + 1));
 	ss << type_name;
-	ss << total_records;
-	ss << ".png";
+	ss << record_number;
+	switch (format)
+	{
+		case LOG_IMAGE_JPEG:
+			ss << ".jpg";
+			break;
+		case LOG_IMAGE_RAW:
+			ss << ".bmp";
+			break;
+		default:
+			ss << ".png";
+			break;
+	}
 	image_path.append(ss.str());
-	imwrite("record_log/" + image_path, *image);
+
+	if (!image.empty())
+	{
+		imwrite((slash == string::npos ? string("") : base_path.substr(0, slash + 1)) + image_path, image);
+	}
 
 	return image_path;
 }
@@ -143,11 +433,32 @@ void RecordLog::convert_milliseconds(int mill_seconds, int *hh, int *mm, int *ss
 	*hh = (int)((mill_seconds / (1000 * 60 * 60)) % 24);
 }
 
+int RecordLog::get_written_records()
+{
+	return written_records;
+}
+
+int RecordLog::get_dropped_records()
+{
+	return dropped_records;
+}
+
+/**
+*  @desc Waits for the writer to finish the queued records and closes the store, then
+*  writes the HTML table for the run if it is wanted.
+*/
 void RecordLog::close_log()
 {
-	file << "</table>\n";
-	file << "</body>\n";
-	file << "</html>";
+	if (writing)
+	{
+		queue.close();
+		writer.join();
+		writing = false;
+	}
+	store.close();
 
-	file.close();
+	if (html_view && !log_name.empty())
+	{
+		write_html_view("record_log/" + log_name, 0, INT_MAX);
+	}
 }
@@ -8,31 +8,105 @@
 #include <stdio.h>
 #include <string>
 #include <ctime>
+#include <climits>
+#include <thread>
+#include <atomic>
 #include "opencv2/imgcodecs.hpp"
 #include "opencv2/imgproc.hpp"
 #include "opencv2/videoio.hpp"
+#include "boundedqueue.h"
+#include "detectionstore.h"
+#include "featuremodel.h"
+#include "streammetrics.h"
+#include "cliprecorder.h"
 
 using namespace std;
 using namespace cv;
 
+#define LOG_QUEUE_SIZE 64		//records waiting for the writer before new ones are dropped
+#define LOG_BATCH_SIZE 16		//most records written between flushes
+
+/**
+ *  @desc How the record images are saved. RAW is an uncompressed bitmap.
+ */
+enum LogImageFormat
+{
+	LOG_IMAGE_PNG,
+	LOG_IMAGE_JPEG,
+	LOG_IMAGE_RAW
+};
+
+/**
+ *  @desc One record waiting to be written. The images share their pixels with the
+ *  frame they came from rather than being copied.
+ */
+struct LogRecord
+{
+	int record_number;
+	int frame_num;
+	int mill_seconds;
+	Rect box;
+	int feature_score;
+	int track_id;
+	int clip_number;
+	Mat src_image;
+	Mat contour_image;
+	Verdict verdict;
+};
+
 class RecordLog
 {
 	private:
-		ofstream file;
+		DetectionStore store;
 		string current_date;
+		string log_name;
 		int total_records;
+		bool html_view;
+
+		LogImageFormat image_format;
+		int image_level;
+		BoundedQueue<LogRecord> queue;
+		thread writer;
+		bool writing;
+		atomic<int> written_records;
+		atomic<int> dropped_records;
+		StreamMetrics *metrics;		//live figures of the stream, may be NULL
+		int t_write;				//the writer's stage in the metrics
+
+		void write_records();
 
 	public:
-		void init_log(string videoPath, int bgs_history, double bgs_threshold);
+		RecordLog();
+		~RecordLog();
+
+		void set_image_format(LogImageFormat format, int level);
 
-		void new_record(int frame_num, int mill_seconds, Mat src_image, Mat contour_image, string verdict);
+		void set_html_view(bool enabled);
+
+		void set_metrics(StreamMetrics *stream_metrics);
+
+		void init_log(string videoPath, int bgs_history, double bgs_threshold, string stream_tag);
+
+		bool new_record(int frame_num, int mill_seconds, const Mat &src_image, const Mat &contour_image, Verdict verdict, Rect box, int feature_score, int track_id, int clip_number);
 
 		string get_date();
 
-		string save_image(string type_name, Mat * image);
+		string get_run_name(string stream_tag);
+
+		string get_log_name();
+
+		void encode_image(const Mat &image, vector<uchar> *encoded);
+
+		bool write_html_view(string base_path, int start_ms, int end_ms);
+
+		string save_image(string base_path, string type_name, int record_number, int format, const Mat &image);
 
 		void convert_milliseconds(int mill_seconds, int * hh, int * mm, int * ss);
 
+		int get_written_records();
+
+		int get_dropped_records();
+
 		void close_log();
 	
 };
@@ -0,0 +1,328 @@
+#include "segmentrunner.h"
+
+/**
+ *	@file segmentrunner.cpp
+ *  @desc A background model depends on every frame before it, so one video can't be
+ *  split between threads frame by frame. It can be split into long segments though:
+ *  a model primed with the last warmup_frames of the previous segment gives nearly the
+ *  same masks as one that saw the whole video, as the KNN history only reaches
+ *  bgs_history frames back. Each segment pays for its warm-up once, so with segments
+ *  much longer than the warm-up the throughput grows with the number of cores.
+ *
+ *  The segments are analysed with a BGS each, limited to its frames with
+ *  BGS::set_frame_range(), and every segment writes its own record log. The segments
+ *  are consecutive and each log is in frame order, so the merged log is their logs
+ *  one after another. Every segment has its own ShapeTracker, so the track IDs of
+ *  later segments are moved past those of the earlier ones, and a shape in view across
+ *  the boundary of two segments is logged by both, as when a track is lost and found.
+ *  The clips are numbered per segment too, so they are renamed after the merged log and
+ *  renumbered past the clips of the earlier segments.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+SegmentRunner::SegmentRunner(string t_path, string v_path, int history, double thresh)
+	: pf(vector<Point>(11), vector<Point>(11), t_path), pool(0), video_path(v_path), bgs_history(history), bgs_threshold(thresh),
+	segment_count(0), warmup_frames(-1), log_format(LOG_IMAGE_PNG), log_level(1), schedule_profile(SCHEDULE_BALANCED), bgs_scale(1),
+	accel_mode(ACCEL_CPU), background_engine(BACKGROUND_KNN), blob_engine(BLOB_CONTOURS), clip_before(0), clip_after(0)
+{}
+
+/**
+ *  @desc Chooses how many segments the video is split into
+ *
+ *  @param int segments - segments to run at once, 0 for one per core
+ */
+void SegmentRunner::set_segment_count(int segments)
+{
+	segment_count = segments;
+}
+
+/**
+ *  @desc Chooses how many frames before its start each segment primes its models with
+ *
+ *  @param int frames - warm-up frames, -1 for the BGS history length
+ */
+void SegmentRunner::set_warmup_frames(int frames)
+{
+	warmup_frames = frames;
+}
+
+/**
+ *  @desc Chooses how the record images are saved
+ *
+ *  @param LogImageFormat format - PNG, JPEG or RAW
+ *  @param int level - PNG compression 0-9 or JPEG quality 0-100
+ */
+void SegmentRunner::set_log_format(LogImageFormat format, int level)
+{
+	log_format = format;
+	log_level = level;
+}
+
+void SegmentRunner::set_schedule_profile(ScheduleProfile profile)
+{
+	schedule_profile = profile;
+}
+
+void SegmentRunner::set_capture(const CaptureSettings &settings)
+{
+	capture_settings = settings;
+}
+
+void SegmentRunner::set_bgs_scale(int scale)
+{
+	bgs_scale = scale;
+}
+
+void SegmentRunner::set_accel_mode(AccelMode mode)
+{
+	accel_mode = mode;
+}
+
+void SegmentRunner::set_background_engine(BackgroundEngine engine)
+{
+	background_engine = engine;
+}
+
+void SegmentRunner::set_blob_engine(BlobEngine engine)
+{
+	blob_engine = engine;
+}
+
+/**
+ *  @desc Chooses the clips saved around pedestrians, see BGS::set_clip_length()
+ */
+void SegmentRunner::set_clip_length(double before, double after)
+{
+	clip_before = before;
+	clip_after = after;
+}
+
+/**
+ *  @desc Trains or loads the PeopleFinder, runs every segment of the video on its own
+ *  thread and merges their record logs into one, with its HTML table. The segments'
+ *  own logs are removed once they have been merged.
+ *
+ *  @returns int - frames analysed, not counting the warm-up frames
+ */
+int SegmentRunner::run()
+{
+	CaptureSource probe;
+	vector<VideoSegment> plan;
+	vector<BGS *> segments;
+	vector<thread> runners;
+	vector<string> segment_logs;
+	RecordLog merge_log;
+	stringstream ss;
+	int frame_count, records, analysed, total_frames = 0, failed_segments = 0;
+	bool seekable;
+	int64 start_ticks;
+	double seconds;
+	int i;
+
+	BGS::clear_stop_request();
+	probe.set_settings(capture_settings);
+	if (!probe.open(video_path))
+	{
+		cout << "Couldn't open the video " << video_path << endl;
+		return 0;
+	}
+	frame_count = (int)probe.get(CV_CAP_PROP_FRAME_COUNT);
+	seekable = probe.seek(frame_count / 2);
+	probe.release();
+	if (frame_count <= 0)
+	{
+		cout << "The length of " << video_path << " is unknown, so it can't be split into segments" << endl;
+		return 0;
+	}
+
+	pf.train_or_load(&pool);
+
+	if (!seekable)	//every segment would have to decode the video from the start
+	{
+		cout << "The " << probe.get_backend_name() << " backend can't seek in " << video_path << ", so it is analysed as one segment" << endl;
+	}
+	plan_segments(frame_count, seekable ? (segment_count > 0 ? segment_count : pool.get_size()) : 1, warmup_frames >= 0 ? warmup_frames : bgs_history, &plan);
+	cout << "Analysing " << frame_count << " frames in " << plan.size() << " segment(s)" << endl;
+
+	start_ticks = getTickCount();
+	for (i = 0; i < plan.size(); i++)
+	{
+		ss.str("");
+		ss << "_seg" << i + 1;
+		segments.push_back(new BGS(ss.str(), video_path, bgs_history, bgs_threshold, true, &pf, &pool));
+		segments[i]->set_pool_share(pool.get_share(i, (int)plan.size()));
+		segments[i]->set_log_format(log_format, log_level);
+		segments[i]->set_html_view(false);	//only the merged log gets a table
+		segments[i]->set_schedule_profile(schedule_profile);
+		segments[i]->set_capture(capture_settings);
+		segments[i]->set_bgs_scale(bgs_scale);
+		segments[i]->set_accel_mode(accel_mode);
+		segments[i]->set_background_engine(background_engine);
+		segments[i]->set_blob_engine(blob_engine);
+		segments[i]->set_clip_length(clip_before, clip_after);
+		if (plan.size() > 1)	//a single segment is the whole video, read without seeking
+		{
+			segments[i]->set_frame_range(plan[i].first_frame, plan[i].end_frame, plan[i].first_frame - plan[i].warmup_frame);
+		}
+		runners.push_back(thread(&BGS::run, segments[i]));
+	}
+	for (i = 0; i < runners.size(); i++)
+	{
+		runners[i].join();
+	}
+	seconds = (getTickCount() - start_ticks) / getTickFrequency();
+
+	for (i = 0; i < segments.size(); i++)
+	{
+		segments[i]->report();
+		segment_logs.push_back("record_log/" + segments[i]->get_log_name());
+		analysed = segments[i]->get_frames_processed() - (plan[i].first_frame - plan[i].warmup_frame);	//the warm-up frames go through the pipeline too
+		if (analysed <= 0)
+		{
+			cout << "Segment " << i + 1 << " (frames " << plan[i].first_frame << "-" << plan[i].end_frame << ") wasn't analysed" << endl;
+			failed_segments++;
+		}
+		else
+		{
+			total_frames += analysed;
+		}
+		delete segments[i];
+	}
+
+	merged_log = "record_log/" + merge_log.get_run_name("_offline");
+	records = merge_logs(segment_logs, merged_log);
+	if (records < 0)
+	{
+		cout << "Couldn't merge the segment logs, they are left in the record_log directory" << endl;
+		merged_log = "";
+		return total_frames;
+	}
+	for (i = 0; i < segment_logs.size(); i++)
+	{
+		remove((segment_logs[i] + ".det").c_str());
+		remove((segment_logs[i] + ".blob").c_str());
+		remove((segment_logs[i] + ".idx").c_str());
+	}
+	merge_log.write_html_view(merged_log, 0, INT_MAX);
+
+	printf("Analysed %d frames in %.1f s (%.1f fps), %d records in %s\n", total_frames, seconds, seconds > 0 ? total_frames / seconds : 0.0,
+		records, merged_log.c_str());
+	if (failed_segments > 0)
+	{
+		printf("%d of %d segments failed, their frames are missing from the log\n", failed_segments, (int)plan.size());
+	}
+	return total_frames;
+}
+
+/**
+ *  @returns string - base path of the merged record log, empty if run() couldn't write it
+ */
+string SegmentRunner::get_merged_log()
+{
+	return merged_log;
+}
+
+/**
+ *  @desc Splits a video into consecutive segments of nearly equal length. There are
+ *  fewer segments than asked for when they would be shorter than SEGMENT_MIN_FRAMES,
+ *  or than SEGMENT_WARMUP_RATIO times the warm-up, as every segment but the first
+ *  decodes its warm-up on top of its own frames.
+ *
+ *  @param int frame_count - frames in the video
+ *  @param int segments - segments wanted
+ *  @param int warmup - frames each segment is primed with, the first segment has none
+ *  @param vector<VideoSegment> *plan - filled with the segments in order
+ */
+void SegmentRunner::plan_segments(int frame_count, int segments, int warmup, vector<VideoSegment> *plan)
+{
+	VideoSegment segment;
+	int min_frames = max(SEGMENT_MIN_FRAMES, warmup * SEGMENT_WARMUP_RATIO);
+	int i;
+
+	segments = max(1, min(segments, frame_count / min_frames));
+	plan->clear();
+	for (i = 0; i < segments; i++)
+	{
+		segment.first_frame = (int)((long long)frame_count * i / segments);
+		segment.end_frame = (int)((long long)frame_count * (i + 1) / segments);
+		segment.warmup_frame = max(segment.first_frame - warmup, 0);
+		plan->push_back(segment);
+	}
+}
+
+/**
+ *  @desc Appends the record logs of the segments, in order, to a new log. The images
+ *  are copied still encoded. Track IDs and clip numbers are moved past the largest of
+ *  the segments before, untracked records and those without a clip keep 0, and each
+ *  clip file is renamed to go with the merged log.
+ *
+ *  @param const vector<string> &segment_paths - base paths of the segment logs, in video order
+ *  @param string merged_path - base path of the merged log, which takes its header from the first segment
+ *
+ *  @returns int - records in the merged log, -1 if a log couldn't be read or written
+ */
+int SegmentRunner::merge_logs(const vector<string> &segment_paths, string merged_path)
+{
+	DetectionStore merged, segment;
+	DetectionRecord record;
+	vector<uchar> src_image, contour_image;
+	set<int> renamed_clips;
+	int records = 0, track_offset = 0, last_track, clip_offset = 0, last_clip;
+	unsigned int n;
+	int i;
+
+	for (i = 0; i < segment_paths.size(); i++)
+	{
+		if (!segment.open_for_reading(segment_paths[i]))
+		{
+			cout << "Couldn't read the segment log " << segment_paths[i] << endl;
+			return -1;
+		}
+		if (i == 0 && !merged.open_for_writing(merged_path, segment.get_video_path(), segment.get_bgs_history(), segment.get_bgs_threshold()))
+		{
+			cout << "Couldn't create the merged log " << merged_path << endl;
+			return -1;
+		}
+
+		last_track = 0;
+		last_clip = 0;
+		renamed_clips.clear();
+		for (n = 0; segment.read_record(n, &record); n++)
+		{
+			if (!segment.read_encoded(record.src_offset, record.src_size, &src_image) ||
+				!segment.read_encoded(record.contour_offset, record.contour_size, &contour_image))
+			{
+				cout << "Couldn't read the images of record " << n + 1 << " in " << segment_paths[i] << endl;
+				return -1;
+			}
+			last_track = max(last_track, record.track_id);
+			if (record.track_id != 0)
+			{
+				record.track_id += track_offset;
+			}
+			last_clip = max(last_clip, record.clip_number);
+			if (record.clip_number != 0)
+			{
+				if (renamed_clips.insert(record.clip_number).second)	//several records can share a clip
+				{
+					rename(ClipRecorder::clip_path(segment_paths[i], record.clip_number).c_str(),
+						ClipRecorder::clip_path(merged_path, record.clip_number + clip_offset).c_str());
+				}
+				record.clip_number += clip_offset;
+			}
+			if (!merged.append(record, src_image, contour_image))
+			{
+				cout << "Couldn't write to the merged log " << merged_path << endl;
+				return -1;
+			}
+			records++;
+		}
+		track_offset += last_track;
+		clip_offset += last_clip;
+		segment.close();
+	}
+	merged.close();
+	return records;
+}
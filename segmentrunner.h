@@ -0,0 +1,92 @@
+#ifndef SEGMENTRUNNER_H
+#define SEGMENTRUNNER_H
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <set>
+#include <stdio.h>
+#include "bgs.h"
+#include "peoplefinder.h"
+#include "threadpool.h"
+#include "recordlog.h"
+#include "detectionstore.h"
+#include "cliprecorder.h"
+
+using namespace std;
+
+#define SEGMENT_MIN_FRAMES 250		//shortest segment worth starting a stream for
+#define SEGMENT_WARMUP_RATIO 4		//a segment is at least this many times its warm-up, so priming stays a small part of the work
+
+/**
+ *  @desc The frames of the video one segment covers
+ */
+struct VideoSegment
+{
+	int warmup_frame;		//first frame decoded, the background models are primed from here
+	int first_frame;		//first frame analysed and logged
+	int end_frame;			//one past the last frame analysed
+};
+
+/**
+ *	@file segmentrunner.h
+ *  @desc Analyses a recorded video offline by splitting it into consecutive segments
+ *  and running each segment as its own headless stream, one per core. Each segment
+ *  starts decoding some frames before its first frame so its background models are
+ *  warm by then, and only its own frames are logged. Once every segment has finished
+ *  their record logs are merged into one, in frame order, with the frame numbers and
+ *  timestamps of the whole video.
+ *
+ *  @param PeopleFinder pf - the trained classifier, shared by the segments
+ *  @param ThreadPool pool - workers for classification, shared by the segments
+ *  @param int segment_count - segments to split the video into, 0 for one per core
+ *  @param int warmup_frames - frames each segment is primed with, -1 for the BGS history
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class SegmentRunner
+{
+	private:
+		PeopleFinder pf;
+		ThreadPool pool;
+		string video_path;
+		int bgs_history;
+		double bgs_threshold;
+		int segment_count;
+		int warmup_frames;
+		LogImageFormat log_format;
+		int log_level;
+		ScheduleProfile schedule_profile;
+		CaptureSettings capture_settings;
+		int bgs_scale;
+		AccelMode accel_mode;
+		BackgroundEngine background_engine;
+		BlobEngine blob_engine;
+		double clip_before;
+		double clip_after;
+		string merged_log;
+
+	public:
+		SegmentRunner(string t_path, string v_path, int history, double thresh);
+		void set_segment_count(int segments);
+		void set_warmup_frames(int frames);
+		void set_log_format(LogImageFormat format, int level);
+		void set_schedule_profile(ScheduleProfile profile);
+		void set_capture(const CaptureSettings &settings);
+		void set_bgs_scale(int scale);
+		void set_accel_mode(AccelMode mode);
+		void set_background_engine(BackgroundEngine engine);
+		void set_blob_engine(BlobEngine engine);
+		void set_clip_length(double before, double after);
+		int run();
+		string get_merged_log();
+
+		static void plan_segments(int frame_count, int segments, int warmup, vector<VideoSegment> *plan);
+		static int merge_logs(const vector<string> &segment_paths, string merged_path);
+};
+
+#endif
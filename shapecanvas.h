@@ -0,0 +1,46 @@
+#ifndef SHAPECANVAS_H
+#define SHAPECANVAS_H
+
+#define SHAPE_CANVAS_ROWS 128	//every shape is resized to this before the skeleton is built
+#define SHAPE_CANVAS_COLS 64
+
+/**
+ *	@file shapecanvas.h
+ *  @desc The geometry of the canvas a shape is drawn on for the PeopleFinder, known at
+ *  compile time so the skeleton kernels can be built for one canvas size. The feature
+ *  search rows are kept in proportion to the original 64x128 canvas, where the torso is
+ *  searched above row 48, the waist between rows 64 and 80 and the feet below row 70.
+ *  Other sizes can be used by explicitly instantiating the PeopleFinder templates for
+ *  them at the end of peoplefinder.cpp.
+ *
+ *  @param int Rows - height of the canvas
+ *  @param int Cols - width of the canvas
+ *  @param int Threshold - offset used by the feature searches
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+template<int Rows, int Cols, int Threshold = 5>
+struct ShapeCanvasGeometry
+{
+	static constexpr int rows = Rows;
+	static constexpr int cols = Cols;
+	static constexpr int pixels = Rows * Cols;
+	static constexpr int threshold = Threshold;
+
+	static constexpr int centre_row = Rows / 2;			//the flood fill seed, assumed to be inside the shape
+	static constexpr int centre_col = Cols / 2;
+	static constexpr int torso_end_row = Rows * 3 / 8;	//torso is searched above this row
+	static constexpr int waist_start_row = Rows / 2;	//waist is searched from this row...
+	static constexpr int waist_end_row = Rows * 5 / 8;	//...to this one
+	static constexpr int foot_start_row = Rows * 35 / 64;	//feet are searched below this row
+	static constexpr int foot_row = Rows - 1;			//bottom corners the feet are measured against
+	static constexpr int left_foot_col = 1;
+	static constexpr int right_foot_col = Cols - 1;
+
+	static_assert(Rows >= 16 && Cols >= 16, "the skeleton kernels need a canvas of at least 16x16");
+};
+
+typedef ShapeCanvasGeometry<SHAPE_CANVAS_ROWS, SHAPE_CANVAS_COLS> ShapeCanvas;
+
+#endif
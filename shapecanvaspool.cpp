@@ -0,0 +1,49 @@
+#include "shapecanvaspool.h"
+
+/**
+ *	@file shapecanvaspool.cpp
+ *  @desc Hands out zeroed canvases of a fixed size, reusing the ones no longer
+ *  referenced outside the pool.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+ShapeCanvasPool::ShapeCanvasPool(Size size, int type, int initial)
+	: canvas_size(size), canvas_type(type)
+{
+	int i;
+
+	for (i = 0; i < initial; i++)
+	{
+		canvases.push_back(Mat(canvas_size, canvas_type));
+	}
+}
+
+/**
+ *  @desc Gives out a zeroed canvas. A canvas whose only reference is the pool's own is
+ *  reused, otherwise a new one is added to the pool.
+ *
+ *  @returns Mat - the canvas, shares its pixels with the pool
+ */
+Mat ShapeCanvasPool::acquire()
+{
+	int i;
+
+	for (i = 0; i < canvases.size(); i++)
+	{
+		if (canvases[i].u != NULL && canvases[i].u->refcount == 1)	//nobody else can take a reference, so this can't change under us
+		{
+			canvases[i].setTo(Scalar::all(0));
+			return canvases[i];
+		}
+	}
+
+	canvases.push_back(Mat::zeros(canvas_size, canvas_type));
+	return canvases.back();
+}
+
+int ShapeCanvasPool::get_allocated()
+{
+	return (int)canvases.size();
+}
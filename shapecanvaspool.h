@@ -0,0 +1,38 @@
+#ifndef SHAPECANVASPOOL_H
+#define SHAPECANVASPOOL_H
+
+#include <vector>
+#include "opencv2/core.hpp"
+
+using namespace std;
+using namespace cv;
+
+/**
+ *	@file shapecanvaspool.h
+ *  @desc Reusable images for the shapes sent to the PeopleFinder. A canvas handed out by
+ *  acquire() stays in use for as long as anything holds a reference to it, e.g. the
+ *  record log still writing it out, and is only given out again once every other
+ *  reference has been released. Must be used from one thread, the references can be
+ *  released from any thread.
+ *
+ *  @param Size canvas_size - size of every canvas
+ *  @param int canvas_type - OpenCV type of every canvas
+ *  @param int initial - number of canvases to allocate up front
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class ShapeCanvasPool
+{
+	private:
+		vector<Mat> canvases;
+		Size canvas_size;
+		int canvas_type;
+
+	public:
+		ShapeCanvasPool(Size size, int type, int initial);
+		Mat acquire();
+		int get_allocated();
+};
+
+#endif
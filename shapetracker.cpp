@@ -0,0 +1,237 @@
+#include "shapetracker.h"
+
+/**
+ *	@file shapetracker.cpp
+ *  @desc Gives the larger shapes persistent IDs by matching their bounding boxes to
+ *  the tracks of the previous frame, and remembers the verdict of each track so the
+ *  PeopleFinder only needs to run on new or uncertain shapes.
+ *
+ *  Boxes are matched greedily by intersection over union, best overlap first. A box
+ *  that matches no track starts a new one, and a track that goes unmatched for
+ *  TRACK_MAX_MISSES frames is dropped.
+ *
+ *  update() and select_for_classification() are called from the blob stage, the
+ *  verdicts are set from the classification stage, so the tracks are locked.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+ShapeTracker::ShapeTracker()
+	: next_id(1), tracks_created(0)
+{}
+
+/**
+ *  @desc Matches this frame's boxes to the tracks, moving the matched tracks to the new
+ *  boxes, starting tracks for the rest and dropping tracks not seen for too long.
+ *
+ *  @param const vector<Rect> &boxes - bounding boxes of the shapes in the frame
+ *  @param vector<int> *track_ids - filled with the track ID of each box
+ */
+void ShapeTracker::update(const vector<Rect> &boxes, vector<int> *track_ids)
+{
+	struct Pairing
+	{
+		double iou;
+		int track;
+		int box;
+	};
+
+	lock_guard<mutex> guard(lock);
+	vector<Pairing> pairings;
+	vector<bool> track_matched(tracks.size(), false);
+	Pairing pairing;
+	Track track;
+	int t, b;
+
+	track_ids->assign(boxes.size(), 0);
+
+	for (t = 0; t < tracks.size(); t++)
+	{
+		for (b = 0; b < boxes.size(); b++)
+		{
+			pairing.iou = overlap(tracks[t].box, boxes[b]);
+			if (pairing.iou >= TRACK_MIN_OVERLAP)
+			{
+				pairing.track = t;
+				pairing.box = b;
+				pairings.push_back(pairing);
+			}
+		}
+	}
+	sort(pairings.begin(), pairings.end(), [](const Pairing &x, const Pairing &y) { return x.iou > y.iou; });
+
+	for (int i = 0; i < pairings.size(); i++)
+	{
+		if (!track_matched[pairings[i].track] && (*track_ids)[pairings[i].box] == 0)
+		{
+			track_matched[pairings[i].track] = true;
+			tracks[pairings[i].track].box = boxes[pairings[i].box];
+			tracks[pairings[i].track].misses = 0;
+			(*track_ids)[pairings[i].box] = tracks[pairings[i].track].id;
+		}
+	}
+
+	for (t = (int)tracks.size() - 1; t >= 0; t--)
+	{
+		if (!track_matched[t] && ++tracks[t].misses > TRACK_MAX_MISSES)
+		{
+			tracks.erase(tracks.begin() + t);
+		}
+	}
+
+	for (b = 0; b < boxes.size(); b++)
+	{
+		if ((*track_ids)[b] == 0)
+		{
+			track.id = next_id++;
+			track.box = boxes[b];
+			track.misses = 0;
+			track.classifications = 0;
+			track.last_classified_frame = 0;
+			track.classified_area = 0;
+			track.pending = false;
+			track.verdict = VERDICT_NONE;
+			track.feature_score = 0;
+			tracks.push_back(track);
+			tracks_created++;
+			(*track_ids)[b] = track.id;
+		}
+	}
+}
+
+/**
+ *  @desc Picks the tracks that need the PeopleFinder: tracks never classified and, when
+ *  rechecking, tracks still "Something" after fewer than TRACK_MAX_CLASSIFICATIONS
+ *  attempts and settled tracks not classified for TRACK_RECHECK_FRAMES frames. Tracks
+ *  waiting for a verdict are left out.
+ *
+ *  A shape's first verdict is often from a person only part way into view, so a track
+ *  judged noise or something whose size has changed by more than
+ *  TRACK_STABLE_SIZE_CHANGE since is rechecked after only TRACK_RESIZED_RECHECK_FRAMES,
+ *  until it has been classified at a stable size.
+ *
+ *  @param const vector<int> &track_ids - track ID of each shape in the frame
+ *  @param int frame_number - the current frame
+ *  @param bool recheck - also pick uncertain and settled tracks
+ *  @param vector<int> *selected - filled with the positions in track_ids to classify
+ */
+void ShapeTracker::select_for_classification(const vector<int> &track_ids, int frame_number, bool recheck, vector<int> *selected)
+{
+	lock_guard<mutex> guard(lock);
+	Track *track;
+
+	selected->clear();
+	for (int i = 0; i < track_ids.size(); i++)
+	{
+		track = find_track(track_ids[i]);
+		if (track == NULL || track->pending)
+		{
+			continue;
+		}
+
+		if (track->classifications == 0 ||
+			(recheck && track->verdict == VERDICT_SOMETHING && track->classifications < TRACK_MAX_CLASSIFICATIONS) ||
+			(recheck && frame_number - track->last_classified_frame >= TRACK_RECHECK_FRAMES) ||
+			(recheck && track->verdict != VERDICT_PEDESTRIAN && frame_number - track->last_classified_frame >= TRACK_RESIZED_RECHECK_FRAMES &&
+				abs(track->box.area() - track->classified_area) > TRACK_STABLE_SIZE_CHANGE * track->classified_area))
+		{
+			selected->push_back(i);
+		}
+	}
+}
+
+/**
+ *  @desc Marks a track as sent to the PeopleFinder so it isn't selected again before
+ *  its verdict arrives
+ */
+void ShapeTracker::mark_pending(int track_id)
+{
+	lock_guard<mutex> guard(lock);
+	Track *track = find_track(track_id);
+
+	if (track != NULL)
+	{
+		track->pending = true;
+	}
+}
+
+/**
+ *  @desc Stores the PeopleFinder's verdict for a track
+ *
+ *  @param int track_id - the track
+ *  @param Verdict verdict - the classification
+ *  @param int feature_score - number of features in range
+ *  @param int frame_number - frame the shape was taken from
+ */
+void ShapeTracker::set_verdict(int track_id, Verdict verdict, int feature_score, int frame_number)
+{
+	lock_guard<mutex> guard(lock);
+	Track *track = find_track(track_id);
+
+	if (track != NULL)
+	{
+		track->verdict = verdict;
+		track->feature_score = feature_score;
+		track->classifications++;
+		track->last_classified_frame = frame_number;
+		track->classified_area = track->box.area();
+		track->pending = false;
+	}
+}
+
+/**
+ *  @desc Looks up the cached verdict of a track
+ *
+ *  @returns false if the track is unknown or hasn't been classified yet
+ */
+bool ShapeTracker::get_verdict(int track_id, Verdict *verdict, int *feature_score)
+{
+	lock_guard<mutex> guard(lock);
+	Track *track = find_track(track_id);
+
+	if (track == NULL || track->classifications == 0)
+	{
+		return false;
+	}
+	*verdict = track->verdict;
+	*feature_score = track->feature_score;
+	return true;
+}
+
+int ShapeTracker::get_track_count()
+{
+	lock_guard<mutex> guard(lock);
+	return (int)tracks.size();
+}
+
+int ShapeTracker::get_tracks_created()
+{
+	lock_guard<mutex> guard(lock);
+	return tracks_created;
+}
+
+/**
+ *  @desc Intersection over union of two boxes
+ *
+ *  @returns double - 0 for boxes that don't touch up to 1 for the same box
+ */
+double ShapeTracker::overlap(Rect a, Rect b)
+{
+	double intersection = (a & b).area();
+	double combined = a.area() + b.area() - intersection;
+
+	return combined > 0 ? intersection / combined : 0;
+}
+
+Track *ShapeTracker::find_track(int track_id)
+{
+	for (int i = 0; i < tracks.size(); i++)
+	{
+		if (tracks[i].id == track_id)
+		{
+			return &tracks[i];
+		}
+	}
+	return NULL;
+}
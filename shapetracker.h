@@ -0,0 +1,70 @@
+#ifndef SHAPETRACKER_H
+#define SHAPETRACKER_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include "opencv2/core.hpp"
+#include "featuremodel.h"
+
+using namespace std;
+using namespace cv;
+
+#define TRACK_MIN_OVERLAP 0.3			//intersection over union needed to match a box to a track
+#define TRACK_MAX_MISSES 10				//frames a track can go unseen before it is dropped
+#define TRACK_MAX_CLASSIFICATIONS 3		//attempts for a track whose verdict stays uncertain
+#define TRACK_RECHECK_FRAMES 300		//frames before a settled track is classified again
+#define TRACK_RESIZED_RECHECK_FRAMES 30	//frames before a track not judged a pedestrian is classified again while its size changes
+#define TRACK_STABLE_SIZE_CHANGE 0.2	//change in area since the last classification that still counts as the same size
+
+/**
+ *  @desc One shape followed from frame to frame, with the last verdict it was given
+ */
+struct Track
+{
+	int id;
+	Rect box;
+	int misses;						//frames since it was last matched
+	int classifications;			//times the PeopleFinder has been run on it
+	int last_classified_frame;
+	int classified_area;			//area of the box when it was last classified
+	bool pending;					//waiting for a verdict
+	Verdict verdict;				//VERDICT_NONE until classified
+	int feature_score;
+};
+
+/**
+ *	@file shapetracker.h
+ *  @desc Follows the larger shapes across frames and caches the verdict of each one, so
+ *  a shape is classified when it appears rather than on every detection tick.
+ *
+ *  @param vector<Track> tracks - the shapes currently being followed
+ *  @param int next_id - ID given to the next new track
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class ShapeTracker
+{
+	private:
+		vector<Track> tracks;
+		int next_id;
+		int tracks_created;
+		mutex lock;
+
+		Track *find_track(int track_id);
+
+	public:
+		ShapeTracker();
+		void update(const vector<Rect> &boxes, vector<int> *track_ids);
+		void select_for_classification(const vector<int> &track_ids, int frame_number, bool recheck, vector<int> *selected);
+		void mark_pending(int track_id);
+		void set_verdict(int track_id, Verdict verdict, int feature_score, int frame_number);
+		bool get_verdict(int track_id, Verdict *verdict, int *feature_score);
+		int get_track_count();
+		int get_tracks_created();
+		static double overlap(Rect a, Rect b);
+};
+
+#endif
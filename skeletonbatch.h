@@ -0,0 +1,65 @@
+#ifndef SKELETONBATCH_H
+#define SKELETONBATCH_H
+
+#include <vector>
+#include <climits>
+#include "opencv2/core.hpp"
+
+using namespace std;
+using namespace cv;
+
+#define FEATURE_NODES 11			//body parts in a skeleton
+
+/**
+ *	@file skeletonbatch.h
+ *  @desc The feature nodes of many skeletons, stored node by node so the same node of
+ *  4 skeletons is one SIMD load. Node i of skeleton s is at i * stride + s. The
+ *  skeletons can come from one frame or from several streams, FeatureModel::score_batch()
+ *  scores them all in one pass. The padding slots hold a position no range contains.
+ *
+ *  @param vector<int> xs - x of each node
+ *  @param vector<int> ys - y of each node
+ *  @param int count - skeletons in the batch
+ *  @param int stride - count rounded up to whole SIMD registers
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class SkeletonBatch
+{
+	public:
+		vector<int> xs;
+		vector<int> ys;
+		int count;
+		int stride;
+
+		SkeletonBatch()
+			: count(0), stride(0)
+		{
+		}
+
+		/**
+		 *  @desc Makes room for the given number of skeletons, all of them out of range
+		 */
+		void resize(int skeletons)
+		{
+			count = skeletons;
+			stride = (skeletons + 3) & ~3;
+			xs.assign(FEATURE_NODES * stride, INT_MIN);
+			ys.assign(FEATURE_NODES * stride, INT_MIN);
+		}
+
+		/**
+		 *  @desc Copies a skeleton's nodes into its slot, slots may be filled from any thread
+		 */
+		void set_skeleton(int slot, const vector<Point> &nodes)
+		{
+			for (int i = 0; i < FEATURE_NODES; i++)
+			{
+				xs[i * stride + slot] = nodes[i].x;
+				ys[i * stride + slot] = nodes[i].y;
+			}
+		}
+};
+
+#endif
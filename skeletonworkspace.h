@@ -0,0 +1,42 @@
+#ifndef SKELETONWORKSPACE_H
+#define SKELETONWORKSPACE_H
+
+#include <vector>
+#include "opencv2/core.hpp"
+#include "pixelrows.h"
+#include "shapecanvas.h"
+
+using namespace std;
+using namespace cv;
+
+/**
+ *	@file skeletonworkspace.h
+ *  @desc Scratch buffers used by PeopleFinder::create_skeleton(). The buffers are sized
+ *  once for the shape canvas and reused for every shape, so building a skeleton
+ *  does not allocate. A workspace must only be used by one thread at a time, the
+ *  PeopleFinder keeps one per thread.
+ *
+ *  @param vector<Point> nodes - the x/y positions of each body part
+ *  @param PixelRows shape_pixels - x/y positions within the shape
+ *  @param PixelRows outline_pixels - x/y positions in the outline of the shape
+ *  @param Point fill_stack[] - pending pixels while filling the shape, a pixel is only
+ *  pushed once so the stack never holds more than the canvas
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class SkeletonWorkspace
+{
+	public:
+		vector<Point> nodes;
+		PixelRows shape_pixels;
+		PixelRows outline_pixels;
+		Point fill_stack[ShapeCanvas::pixels];
+
+		SkeletonWorkspace()
+			: nodes(11), shape_pixels(ShapeCanvas::rows, ShapeCanvas::cols), outline_pixels(ShapeCanvas::rows, ShapeCanvas::cols)
+		{
+		}
+};
+
+#endif
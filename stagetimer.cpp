@@ -0,0 +1,177 @@
+#include "stagetimer.h"
+
+/**
+ *	@file stagetimer.cpp
+ *  @desc Accumulates the time spent in each stage of the video pipeline so that a
+ *  summary can be printed when the video has finished playing.
+ *
+ *  @param vector<string> stage_names - display name of each stage
+ *  @param vector<int64> total_ticks - accumulated ticks spent in each stage
+ *  @param vector<int> calls - number of times each stage has been timed
+ *  @param vector<vector<float>> samples - time of each call, for percentiles
+ *  @param StreamMetrics *metrics - live figures fed with every stage time, may be NULL
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+StageTimer::StageTimer()
+	: keep_samples(false), run_start(0), metrics(NULL)
+{}
+
+/**
+ *  @desc Registers a new stage with the timer
+ *
+ *  @param string name - name shown in the report
+ *
+ *  @returns int - index used to start/stop the stage
+ */
+int StageTimer::add_stage(string name)
+{
+	stage_names.push_back(name);
+	start_ticks.push_back(0);
+	total_ticks.push_back(0);
+	calls.push_back(0);
+	samples.push_back(vector<float>());
+	metric_stages.push_back(metrics != NULL ? metrics->add_stage(name) : -1);
+
+	return (int)stage_names.size() - 1;
+}
+
+/**
+ *  @desc Marks the start of the run, used for the overall frame rate
+ */
+void StageTimer::begin_run()
+{
+	run_start = getTickCount();
+	if (metrics != NULL)
+	{
+		metrics->begin_run();
+	}
+}
+
+void StageTimer::start(int stage)
+{
+	start_ticks[stage] = getTickCount();
+}
+
+void StageTimer::stop(int stage)
+{
+	int64 ticks = getTickCount() - start_ticks[stage];
+
+	total_ticks[stage] += ticks;
+	calls[stage]++;
+	if (keep_samples)
+	{
+		samples[stage].push_back((float)((ticks * 1000.0) / getTickFrequency()));
+	}
+	if (metrics != NULL)
+	{
+		metrics->observe(metric_stages[stage], ticks);
+	}
+}
+
+double StageTimer::get_total_ms(int stage)
+{
+	return (total_ticks[stage] * 1000.0) / getTickFrequency();
+}
+
+int StageTimer::get_calls(int stage)
+{
+	return calls[stage];
+}
+
+/**
+ *  @desc Keeps the time of every call so percentiles can be reported. Costs memory per
+ *  call, so it is meant for benchmark runs rather than live streams.
+ */
+void StageTimer::set_keep_samples(bool keep)
+{
+	keep_samples = keep;
+}
+
+/**
+ *  @desc Feeds every stage time to a stream's live figures as well. The stages already
+ *  added are registered with the metrics straight away, later ones as they are added.
+ *
+ *  @param StreamMetrics *stream_metrics - the stream's figures, must outlive the timer
+ */
+void StageTimer::set_metrics(StreamMetrics *stream_metrics)
+{
+	int i;
+
+	metrics = stream_metrics;
+	for (i = 0; i < stage_names.size(); i++)
+	{
+		metric_stages[i] = metrics != NULL ? metrics->add_stage(stage_names[i]) : -1;
+	}
+}
+
+/**
+ *  @desc Finds the time that the given percentage of calls to a stage took at most,
+ *  using the nearest rank
+ *
+ *  @param int stage - the stage
+ *  @param double percent - 50 for the median, 99 for the 99th percentile
+ *
+ *  @returns double - time in ms, 0 if no samples were kept
+ */
+double StageTimer::get_percentile(int stage, double percent)
+{
+	vector<float> sorted = samples[stage];
+	int rank;
+
+	if (sorted.empty())
+	{
+		return 0;
+	}
+	rank = (int)ceil(percent / 100.0 * sorted.size()) - 1;
+	rank = min(max(rank, 0), (int)sorted.size() - 1);
+	nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+	return sorted[rank];
+}
+
+/**
+ *  @desc Time since begin_run() in ms
+ */
+double StageTimer::get_run_ms()
+{
+	return ((getTickCount() - run_start) * 1000.0) / getTickFrequency();
+}
+
+int StageTimer::get_stage_count()
+{
+	return (int)stage_names.size();
+}
+
+string StageTimer::get_stage_name(int stage)
+{
+	return stage_names[stage];
+}
+
+/**
+ *  @desc Prints the total and average time of each stage, followed by the overall
+ *  frame rate of the run.
+ *
+ *  @param int frames - number of frames processed during the run
+ */
+void StageTimer::report(int frames)
+{
+	double run_ms = get_run_ms();
+	int i;
+
+	cout << "---Stage Timings---" << endl;
+	cout << left << setw(20) << "Stage" << right << setw(12) << "Calls" << setw(14) << "Total (ms)" << setw(14) << "Mean (ms)" << endl;
+	for (i = 0; i < stage_names.size(); i++)
+	{
+		cout << left << setw(20) << stage_names[i] << right << setw(12) << calls[i]
+			<< setw(14) << fixed << setprecision(1) << get_total_ms(i)
+			<< setw(14) << setprecision(3) << (calls[i] > 0 ? get_total_ms(i) / calls[i] : 0.0) << endl;
+	}
+	cout << "Frames: " << frames << "  Elapsed: " << setprecision(1) << run_ms << " ms";
+	if (run_ms > 0)
+	{
+		cout << "  FPS: " << setprecision(1) << (frames * 1000.0) / run_ms;
+	}
+	cout << endl;
+}
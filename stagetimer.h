@@ -0,0 +1,47 @@
+#ifndef STAGETIMER_H
+#define STAGETIMER_H
+
+#include <iostream>
+#include <iomanip>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include "opencv2/core.hpp"
+#include "streammetrics.h"
+
+using namespace std;
+using namespace cv;
+
+class StageTimer
+{
+	private:
+		vector<string> stage_names;
+		vector<int64> start_ticks;
+		vector<int64> total_ticks;
+		vector<int> calls;
+		vector<vector<float>> samples;		//time of every call in ms, only when keep_samples is set
+		bool keep_samples;
+		int64 run_start;
+		StreamMetrics *metrics;				//also fed every stage time when set
+		vector<int> metric_stages;			//index of each stage in the metrics
+
+	public:
+		StageTimer();
+		int add_stage(string name);
+		void begin_run();
+		void start(int stage);
+		void stop(int stage);
+		double get_total_ms(int stage);
+		int get_calls(int stage);
+		void set_keep_samples(bool keep);
+		void set_metrics(StreamMetrics *stream_metrics);
+		double get_percentile(int stage, double percent);
+		double get_run_ms();
+		int get_stage_count();
+		string get_stage_name(int stage);
+		void report(int frames);
+};
+
+#endif
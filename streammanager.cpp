@@ -0,0 +1,248 @@
+#include "streammanager.h"
+
+/**
+ *	@file streammanager.cpp
+ *  @desc Runs several video streams in one process. The PeopleFinder is trained once and
+ *  shared, as is one thread pool for classification. Every stream has its own capture,
+ *  background subtractors, blob detector, record log and pipeline threads, so a slow
+ *  stream only holds up itself:
+ *
+ *  - each stream's pipeline has its own bounded queues, a stream that falls behind
+ *    blocks its own decoding and nobody else's. The pipeline threads themselves are
+ *    scheduled by the OS, it's these queues that keep the streams fair to each other.
+ *  - each stream only asks for its share of the pool's workers when classifying, so a
+ *    frame full of shapes on one stream can't take every worker. Every stream gets at
+ *    least one helper, with more streams than workers the helpers' tasks wait in the
+ *    pool's queue in the order they were asked for.
+ *  - a stream whose classification is behind skips detection ticks instead of queueing
+ *    more work for the pool.
+ *
+ *  With more than one stream the display windows are not used.
+ *
+ *  With set_metrics_port() every stream's live figures are served for Prometheus
+ *  while the streams run.
+ *
+ *  @param string t_path - path for training images folder
+ *  @param bool no_display - skips the display windows and frame delay when true
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+StreamManager::StreamManager(string t_path, bool no_display)
+	: pf(vector<Point>(11), vector<Point>(11), t_path), pool(0), headless(no_display), log_format(LOG_IMAGE_PNG), log_level(1),
+	schedule_profile(SCHEDULE_BALANCED), bgs_scale(1), accel_mode(ACCEL_CPU), background_engine(BACKGROUND_KNN), blob_engine(BLOB_CONTOURS), clip_before(0), clip_after(0), metrics_port(0), metrics_address(METRICS_DEFAULT_ADDRESS)
+{}
+
+/**
+ *  @desc Adds a video to be analysed when run() is called
+ *
+ *  @param string v_path - path for video file
+ *  @param int history - BGS history length
+ *  @param double thresh - BGS distance to threshold
+ */
+void StreamManager::add_stream(string v_path, int history, double thresh)
+{
+	StreamSettings stream;
+
+	stream.video_path = v_path;
+	stream.bgs_history = history;
+	stream.bgs_threshold = thresh;
+	settings.push_back(stream);
+}
+
+/**
+ *  @desc Chooses how every stream's record log saves its images
+ *
+ *  @param LogImageFormat format - PNG, JPEG or RAW
+ *  @param int level - PNG compression 0-9 or JPEG quality 0-100
+ */
+void StreamManager::set_log_format(LogImageFormat format, int level)
+{
+	log_format = format;
+	log_level = level;
+}
+
+/**
+ *  @desc Chooses every stream's trade-off between classification latency and CPU use
+ *
+ *  @param ScheduleProfile profile - low latency, balanced or low CPU
+ */
+void StreamManager::set_schedule_profile(ScheduleProfile profile)
+{
+	schedule_profile = profile;
+}
+
+/**
+ *  @desc Chooses how every stream decodes its video
+ *
+ *  @param const CaptureSettings &settings - backend, greyscale and frame skipping modes
+ */
+void StreamManager::set_capture(const CaptureSettings &settings)
+{
+	capture_settings = settings;
+}
+
+/**
+ *  @desc Chooses the scale every stream runs background subtraction at
+ *
+ *  @param int scale - 1 (full resolution), 2 or 4
+ */
+void StreamManager::set_bgs_scale(int scale)
+{
+	bgs_scale = scale;
+}
+
+/**
+ *  @desc Chooses where every stream runs background subtraction and noise filtering.
+ *  In automatic mode each stream decides for itself, so streams sharing a busy device
+ *  spread themselves between it and the CPU.
+ *
+ *  @param AccelMode mode - CPU, OpenCL or automatic
+ */
+void StreamManager::set_accel_mode(AccelMode mode)
+{
+	accel_mode = mode;
+}
+
+/**
+ *  @desc Chooses the background model every stream subtracts with
+ *
+ *  @param BackgroundEngine engine - KNN or ViBe
+ */
+void StreamManager::set_background_engine(BackgroundEngine engine)
+{
+	background_engine = engine;
+}
+
+/**
+ *  @desc Chooses how every stream finds the blobs in its mask
+ *
+ *  @param BlobEngine engine - contours and hulls, or connected components
+ */
+void StreamManager::set_blob_engine(BlobEngine engine)
+{
+	blob_engine = engine;
+}
+
+/**
+ *  @desc Chooses the clips every stream saves around its pedestrians, each stream
+ *  keeps its own ring of frames
+ *
+ *  @param double before - seconds kept from before the pedestrian
+ *  @param double after - seconds recorded afterwards, both 0 for no clips
+ */
+void StreamManager::set_clip_length(double before, double after)
+{
+	clip_before = before;
+	clip_after = after;
+}
+
+/**
+ *  @desc Serves the figures of every stream at http://<host>:<port>/metrics while
+ *  run() is going
+ *
+ *  @param int port - TCP port, 0 turns the server off
+ */
+void StreamManager::set_metrics_port(int port)
+{
+	metrics_port = port;
+}
+
+/**
+ *  @desc Chooses the interface the figures are served on, only this machine by default
+ *
+ *  @param string address - IPv4 address of the interface, 0.0.0.0 for every interface
+ */
+void StreamManager::set_metrics_address(string address)
+{
+	metrics_address = address;
+}
+
+int StreamManager::get_stream_count()
+{
+	return (int)settings.size();
+}
+
+/**
+ *  @desc Trains or loads the PeopleFinder, then runs every stream until its video has
+ *  finished. A single stream runs on the calling thread so it can use the display
+ *  windows, otherwise each stream gets a thread. The stage timings of each stream are
+ *  printed at the end.
+ *
+ *  @returns int - total number of frames processed across the streams
+ */
+int StreamManager::run()
+{
+	vector<BGS *> streams;
+	vector<thread> runners;
+	stringstream ss;
+	int total_frames = 0;
+	int i;
+
+	if (settings.empty())
+	{
+		return 0;
+	}
+
+	BGS::clear_stop_request();
+	pf.train_or_load(&pool);
+
+	if (settings.size() > 1 && !headless)
+	{
+		cout << "Running " << settings.size() << " streams, the display windows are turned off" << endl;
+	}
+
+	for (i = 0; i < settings.size(); i++)
+	{
+		ss.str("");
+		if (settings.size() > 1)
+		{
+			ss << "_cam" << i + 1;
+		}
+		streams.push_back(new BGS(ss.str(), settings[i].video_path, settings[i].bgs_history, settings[i].bgs_threshold,
+			headless || settings.size() > 1, &pf, &pool));
+		streams[i]->set_pool_share(pool.get_share(i, (int)settings.size()));	//each stream's own thread always helps too
+		streams[i]->set_log_format(log_format, log_level);
+		streams[i]->set_schedule_profile(schedule_profile);
+		streams[i]->set_capture(capture_settings);
+		streams[i]->set_bgs_scale(bgs_scale);
+		streams[i]->set_accel_mode(accel_mode);
+		streams[i]->set_background_engine(background_engine);
+		streams[i]->set_blob_engine(blob_engine);
+		streams[i]->set_clip_length(clip_before, clip_after);
+		metrics_server.add_stream(streams[i]->get_metrics());
+	}
+
+	if (metrics_port > 0)
+	{
+		metrics_server.start(metrics_port, metrics_address);
+	}
+
+	if (streams.size() == 1)
+	{
+		streams[0]->run();
+	}
+	else
+	{
+		for (i = 0; i < streams.size(); i++)
+		{
+			runners.push_back(thread(&BGS::run, streams[i]));
+		}
+		for (i = 0; i < runners.size(); i++)
+		{
+			runners[i].join();
+		}
+	}
+
+	metrics_server.stop();
+	for (i = 0; i < streams.size(); i++)
+	{
+		metrics_server.remove_stream(streams[i]->get_metrics());
+		streams[i]->report();
+		total_frames += streams[i]->get_frames_processed();
+		delete streams[i];
+	}
+
+	return total_frames;
+}
@@ -0,0 +1,64 @@
+#ifndef STREAMMANAGER_H
+#define STREAMMANAGER_H
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include "bgs.h"
+#include "peoplefinder.h"
+#include "threadpool.h"
+#include "metricsserver.h"
+
+using namespace std;
+
+/**
+ *  @desc Settings for one video stream, kept until the streams are started
+ */
+struct StreamSettings
+{
+	string video_path;
+	int bgs_history;
+	double bgs_threshold;
+};
+
+class StreamManager
+{
+	private:
+		PeopleFinder pf;
+		ThreadPool pool;
+		vector<StreamSettings> settings;
+		bool headless;
+		LogImageFormat log_format;
+		int log_level;
+		ScheduleProfile schedule_profile;
+		CaptureSettings capture_settings;
+		int bgs_scale;
+		AccelMode accel_mode;
+		BackgroundEngine background_engine;
+		BlobEngine blob_engine;
+		double clip_before;
+		double clip_after;
+		int metrics_port;
+		string metrics_address;
+		MetricsServer metrics_server;
+
+	public:
+		StreamManager(string t_path, bool no_display);
+		void add_stream(string v_path, int history, double thresh);
+		void set_log_format(LogImageFormat format, int level);
+		void set_schedule_profile(ScheduleProfile profile);
+		void set_capture(const CaptureSettings &settings);
+		void set_bgs_scale(int scale);
+		void set_accel_mode(AccelMode mode);
+		void set_background_engine(BackgroundEngine engine);
+		void set_blob_engine(BlobEngine engine);
+		void set_clip_length(double before, double after);
+		void set_metrics_port(int port);
+		void set_metrics_address(string address);
+		int get_stream_count();
+		int run();
+};
+
+#endif
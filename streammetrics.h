@@ -0,0 +1,113 @@
+#ifndef STREAMMETRICS_H
+#define STREAMMETRICS_H
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <atomic>
+#include "opencv2/core.hpp"
+
+using namespace std;
+using namespace cv;
+
+#define METRICS_MAX_STAGES 16		//most stages one stream can report
+#define METRICS_BUCKETS 12			//latency buckets, the last one is +Inf
+
+/**
+ *  @desc Running totals kept for every stream
+ */
+enum StreamCounter
+{
+	COUNTER_FRAMES,
+	COUNTER_FRAMES_SKIPPED,
+	COUNTER_DETECTIONS_SKIPPED,
+	COUNTER_CONTOURS,
+	COUNTER_BLOBS,
+	COUNTER_SHAPES,
+	COUNTER_CLASSIFIED,
+	COUNTER_LOG_WRITTEN,
+	COUNTER_LOG_DROPPED,
+	COUNTER_RECONNECTS,
+	STREAM_COUNTERS
+};
+
+/**
+ *  @desc Current values kept for every stream
+ */
+enum StreamGauge
+{
+	GAUGE_FRAMES_IN_FLIGHT,
+	GAUGE_PENDING_DETECTIONS,
+	GAUGE_ACTIVE_TRACKS,
+	GAUGE_LOG_QUEUE,
+	STREAM_GAUGES
+};
+
+/**
+ *  @desc Cumulative latency buckets of one stage, in the Prometheus layout
+ */
+struct LatencyHistogram
+{
+	atomic<long long> buckets[METRICS_BUCKETS];
+	atomic<long long> count;
+	atomic<long long> sum_ticks;
+};
+
+/**
+ *	@file streammetrics.h
+ *  @desc Live health figures of one stream, updated by the pipeline threads as they
+ *  run and read by the MetricsServer when it is scraped. Every value is a relaxed
+ *  atomic and each stage is only written by the thread running it, so updating costs
+ *  an uncontended add and never takes a lock. Stages are registered before the
+ *  stream starts.
+ *
+ *  @param string stream_name - label of the stream, e.g. cam1
+ *  @param string video_path - the stream's video as labelled, a camera URL without its credentials or path
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class StreamMetrics
+{
+	private:
+		string stream_name;
+		string video_path;
+		string stage_names[METRICS_MAX_STAGES];
+		int stage_count;
+		LatencyHistogram stages[METRICS_MAX_STAGES];
+		int64 bucket_ticks[METRICS_BUCKETS - 1];	//upper bound of each finite bucket
+		atomic<long long> counters[STREAM_COUNTERS];
+		atomic<long long> gauges[STREAM_GAUGES];
+		atomic<int64> start_ticks;
+
+		string labels();
+
+	public:
+		StreamMetrics();
+		void set_stream(string name, string v_path);
+		int add_stage(string name);
+		void begin_run();
+		void observe(int stage, int64 ticks);
+		void add(StreamCounter counter, long long amount);
+		void set(StreamGauge gauge, long long value);
+		long long get_counter(StreamCounter counter);
+		long long get_gauge(StreamGauge gauge);
+		long long get_stage_count(int stage);
+		long long get_stage_bucket(int stage, int bucket);
+		int find_stage(string name);
+		double get_fps();
+
+		static const char *get_counter_name(StreamCounter counter);
+		static const char *get_counter_help(StreamCounter counter);
+		static const char *get_gauge_name(StreamGauge gauge);
+		static const char *get_gauge_help(StreamGauge gauge);
+		static string escape_label(const string &value);
+		static string video_label(const string &path);
+
+		void write_counter(ostream &out, StreamCounter counter);
+		void write_gauge(ostream &out, StreamGauge gauge);
+		void write_fps(ostream &out);
+		void write_stage_histograms(ostream &out);
+};
+
+#endif
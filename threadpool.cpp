@@ -0,0 +1,213 @@
+#include "threadpool.h"
+
+/**
+ *	@file threadpool.cpp
+ *  @desc A fixed set of worker threads that run queued tasks. Used to spread independent
+ *  pieces of work, such as the shapes found in one frame, across the available cores.
+ *
+ *  @param int num_threads - number of worker threads, 0 uses one per core
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+ThreadPool::ThreadPool(int num_threads)
+	: shutting_down(false)
+{
+	int i;
+
+	if (num_threads <= 0)
+	{
+		num_threads = thread::hardware_concurrency();
+		if (num_threads <= 0)
+		{
+			num_threads = 2;
+		}
+	}
+
+	for (i = 0; i < num_threads; i++)
+	{
+		workers.push_back(thread(&ThreadPool::worker_loop, this));
+	}
+}
+
+/**
+ *  @desc Finishes the queued tasks and joins the workers
+ */
+ThreadPool::~ThreadPool()
+{
+	int i;
+
+	{
+		lock_guard<mutex> guard(lock);
+		shutting_down = true;
+	}
+	has_work.notify_all();
+
+	for (i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+}
+
+/**
+ *  @desc Queues a task to be run by the next free worker
+ *
+ *  @param function<void()> task - the work to run
+ */
+void ThreadPool::submit(function<void()> task)
+{
+	{
+		lock_guard<mutex> guard(lock);
+		tasks.push_back(task);
+	}
+	has_work.notify_one();
+}
+
+/**
+ *  @desc Runs body(0) to body(count - 1) across the workers and the calling thread,
+ *  returning once every index has been run. Indices are handed out one at a time so
+ *  a slow item doesn't hold up the others. The calling thread always takes part, so
+ *  the loop still finishes if every worker is busy with other tasks. If an index
+ *  throws the rest still run, then the first exception is rethrown to the caller.
+ *
+ *  @param int count - number of indices to run
+ *  @param function<void(int)> body - work for a single index
+ */
+void ThreadPool::parallel_for(int count, function<void(int)> body)
+{
+	parallel_for(count, body, (int)workers.size());
+}
+
+/**
+ *  @desc As parallel_for(count, body), but asks for at most max_helpers workers on top
+ *  of the calling thread. Callers sharing the pool use this to take a fair share of
+ *  the workers rather than queueing a task for every one of them.
+ *
+ *  @param int count - number of indices to run
+ *  @param function<void(int)> body - work for a single index
+ *  @param int max_helpers - most workers to ask for, 0 runs everything on the caller
+ */
+void ThreadPool::parallel_for(int count, function<void(int)> body, int max_helpers)
+{
+	struct LoopState
+	{
+		atomic<int> next;
+		atomic<int> done;
+		int count;
+		function<void(int)> body;
+		mutex lock;
+		condition_variable finished;
+		exception_ptr error;		//the first exception thrown by body, guarded by lock
+	};
+
+	shared_ptr<LoopState> state = make_shared<LoopState>();
+	int helpers, i;
+
+	if (count <= 0)
+	{
+		return;
+	}
+
+	state->next = 0;
+	state->done = 0;
+	state->count = count;
+	state->body = body;
+
+	auto run_items = [state]()
+	{
+		int item;
+
+		while ((item = state->next++) < state->count)
+		{
+			try
+			{
+				state->body(item);
+			}
+			catch (...)
+			{
+				lock_guard<mutex> guard(state->lock);
+				if (!state->error)
+				{
+					state->error = current_exception();
+				}
+			}
+
+			if (++state->done == state->count)
+			{
+				lock_guard<mutex> guard(state->lock);
+				state->finished.notify_all();
+			}
+		}
+	};
+
+	helpers = count - 1;
+	if (helpers > (int)workers.size())
+	{
+		helpers = (int)workers.size();
+	}
+	if (helpers > max_helpers)
+	{
+		helpers = max_helpers < 0 ? 0 : max_helpers;
+	}
+	for (i = 0; i < helpers; i++)
+	{
+		submit(run_items);
+	}
+
+	run_items();
+
+	unique_lock<mutex> guard(state->lock);
+	state->finished.wait(guard, [state] { return state->done == state->count; });
+	if (state->error)
+	{
+		rethrow_exception(state->error);
+	}
+}
+
+int ThreadPool::get_size()
+{
+	return (int)workers.size();
+}
+
+/**
+ *  @desc Splits the workers between several callers sharing the pool, e.g. streams or
+ *  segments, for parallel_for's max_helpers. Each gets an even share, the remainder
+ *  goes one each to the first callers, and every caller gets at least one helper so
+ *  none is left to run on its own thread while workers sit idle.
+ *
+ *  @param int user - index of the caller, from 0
+ *  @param int users - number of callers sharing the pool
+ *
+ *  @returns int - helpers the caller should ask for
+ */
+int ThreadPool::get_share(int user, int users)
+{
+	int share = (int)workers.size() / users;
+
+	if (user < (int)workers.size() % users)
+	{
+		share++;
+	}
+	return share < 1 ? 1 : share;
+}
+
+void ThreadPool::worker_loop()
+{
+	function<void()> task;
+
+	while (true)
+	{
+		{
+			unique_lock<mutex> guard(lock);
+			has_work.wait(guard, [this] { return shutting_down || !tasks.empty(); });
+			if (tasks.empty())
+			{
+				return;
+			}
+			task = tasks.front();
+			tasks.pop_front();
+		}
+		task();
+	}
+}
@@ -0,0 +1,38 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <exception>
+#include <condition_variable>
+
+using namespace std;
+
+class ThreadPool
+{
+	private:
+		vector<thread> workers;
+		deque<function<void()>> tasks;
+		mutex lock;
+		condition_variable has_work;
+		bool shutting_down;
+
+		void worker_loop();
+
+	public:
+		ThreadPool(int num_threads);
+		~ThreadPool();
+		void submit(function<void()> task);
+		void parallel_for(int count, function<void(int)> body);
+		void parallel_for(int count, function<void(int)> body, int max_helpers);
+		int get_size();
+		int get_share(int user, int users);
+};
+
+#endif
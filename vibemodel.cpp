@@ -0,0 +1,328 @@
+#include "vibemodel.h"
+
+/**
+ *	@file vibemodel.cpp
+ *  @desc Each frame is run in two passes over the tiles. The first compares every
+ *  pixel with its samples and writes the raw mask, leaving the model untouched, so a
+ *  tile can read its neighbours' rows freely. The second filters the noise from each
+ *  tile's rows of the raw mask and updates the samples of the tile's background
+ *  pixels. A pixel only updates neighbours within its own tile, so no two tasks ever
+ *  write the same sample. The second pass's tiles are shifted by a different number
+ *  of rows each frame, so the rows a neighbour update can't cross move around and no
+ *  row is cut off from its neighbours for more than a frame.
+ *
+ *  The noise filter is BGS::filter_noise(), a close then an open, run on the tile plus
+ *  enough rows either side that the result matches filtering the whole mask.
+ *
+ *  The random updates use a xorshift generator per tile, seeded from the frame count,
+ *  with one draw per background pixel split into the update decisions, the sample to
+ *  replace and the neighbour to update.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+/**
+ *  @desc Advances a xorshift32 generator
+ */
+static inline unsigned int next_random(unsigned int state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+VibeModel::VibeModel(int history, double threshold)
+	: plane(0), frame_count(0), halo(0), pool(NULL), pool_helpers(0)
+{
+	radius = (int)(sqrt(max(threshold, 1.0)) + 0.5);
+	radius = min(max(radius, 1), 255);
+
+	update_factor = 1;
+	while (update_factor * 2 <= VIBE_MAX_UPDATE && update_factor * 2 * VIBE_SAMPLES <= history)	//a sample lasts about VIBE_SAMPLES * update_factor frames
+	{
+		update_factor *= 2;
+	}
+}
+
+/**
+ *  @desc Filters the noise from the mask in the same pass as the update, with the
+ *  kernels BGS::filter_noise() uses. Empty kernels turn the filter off.
+ *
+ *  @param const Mat &close - kernel of the closing step
+ *  @param const Mat &open - kernel of the opening step
+ */
+void VibeModel::set_noise_filter(const Mat &close, const Mat &open)
+{
+	close_kernel = close;
+	open_kernel = open;
+	halo = filters_noise() ? 2 * (close_kernel.rows / 2) + 2 * (open_kernel.rows / 2) : 0;
+}
+
+/**
+ *  @desc Runs the tiles on the shared pool, without one they run on the calling thread
+ *
+ *  @param ThreadPool *shared_pool - the stream's pool, may be NULL
+ *  @param int max_helpers - most workers to ask for on top of the calling thread
+ */
+void VibeModel::set_pool(ThreadPool *shared_pool, int max_helpers)
+{
+	pool = shared_pool;
+	pool_helpers = max_helpers;
+}
+
+bool VibeModel::filters_noise()
+{
+	return !close_kernel.empty() && !open_kernel.empty();
+}
+
+/**
+ *  @desc Memory held by the samples and the raw mask
+ */
+size_t VibeModel::get_memory_bytes()
+{
+	return samples.size() + raw_mask.total();
+}
+
+string VibeModel::get_name()
+{
+	return "ViBe";
+}
+
+int VibeModel::get_radius()
+{
+	return radius;
+}
+
+int VibeModel::get_update_factor()
+{
+	return update_factor;
+}
+
+/**
+ *  @desc Classifies the zone's new frame and updates the model. The first frame, and
+ *  any frame of a new size, fills the samples and returns an empty mask.
+ *
+ *  @param InputArray grey - the zone, 8-bit greyscale
+ *  @param OutputArray fgmask - foreground mask, 255 for foreground, filtered if a
+ *  noise filter was set
+ */
+void VibeModel::apply(InputArray grey, OutputArray fgmask)
+{
+	Mat image = grey.getMat();
+	Mat mask;
+	int tiles, rows, offset;
+	unsigned int frame_seed;
+
+	CV_Assert(image.type() == CV_8UC1);
+	fgmask.create(image.size(), CV_8UC1);
+	mask = fgmask.getMat();
+
+	if (image.size() != frame_size)
+	{
+		init(image);
+		mask.setTo(Scalar(0));
+		return;
+	}
+
+	rows = image.rows;
+	tiles = (rows + VIBE_TILE_ROWS - 1) / VIBE_TILE_ROWS;
+	frame_count++;
+	frame_seed = frame_count * 2654435761u;
+
+	run_tiles(tiles, [&](int tile)
+	{
+		classify_rows(image, tile * VIBE_TILE_ROWS, min((tile + 1) * VIBE_TILE_ROWS, rows));
+	});
+
+	offset = (int)((frame_seed >> 16) % VIBE_TILE_ROWS);	//moves the tile edges the updates can't cross
+	tiles = (rows + offset + VIBE_TILE_ROWS - 1) / VIBE_TILE_ROWS;
+
+	run_tiles(tiles, [&](int tile)
+	{
+		int first_row = max(tile * VIBE_TILE_ROWS - offset, 0);
+		int end_row = min((tile + 1) * VIBE_TILE_ROWS - offset, rows);
+
+		filter_rows(&mask, first_row, end_row);
+		update_rows(image, first_row, end_row, (frame_seed ^ ((tile + 1) * 2246822519u)) | 1);
+	});
+}
+
+/**
+ *  @desc Fills every pixel's samples from its 3x3 neighbourhood in the first frame
+ *
+ *  @param const Mat &grey - the first frame of the zone
+ */
+void VibeModel::init(const Mat &grey)
+{
+	unsigned int state = 0x9E3779B9u;
+	int i, j, k, ni, nj;
+
+	frame_size = grey.size();
+	plane = (size_t)frame_size.area();
+	samples.assign(plane * VIBE_SAMPLES, 0);
+	raw_mask.create(frame_size, CV_8UC1);
+	frame_count = 0;
+
+	for (i = 0; i < grey.rows; i++)
+	{
+		for (j = 0; j < grey.cols; j++)
+		{
+			samples[i * grey.cols + j] = grey.at<uchar>(i, j);	//the pixel itself is always one of its samples
+			for (k = 1; k < VIBE_SAMPLES; k++)
+			{
+				state = next_random(state);
+				ni = min(max(i + (int)(state % 3) - 1, 0), grey.rows - 1);
+				nj = min(max(j + (int)((state >> 8) % 3) - 1, 0), grey.cols - 1);
+				samples[k * plane + i * grey.cols + j] = grey.at<uchar>(ni, nj);
+			}
+		}
+	}
+}
+
+void VibeModel::run_tiles(int tiles, function<void(int)> body)
+{
+	int i;
+
+	if (pool != NULL)
+	{
+		pool->parallel_for(tiles, body, pool_helpers);
+		return;
+	}
+	for (i = 0; i < tiles; i++)
+	{
+		body(i);
+	}
+}
+
+/**
+ *  @desc Writes the raw mask of the given rows. 16 pixels are compared with each sample
+ *  plane at once where the build supports OpenCV's SIMD types, counting the matches in
+ *  each byte, and the rest of the row a pixel at a time.
+ *
+ *  @param const Mat &grey - the zone
+ *  @param int first_row - first row of the tile
+ *  @param int end_row - row after the last row of the tile
+ */
+void VibeModel::classify_rows(const Mat &grey, int first_row, int end_row)
+{
+	const int cols = frame_size.width;
+	const uchar *src, *row_samples;
+	uchar *dst;
+	int i, j, k, matches;
+
+#if CV_SIMD128
+	v_uint8x16 v_radius = v_setall_u8((uchar)radius);
+	v_uint8x16 v_min_matches = v_setall_u8(VIBE_MIN_MATCHES);
+	v_uint8x16 v_one = v_setall_u8(1);
+	v_uint8x16 v_pixel, v_matches;
+#endif
+
+	for (i = first_row; i < end_row; i++)
+	{
+		src = grey.ptr<uchar>(i);
+		dst = raw_mask.ptr<uchar>(i);
+		row_samples = &samples[i * cols];
+		j = 0;
+
+#if CV_SIMD128
+		for (; j <= cols - 16; j += 16)
+		{
+			v_pixel = v_load(src + j);
+			v_matches = v_setall_u8(0);
+			for (k = 0; k < VIBE_SAMPLES; k++)
+			{
+				v_matches = v_matches + ((v_absdiff(v_pixel, v_load(row_samples + k * plane + j)) < v_radius) & v_one);
+			}
+			v_store(dst + j, v_matches < v_min_matches);	//0xFF where too few samples matched
+		}
+#endif
+
+		for (; j < cols; j++)
+		{
+			matches = 0;
+			for (k = 0; k < VIBE_SAMPLES; k++)
+			{
+				if (abs(src[j] - row_samples[k * plane + j]) < radius)
+				{
+					matches++;
+				}
+			}
+			dst[j] = matches < VIBE_MIN_MATCHES ? 255 : 0;
+		}
+	}
+}
+
+/**
+ *  @desc Updates the samples of the background pixels in the given rows. Neighbours
+ *  outside the tile are clamped into it.
+ *
+ *  @param const Mat &grey - the zone
+ *  @param int first_row - first row of the tile
+ *  @param int end_row - row after the last row of the tile
+ *  @param unsigned int seed - non-zero seed of the tile's generator
+ */
+void VibeModel::update_rows(const Mat &grey, int first_row, int end_row, unsigned int seed)
+{
+	const int cols = frame_size.width;
+	const unsigned int update_mask = update_factor - 1;
+	unsigned int state = seed;
+	const uchar *src, *raw;
+	int i, j, ni, nj;
+
+	for (i = first_row; i < end_row; i++)
+	{
+		src = grey.ptr<uchar>(i);
+		raw = raw_mask.ptr<uchar>(i);
+		for (j = 0; j < cols; j++)
+		{
+			if (raw[j] != 0)
+			{
+				continue;
+			}
+			state = next_random(state);
+			if ((state & update_mask) == 0)	//bits 0-5, replace one of its own samples
+			{
+				samples[((state >> 12) % VIBE_SAMPLES) * plane + i * cols + j] = src[j];
+			}
+			if (((state >> 6) & update_mask) == 0)	//bits 6-11, and one of a neighbour's
+			{
+				ni = min(max(i + (int)((state >> 17) % 3) - 1, first_row), end_row - 1);
+				nj = min(max(j + (int)((state >> 20) % 3) - 1, 0), cols - 1);
+				samples[((state >> 23) % VIBE_SAMPLES) * plane + ni * cols + nj] = src[j];
+			}
+		}
+	}
+}
+
+/**
+ *  @desc Writes the given rows of the output mask, filtered if a noise filter was set.
+ *  The filter reads halo rows either side of the tile from the raw mask.
+ *
+ *  @param Mat *fgmask - the output mask
+ *  @param int first_row - first row of the tile
+ *  @param int end_row - row after the last row of the tile
+ */
+void VibeModel::filter_rows(Mat *fgmask, int first_row, int end_row)
+{
+	Mat band, step, closed, opened;
+	int top, bottom;
+
+	if (!filters_noise())
+	{
+		raw_mask.rowRange(first_row, end_row).copyTo(fgmask->rowRange(first_row, end_row));
+		return;
+	}
+
+	top = max(first_row - halo, 0);
+	bottom = min(end_row + halo, raw_mask.rows);
+	band = raw_mask.rowRange(top, bottom);
+
+	dilate(band, step, close_kernel);	//same steps as BGS::filter_noise()
+	erode(step, closed, close_kernel);
+	erode(closed, step, open_kernel);
+	dilate(step, opened, open_kernel);
+
+	opened.rowRange(first_row - top, end_row - top).copyTo(fgmask->rowRange(first_row, end_row));
+}
@@ -0,0 +1,79 @@
+#ifndef VIBEMODEL_H
+#define VIBEMODEL_H
+
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include "opencv2/core.hpp"
+#include "opencv2/imgproc.hpp"
+#include <opencv2/core/hal/intrin.hpp>
+#include "backgroundmodel.h"
+#include "threadpool.h"
+
+using namespace std;
+using namespace cv;
+
+#define VIBE_SAMPLES 20			//samples kept per pixel
+#define VIBE_MIN_MATCHES 2		//samples a pixel must be within the radius of to be background
+#define VIBE_TILE_ROWS 32		//rows of the zone handed to each task
+#define VIBE_MAX_UPDATE 64		//largest update factor, must be a power of two
+
+/**
+ *	@file vibemodel.h
+ *  @desc A ViBe style background model on 8-bit luma. Every pixel keeps VIBE_SAMPLES
+ *  past values and is background when at least VIBE_MIN_MATCHES of them are within the
+ *  radius of its new value. A background pixel replaces one of its own samples, and
+ *  one of a neighbour's, with a chance of 1 in the update factor, so the model keeps
+ *  up with slow changes and spreads the background back over ghosts.
+ *
+ *  The samples are stored as VIBE_SAMPLES planes the size of the zone, for 1 byte per
+ *  sample instead of KNN's 2 and 20 samples instead of KNN's 21. Plane k holds sample
+ *  k of every pixel, so 16 pixels are compared against a sample with one SIMD load.
+ *  The zone is split into tiles of rows that are run on the shared pool, and the noise
+ *  filter is run tile by tile in the same pass as the model update.
+ *
+ *  The BGS settings are mapped across so the masks are comparable with KNN's: the
+ *  radius is the square root of the KNN squared distance threshold, and the update
+ *  factor is chosen so a sample lasts about as many frames as the KNN history.
+ *
+ *  @param int history - BGS history length
+ *  @param double threshold - BGS squared distance to threshold
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class VibeModel : public BackgroundModel
+{
+	private:
+		vector<uchar> samples;		//VIBE_SAMPLES planes of frame_size
+		Size frame_size;
+		size_t plane;				//pixels in one plane
+		int radius;
+		int update_factor;
+		unsigned int frame_count;
+		Mat raw_mask;
+		Mat close_kernel;
+		Mat open_kernel;
+		int halo;					//rows either side of a tile the noise filter reads
+		ThreadPool *pool;
+		int pool_helpers;
+
+		void init(const Mat &grey);
+		void run_tiles(int tiles, function<void(int)> body);
+		void classify_rows(const Mat &grey, int first_row, int end_row);
+		void update_rows(const Mat &grey, int first_row, int end_row, unsigned int seed);
+		void filter_rows(Mat *fgmask, int first_row, int end_row);
+
+	public:
+		VibeModel(int history, double threshold);
+		void apply(InputArray grey, OutputArray fgmask);
+		void set_noise_filter(const Mat &close, const Mat &open);
+		void set_pool(ThreadPool *shared_pool, int max_helpers);
+		bool filters_noise();
+		size_t get_memory_bytes();
+		string get_name();
+		int get_radius();
+		int get_update_factor();
+};
+
+#endif
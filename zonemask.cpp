@@ -0,0 +1,143 @@
+#include "zonemask.h"
+
+/**
+ *	@file zonemask.cpp
+ *  @desc Reads the active zones for a camera and fits them to the frame. A zone file has
+ *  one zone per line as "x y width height" in pixels, lines starting with '#' are skipped.
+ *  With no zones configured the whole frame is a single zone.
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+
+ZoneMask::ZoneMask()
+{}
+
+/**
+ *  @desc Reads the zones from a zone file, adding them to any already configured
+ *
+ *  @param string path - path of the zone file
+ *
+ *  @returns true if the file was read
+ */
+bool ZoneMask::load(string path)
+{
+	ifstream file(path);
+	string line;
+	int x, y, width, height;
+
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	while (getline(file, line))
+	{
+		if (line.empty() || line[0] == '#')
+		{
+			continue;
+		}
+
+		istringstream fields(line);
+		if (fields >> x >> y >> width >> height)
+		{
+			add_zone(Rect(x, y, width, height));
+		}
+		else
+		{
+			cout << "Skipping zone line \"" << line << "\" in " << path << endl;
+		}
+	}
+
+	return true;
+}
+
+void ZoneMask::add_zone(Rect zone)
+{
+	configured.push_back(zone);
+}
+
+/**
+ *  @desc Clips the configured zones to the frame and merges any that overlap into their
+ *  bounding box, so no pixel is processed twice. Zones outside the frame are dropped.
+ *
+ *  @param Size frame_size - size of the video frames
+ */
+void ZoneMask::fit_to_frame(Size frame_size)
+{
+	Rect frame_rect = Rect(0, 0, frame_size.width, frame_size.height);
+	Rect clipped;
+	bool merged = true;
+	int i, j;
+
+	zones.clear();
+	for (i = 0; i < configured.size(); i++)
+	{
+		clipped = configured[i] & frame_rect;
+		if (clipped.area() > 0)
+		{
+			zones.push_back(clipped);
+		}
+	}
+
+	if (zones.empty())
+	{
+		zones.push_back(frame_rect);
+		return;
+	}
+
+	while (merged)	//merging can make a zone overlap one it didn't before, so repeat until nothing changes
+	{
+		merged = false;
+		for (i = 0; i < zones.size() && !merged; i++)
+		{
+			for (j = i + 1; j < zones.size() && !merged; j++)
+			{
+				if ((zones[i] & zones[j]).area() > 0)
+				{
+					zones[i] = zones[i] | zones[j];
+					zones.erase(zones.begin() + j);
+					merged = true;
+				}
+			}
+		}
+	}
+}
+
+const vector<Rect>& ZoneMask::get_zones()
+{
+	return zones;
+}
+
+/**
+ *  @desc Gives the zones for a frame shrunk by the given factor. Both corners are
+ *  rounded down, so zones that didn't overlap still don't, and each scaled zone maps
+ *  back to whole pixels of the full frame.
+ *
+ *  @param int scale - factor the frame is shrunk by
+ *
+ *  @returns vector<Rect> - the zones in the shrunk frame, empty zones are left out
+ */
+vector<Rect> ZoneMask::get_scaled_zones(int scale)
+{
+	vector<Rect> scaled;
+	Rect zone;
+
+	for (int i = 0; i < zones.size(); i++)
+	{
+		zone.x = zones[i].x / scale;
+		zone.y = zones[i].y / scale;
+		zone.width = (zones[i].x + zones[i].width) / scale - zone.x;
+		zone.height = (zones[i].y + zones[i].height) / scale - zone.y;
+		if (zone.area() > 0)
+		{
+			scaled.push_back(zone);
+		}
+	}
+	return scaled;
+}
+
+bool ZoneMask::is_full_frame(Size frame_size)
+{
+	return zones.size() == 1 && zones[0] == Rect(0, 0, frame_size.width, frame_size.height);
+}
@@ -0,0 +1,41 @@
+#ifndef ZONEMASK_H
+#define ZONEMASK_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "opencv2/core.hpp"
+
+using namespace std;
+using namespace cv;
+
+/**
+ *	@file zonemask.h
+ *  @desc The active zones of a fixed camera. Background subtraction, noise filtering and
+ *  contour finding are only run inside the zones, the rest of the frame is left empty.
+ *
+ *  @param vector<Rect> configured - zones as read from the zone file
+ *  @param vector<Rect> zones - configured zones clipped to the frame, overlaps merged
+ *
+ *	@author Alex O'Donnell
+ *	@version 1.00
+ */
+class ZoneMask
+{
+	private:
+		vector<Rect> configured;
+		vector<Rect> zones;
+
+	public:
+		ZoneMask();
+		bool load(string path);
+		void add_zone(Rect zone);
+		void fit_to_frame(Size frame_size);
+		const vector<Rect>& get_zones();
+		vector<Rect> get_scaled_zones(int scale);
+		bool is_full_frame(Size frame_size);
+};
+
+#endif